@@ -0,0 +1,79 @@
+#----------------------------------------------------------------------
+# Commander Core controller core
+#
+# Device protocol, detection, hotplug and the cooling service. Shared by
+# the OpenRGB plugin (CorsairCommanderCore.pro) and the headless daemon
+# (CorsairCommanderCoreDaemon.pro). Nothing here may depend on Qt or on
+# OpenRGB's RGBController.
+#----------------------------------------------------------------------
+
+INCLUDEPATH += $$PWD/src
+
+HEADERS += \
+    $$PWD/src/CorsairCapellixXTCalibration.h      \
+    $$PWD/src/CorsairCapellixXTColor.h            \
+    $$PWD/src/CorsairCapellixXTControl.h          \
+    $$PWD/src/CorsairCapellixXTController.h       \
+    $$PWD/src/CorsairCapellixXTDetect.h           \
+    $$PWD/src/CorsairCapellixXTFrameSync.h        \
+    $$PWD/src/CorsairCapellixXTHidraw.h           \
+    $$PWD/src/CorsairCapellixXTHotplug.h          \
+    $$PWD/src/CorsairCapellixXTHwmon.h            \
+    $$PWD/src/CorsairCapellixXTLoad.h             \
+    $$PWD/src/CorsairCapellixXTLog.h              \
+    $$PWD/src/CorsairCapellixXTMetrics.h          \
+    $$PWD/src/CorsairCapellixXTProtocol.h         \
+    $$PWD/src/CorsairCapellixXTSettings.h         \
+    $$PWD/src/CorsairCapellixXTSettingsWatch.h    \
+    $$PWD/src/CorsairCapellixXTService.h          \
+    $$PWD/src/CorsairCapellixXTTelemetry.h        \
+    $$PWD/src/CorsairCapellixXTTrace.h            \
+    $$PWD/src/CorsairCapellixXTTransport.h        \
+    $$PWD/src/CorsairCapellixXTWatchdog.h
+
+SOURCES += \
+    $$PWD/src/CorsairCapellixXTCalibration.cpp    \
+    $$PWD/src/CorsairCapellixXTColor.cpp          \
+    $$PWD/src/CorsairCapellixXTControl.cpp        \
+    $$PWD/src/CorsairCapellixXTController.cpp     \
+    $$PWD/src/CorsairCapellixXTDetect.cpp         \
+    $$PWD/src/CorsairCapellixXTFrameSync.cpp      \
+    $$PWD/src/CorsairCapellixXTHidraw.cpp         \
+    $$PWD/src/CorsairCapellixXTHotplug.cpp        \
+    $$PWD/src/CorsairCapellixXTHwmon.cpp          \
+    $$PWD/src/CorsairCapellixXTLoad.cpp           \
+    $$PWD/src/CorsairCapellixXTLog.cpp            \
+    $$PWD/src/CorsairCapellixXTMetrics.cpp        \
+    $$PWD/src/CorsairCapellixXTSettings.cpp       \
+    $$PWD/src/CorsairCapellixXTSettingsWatch.cpp  \
+    $$PWD/src/CorsairCapellixXTService.cpp        \
+    $$PWD/src/CorsairCapellixXTTelemetry.cpp      \
+    $$PWD/src/CorsairCapellixXTTrace.cpp          \
+    $$PWD/src/CorsairCapellixXTTransport.cpp      \
+    $$PWD/src/CorsairCapellixXTWatchdog.cpp
+
+#----------------------------------------------------------------------
+# hidapi link flags
+#----------------------------------------------------------------------
+
+unix:!macx {
+    CONFIG  += link_pkgconfig
+    PKGCONFIG += hidapi-hidraw
+}
+
+macx {
+    LIBS += -framework IOKit -framework CoreFoundation
+    CONFIG  += link_pkgconfig
+    PKGCONFIG += hidapi
+    # <filesystem> requires macOS 10.15+; Qt 5 defaults to 10.13
+    QMAKE_MACOSX_DEPLOYMENT_TARGET = 10.15
+    QMAKE_CXXFLAGS += -std=c++17
+    # Qt 5's default QMAKE_LFLAGS_PLUGIN includes -single_module, which
+    # modern ld warns is obsolete.  Strip it to keep the build clean.
+    QMAKE_LFLAGS_PLUGIN -= -single_module
+}
+
+win32 {
+    CONFIG  += link_pkgconfig
+    PKGCONFIG += hidapi
+}
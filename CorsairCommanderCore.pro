@@ -82,30 +82,10 @@ win32 {
 }
 
 #----------------------------------------------------------------------
-# hidapi link flags
+# Controller core (shared with the headless daemon) + hidapi link flags
 #----------------------------------------------------------------------
 
-unix:!macx {
-    CONFIG  += link_pkgconfig
-    PKGCONFIG += hidapi-hidraw
-}
-
-macx {
-    LIBS += -framework IOKit -framework CoreFoundation
-    CONFIG  += link_pkgconfig
-    PKGCONFIG += hidapi
-    # <filesystem> requires macOS 10.15+; Qt 5 defaults to 10.13
-    QMAKE_MACOSX_DEPLOYMENT_TARGET = 10.15
-    QMAKE_CXXFLAGS += -std=c++17
-    # Qt 5's default QMAKE_LFLAGS_PLUGIN includes -single_module, which
-    # modern ld warns is obsolete.  Strip it to keep the build clean.
-    QMAKE_LFLAGS_PLUGIN -= -single_module
-}
-
-win32 {
-    CONFIG  += link_pkgconfig
-    PKGCONFIG += hidapi
-}
+include(CorsairCommanderCore.pri)
 
 #----------------------------------------------------------------------
 # RGBController base class — compiled into the plugin so the typeinfo
@@ -122,15 +102,11 @@ SOURCES += $$OPENRGB_DIR/RGBController/RGBController.cpp
 
 HEADERS += \
     src/CorsairCapellixXTPlugin.h           \
-    src/CorsairCapellixXTController.h       \
-    src/RGBController_CorsairCapellixXT.h   \
-    src/CorsairCapellixXTDetect.h
+    src/RGBController_CorsairCapellixXT.h
 
 SOURCES += \
     src/CorsairCapellixXTPlugin.cpp         \
-    src/CorsairCapellixXTController.cpp     \
-    src/RGBController_CorsairCapellixXT.cpp \
-    src/CorsairCapellixXTDetect.cpp
+    src/RGBController_CorsairCapellixXT.cpp
 
 RESOURCES += \
     resources/resources.qrc
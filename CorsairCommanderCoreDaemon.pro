@@ -0,0 +1,39 @@
+#----------------------------------------------------------------------
+# Headless cooling daemon for the Corsair Commander Core
+#
+# Runs the same controller, detection and cooling code as the OpenRGB
+# plugin, without Qt, OpenRGB or any lighting. Driven by the same mode
+# and curve files in ~/.config/OpenRGB/plugins/settings/.
+#
+# Build (no OPENRGB_DIR needed):
+#   qmake CorsairCommanderCoreDaemon.pro -o Makefile.daemon
+#   make -f Makefile.daemon -j$(nproc)
+#----------------------------------------------------------------------
+
+TEMPLATE = app
+CONFIG  += console c++17 thread
+CONFIG  -= qt app_bundle
+
+TARGET   = commander-core-daemon
+
+# Keep objects apart from the plugin build (different flags, same sources)
+OBJECTS_DIR = build/daemon
+
+VERSION_STRING = "0.1.0"
+GIT_COMMIT_ID  = $$system(git rev-parse --short=8 HEAD)
+DEFINES += VERSION_STRING=\\\"$$VERSION_STRING\\\"
+DEFINES += GIT_COMMIT_ID=\\\"$$GIT_COMMIT_ID\\\"
+
+include(CorsairCommanderCore.pri)
+
+SOURCES += \
+    daemon/CommanderCoreDaemon.cpp
+
+#----------------------------------------------------------------------
+# Install target
+#----------------------------------------------------------------------
+
+unix {
+    target.path = /usr/local/bin
+    INSTALLS += target
+}
@@ -0,0 +1,39 @@
+#----------------------------------------------------------------------
+# Deterministic tests for the Commander Core controller core
+#
+# Links the same sources as the daemon and runs without hardware.
+#
+# Build and run (from the repository root):
+#   qmake CorsairCommanderCoreTests.pro -o Makefile.tests
+#   make -f Makefile.tests -j$(nproc) && ./commander-core-tests
+#----------------------------------------------------------------------
+
+TEMPLATE = app
+CONFIG  += console c++17 thread
+CONFIG  -= qt app_bundle
+
+TARGET   = commander-core-tests
+
+OBJECTS_DIR = build/tests
+
+include(CorsairCommanderCore.pri)
+
+INCLUDEPATH += $$PWD/test
+
+# Recorded traces the replay test runs against
+DEFINES += CC_TEST_FIXTURES=\\\"$$PWD/test/fixtures\\\"
+
+HEADERS += \
+    test/CommanderCoreTest.h        \
+    test/CommanderCoreTestTransport.h
+
+SOURCES += \
+    test/CommanderCoreTests.cpp     \
+    test/TestCalibration.cpp        \
+    test/TestFrameLayout.cpp        \
+    test/TestFrameSync.cpp          \
+    test/TestLedPorts.cpp           \
+    test/TestProfiles.cpp           \
+    test/TestReplay.cpp             \
+    test/TestTargetRpm.cpp          \
+    test/TestTelemetry.cpp
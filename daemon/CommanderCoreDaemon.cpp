@@ -0,0 +1,267 @@
+/*---------------------------------------------------------------------*\
+| commander-core-daemon                                                 |
+|                                                                       |
+| Headless pump and fan control for the Corsair Commander Core. Uses    |
+| the plugin's controller core (no Qt, no OpenRGB, no lighting) and     |
+| follows the same settings files in                                    |
+| ~/.config/OpenRGB/plugins/settings/:                                  |
+|   CommanderCorePump.conf        mode (and active profile)             |
+|   CommanderCoreCurves.conf      Auto curves, fan sources              |
+|   CommanderCoreTargets.conf     Target RPM speeds                     |
+|   CommanderCoreProfiles.conf    named profiles                        |
+| Any of them can be edited while the daemon runs; changes are picked   |
+| up within a second. Started before the cooler is plugged in, it waits |
+| for one to appear instead of exiting.                                 |
+|                                                                       |
+| --record <dir> writes an HID trace per device (same as setting        |
+| CC_TRACE_RECORD); --replay <trace> runs one controller against a      |
+| recorded trace instead of a device, see RunReplay().                  |
+\*---------------------------------------------------------------------*/
+
+#include "CorsairCapellixXTControl.h"
+#include "CorsairCapellixXTController.h"
+#include "CorsairCapellixXTDetect.h"
+#include "CorsairCapellixXTHotplug.h"
+#include "CorsairCapellixXTLog.h"
+#include "CorsairCapellixXTMetrics.h"
+#include "CorsairCapellixXTSettings.h"
+#include "CorsairCapellixXTSettingsWatch.h"
+#include "CorsairCapellixXTTrace.h"
+#include "CorsairCapellixXTWatchdog.h"
+
+#include <hidapi.h>
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define CC_DAEMON_DETECT_POLL_SEC   2       // look for a cooler this often until one appears
+
+static std::atomic<bool> daemon_run{true};
+
+static void HandleSignal(int /*sig*/)
+{
+    daemon_run = false;
+}
+
+static void PrintUsage(const char* argv0)
+{
+    printf("Usage: %s [--help] [--version] [--record <dir>] [--calibrate]\n"
+           "       %s --replay <trace> [--realtime] [--lighting]\n"
+           "\n"
+           "Headless pump and fan control for the Corsair Commander Core.\n"
+           "Mode and curves are read from %s\n"
+           "\n"
+           "  --record <dir>     write an HID trace per device into <dir>\n"
+           "  --calibrate        measure duty -> rpm on every device after startup\n"
+           "  --replay <trace>   drive one controller from a recorded trace\n"
+           "  --realtime         replay with the recorded call durations\n"
+           "  --lighting         replay a session that had lighting enabled\n",
+           argv0, argv0, CCSettingsDir().c_str());
+}
+
+/*---------------------------------------------------------------------*\
+| Replay: the controller talks to the trace instead of a device, runs   |
+| its normal initialization and service schedule, and stops when the    |
+| trace is used up (which it sees as an unplug). Exit status is 0 when  |
+| every command the controller sent matches the recording.              |
+|                                                                       |
+| Cooling commands depend on the mode / curve files, so replay with     |
+| the same settings the session was recorded with.                      |
+\*---------------------------------------------------------------------*/
+
+static int RunReplay(const char* path, bool realtime, bool with_lighting)
+{
+    CCTraceReplay replay;
+
+    if(!replay.Load(path))
+    {
+        return 1;
+    }
+
+    replay.SetRealtime(realtime);
+
+    CCLog(CC_LOG_INFO, "replaying %s (%s, serial %s)",
+          path, replay.GetProductString().c_str(), replay.GetSerialString().c_str());
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    CorsairCapellixXTController* controller =
+        new CorsairCapellixXTController(new CCTraceReplayTransport(&replay), path,
+                                        replay.GetProductID());
+
+    controller->Initialize(with_lighting);
+
+    while(daemon_run.load() && controller->IsConnected() && !replay.Finished())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+
+    delete controller;
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    CCTraceReplayStats stats = replay.GetStats();
+
+    CCLogFlush();
+    printf("[CommanderCore] replay done in %.2f s: %u writes, %u reads, %u mismatched writes, "
+           "%u recorded reads skipped, %u reads past the recording\n",
+           elapsed, stats.writes, stats.reads, stats.mismatches,
+           stats.skipped_reads, stats.empty_reads);
+
+    return stats.mismatches == 0 ? 0 : 1;
+}
+
+int main(int argc, char** argv)
+{
+    const char* replay_path   = nullptr;
+    bool        realtime      = false;
+    bool        with_lighting = false;
+    bool        calibrate     = false;
+
+    for(int i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "--version") == 0)
+        {
+            printf("commander-core-daemon %s (%s)\n", VERSION_STRING, GIT_COMMIT_ID);
+            return 0;
+        }
+
+        if(strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+        {
+            setenv(CC_TRACE_ENV, argv[++i], 1);
+            continue;
+        }
+
+        if(strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+        {
+            replay_path = argv[++i];
+            continue;
+        }
+
+        if(strcmp(argv[i], "--realtime") == 0)
+        {
+            realtime = true;
+            continue;
+        }
+
+        if(strcmp(argv[i], "--lighting") == 0)
+        {
+            with_lighting = true;
+            continue;
+        }
+
+        if(strcmp(argv[i], "--calibrate") == 0)
+        {
+            calibrate = true;
+            continue;
+        }
+
+        PrintUsage(argv[0]);
+        return strcmp(argv[i], "--help") == 0 ? 0 : 2;
+    }
+
+    signal(SIGINT,  HandleSignal);
+    signal(SIGTERM, HandleSignal);
+
+    if(replay_path)
+    {
+        return RunReplay(replay_path, realtime, with_lighting);
+    }
+
+    if(hid_init() != 0)
+    {
+        fprintf(stderr, "[CommanderCore] hid_init failed\n");
+        return 1;
+    }
+
+    /*-----------------------------------------------------------------*\
+    | Cooling only: skip LED port setup and the color endpoint          |
+    \*-----------------------------------------------------------------*/
+    std::vector<CorsairCapellixXTController*> controllers =
+        DetectCorsairCapellixXTControllers(false);
+
+    /*-----------------------------------------------------------------*\
+    | Nothing plugged in yet (or still enumerating at boot): keep        |
+    | looking rather than exit, so the unit does not restart-loop        |
+    \*-----------------------------------------------------------------*/
+    if(controllers.empty())
+    {
+        CCLog(CC_LOG_WARN, "no Commander Core found, waiting for one");
+    }
+
+    while(controllers.empty() && daemon_run.load())
+    {
+        std::this_thread::sleep_for(std::chrono::seconds(CC_DAEMON_DETECT_POLL_SEC));
+        controllers = DetectCorsairCapellixXTControllers(false);
+    }
+
+    if(controllers.empty())
+    {
+        hid_exit();
+        return 0;
+    }
+
+    for(CorsairCapellixXTController* c : controllers)
+    {
+        CCLog(CC_LOG_INFO, "managing %s (%s, firmware %s)",
+              c->GetSerialString().c_str(), c->GetDevicePath().c_str(),
+              c->GetFirmwareVersion().c_str());
+    }
+
+    CorsairCapellixXTHotplug hotplug(controllers);
+    hotplug.Start();
+
+    CorsairCapellixXTMetrics metrics(controllers);
+    metrics.Start();
+
+    CorsairCapellixXTControl control(controllers);
+    control.Start();
+
+    CorsairCapellixXTWatchdog watchdog(controllers);
+    watchdog.Start();
+
+    if(calibrate)
+    {
+        for(CorsairCapellixXTController* c : controllers)
+        {
+            if(!c->StartCalibration())
+            {
+                CCLog(CC_LOG_WARN, "%s: not calibrating (no pump, or mode is Disabled)",
+                      c->GetSerialString().c_str());
+            }
+        }
+    }
+
+    /*-----------------------------------------------------------------*\
+    | Edits to the settings files are picked up by the settings watch;  |
+    | all device I/O happens on the service thread                      |
+    \*-----------------------------------------------------------------*/
+    CorsairCapellixXTSettingsWatch settings_watch(controllers);
+    settings_watch.Start();
+
+    while(daemon_run.load())
+    {
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+    }
+
+    settings_watch.Stop();
+    watchdog.Stop();
+    control.Stop();
+    metrics.Stop();
+    hotplug.Stop();
+
+    for(CorsairCapellixXTController* c : controllers)
+    {
+        delete c;
+    }
+
+    hid_exit();
+    return 0;
+}
@@ -0,0 +1,217 @@
+#include "CorsairCapellixXTCalibration.h"
+#include "CorsairCapellixXTSettings.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+bool CorsairCapellixXTCalibration::Empty() const
+{
+    return channels.empty();
+}
+
+void CorsairCapellixXTCalibration::Clear()
+{
+    channels.clear();
+}
+
+CCChannelCalibration& CorsairCapellixXTCalibration::ChannelFor(unsigned int channel)
+{
+    for(CCChannelCalibration& c : channels)
+    {
+        if(c.channel == channel)
+        {
+            return c;
+        }
+    }
+
+    channels.push_back({channel, {}, -1});
+    return channels.back();
+}
+
+const CCChannelCalibration* CorsairCapellixXTCalibration::Channel(unsigned int channel) const
+{
+    for(const CCChannelCalibration& c : channels)
+    {
+        if(c.channel == channel)
+        {
+            return &c;
+        }
+    }
+
+    return nullptr;
+}
+
+void CorsairCapellixXTCalibration::AddReading(unsigned int channel, uint8_t duty, int rpm)
+{
+    ChannelFor(channel).points.push_back({duty, rpm});
+}
+
+void CorsairCapellixXTCalibration::Finish()
+{
+    std::vector<CCChannelCalibration> kept;
+
+    for(CCChannelCalibration& c : channels)
+    {
+        std::sort(c.points.begin(), c.points.end(),
+                  [](const CCCalibrationPoint& a, const CCCalibrationPoint& b) { return a.duty < b.duty; });
+
+        /*-------------------------------------------------------------*\
+        | Nothing spinning even at the top duty: empty port              |
+        \*-------------------------------------------------------------*/
+        if(c.points.empty() || c.points.back().rpm < CC_CALIBRATION_STALL_RPM)
+        {
+            continue;
+        }
+
+        c.stall_duty = -1;
+
+        for(const CCCalibrationPoint& p : c.points)
+        {
+            if(p.rpm < CC_CALIBRATION_STALL_RPM)
+            {
+                c.stall_duty = p.duty;
+            }
+        }
+
+        kept.push_back(c);
+    }
+
+    channels = kept;
+}
+
+int CorsairCapellixXTCalibration::DutyForRpm(unsigned int channel, int rpm) const
+{
+    const CCChannelCalibration* c = Channel(channel);
+
+    if(c == nullptr || c->points.empty())
+    {
+        return -1;
+    }
+
+    for(size_t i = 0; i < c->points.size(); i++)
+    {
+        const CCCalibrationPoint& b = c->points[i];
+
+        if(b.rpm < rpm)
+        {
+            continue;
+        }
+        if(i == 0)
+        {
+            return b.duty;
+        }
+
+        const CCCalibrationPoint& a = c->points[i - 1];
+
+        float span = (float)(b.rpm - a.rpm);
+        float frac = span > 0.0f ? (float)(rpm - a.rpm) / span : 1.0f;
+
+        return (int)std::ceil(a.duty + frac * (b.duty - a.duty) - 0.001f);
+    }
+
+    return c->points.back().duty;
+}
+
+int CorsairCapellixXTCalibration::RpmForDuty(unsigned int channel, int duty) const
+{
+    const CCChannelCalibration* c = Channel(channel);
+
+    if(c == nullptr || c->points.empty())
+    {
+        return -1;
+    }
+
+    for(size_t i = 0; i < c->points.size(); i++)
+    {
+        const CCCalibrationPoint& b = c->points[i];
+
+        if(b.duty < duty)
+        {
+            continue;
+        }
+        if(i == 0)
+        {
+            return b.rpm;
+        }
+
+        const CCCalibrationPoint& a = c->points[i - 1];
+
+        return a.rpm + (b.rpm - a.rpm) * (duty - a.duty) / (b.duty - a.duty);
+    }
+
+    return c->points.back().rpm;
+}
+
+bool CorsairCapellixXTCalibration::Load(const std::string& serial)
+{
+    std::string path = CCDeviceSettingsPath(CC_CALIBRATION_FILE_PREFIX, serial);
+    if(path.empty())
+    {
+        return false;
+    }
+    FILE* f = fopen(path.c_str(), "r");
+    if(f == nullptr)
+    {
+        return false;
+    }
+
+    channels.clear();
+
+    char line[128];
+
+    while(fgets(line, sizeof(line), f) != nullptr)
+    {
+        unsigned int channel;
+        unsigned int duty;
+        int          rpm;
+
+        if(sscanf(line, "point %u %u %d", &channel, &duty, &rpm) == 3 && duty <= 100 && rpm >= 0)
+        {
+            AddReading(channel, (uint8_t)duty, rpm);
+        }
+        else if(sscanf(line, "stall %u %u", &channel, &duty) == 2 && duty <= 100)
+        {
+            ChannelFor(channel).stall_duty = (int)duty;
+        }
+    }
+    fclose(f);
+
+    for(CCChannelCalibration& c : channels)
+    {
+        std::sort(c.points.begin(), c.points.end(),
+                  [](const CCCalibrationPoint& a, const CCCalibrationPoint& b) { return a.duty < b.duty; });
+    }
+
+    return !channels.empty();
+}
+
+bool CorsairCapellixXTCalibration::Save(const std::string& serial) const
+{
+    std::string path = CCDeviceSettingsPath(CC_CALIBRATION_FILE_PREFIX, serial);
+    if(path.empty())
+    {
+        return false;
+    }
+    FILE* f = fopen(path.c_str(), "w");
+    if(f == nullptr)
+    {
+        return false;
+    }
+
+    fprintf(f, "# duty (%%) -> rpm per speed channel, written by the calibration sweep\n");
+
+    for(const CCChannelCalibration& c : channels)
+    {
+        for(const CCCalibrationPoint& p : c.points)
+        {
+            fprintf(f, "point %u %u %d\n", c.channel, (unsigned)p.duty, p.rpm);
+        }
+        if(c.stall_duty >= 0)
+        {
+            fprintf(f, "stall %u %d\n", c.channel, c.stall_duty);
+        }
+    }
+    fclose(f);
+    return true;
+}
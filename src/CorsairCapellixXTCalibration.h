@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*---------------------------------------------------------------------*\
+| Duty -> RPM calibration                                               |
+|                                                                       |
+| The fixed mode duties in CorsairCapellixXTController.h were measured  |
+| on one pump and one set of fans. The calibration sweep (started from  |
+| the plugin pane or commander-core-daemon --calibrate) steps the pump  |
+| and the fans through their duty range, waits for each speed to        |
+| settle and records what every channel actually does. The result is    |
+| kept per device serial in CommanderCoreCalibration-<serial>.conf:     |
+|   point <channel> <duty> <rpm>                                        |
+|   stall <channel> <duty>          highest duty the channel stalled at |
+| and the controller derives its mode duties and floors from it by      |
+| looking up the duty that reaches each mode's reference speed.         |
+\*---------------------------------------------------------------------*/
+
+#define CC_CALIBRATION_STALL_RPM    200     // below this a channel counts as stopped
+#define CC_CALIBRATION_STALL_MARGIN 5       // duty % kept above the measured stall
+
+struct CCCalibrationPoint
+{
+    uint8_t         duty;
+    int             rpm;
+};
+
+struct CCChannelCalibration
+{
+    unsigned int                    channel;
+    std::vector<CCCalibrationPoint> points;     // ascending duty
+    int                             stall_duty; // -1 = never stalled in the sweep
+};
+
+class CorsairCapellixXTCalibration
+{
+public:
+    bool                        Empty() const;
+    void                        Clear();
+
+    void                        AddReading(unsigned int channel, uint8_t duty, int rpm);
+
+    /*-----------------------------------------------------------------*\
+    | After a sweep: sort the points, find each channel's stall duty    |
+    | and drop channels with nothing connected                          |
+    \*-----------------------------------------------------------------*/
+    void                        Finish();
+
+    bool                        Load(const std::string& serial);
+    bool                        Save(const std::string& serial) const;
+
+    const CCChannelCalibration* Channel(unsigned int channel) const;
+
+    /*-----------------------------------------------------------------*\
+    | Lowest duty that reaches rpm on a channel, interpolated between   |
+    | measured points; -1 if the channel was not calibrated             |
+    \*-----------------------------------------------------------------*/
+    int                         DutyForRpm(unsigned int channel, int rpm) const;
+
+    /*-----------------------------------------------------------------*\
+    | Expected speed at a duty, the inverse of DutyForRpm; -1 if the    |
+    | channel was not calibrated                                        |
+    \*-----------------------------------------------------------------*/
+    int                         RpmForDuty(unsigned int channel, int duty) const;
+
+private:
+    std::vector<CCChannelCalibration> channels;
+
+    CCChannelCalibration&       ChannelFor(unsigned int channel);
+};
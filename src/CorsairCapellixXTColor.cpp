@@ -0,0 +1,174 @@
+#include "CorsairCapellixXTColor.h"
+#include "CorsairCapellixXTLog.h"
+#include "CorsairCapellixXTSettings.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+CorsairCapellixXTColorCorrection::CorsairCapellixXTColorCorrection()
+    : identity(true)
+{
+    static const float unity[3] = { 1.0f, 1.0f, 1.0f };
+
+    for(unsigned int z = 0; z < CC_COLOR_MAX_ZONES; z++)
+    {
+        BuildTables(tables[z], 1.0f, 1.0f, unity);
+    }
+}
+
+bool CorsairCapellixXTColorCorrection::IsIdentity() const
+{
+    return identity;
+}
+
+/*---------------------------------------------------------------------*\
+| out = 255 * brightness * gain * (in / 255) ^ gamma, rounded, clamped  |
+\*---------------------------------------------------------------------*/
+
+void CorsairCapellixXTColorCorrection::BuildTables(ZoneTables& t, float brightness, float gamma,
+                                                   const float gains[3])
+{
+    for(unsigned int c = 0; c < 3; c++)
+    {
+        float scale = brightness * gains[c];
+
+        for(unsigned int v = 0; v < 256; v++)
+        {
+            float out = 255.0f * scale * powf(v / 255.0f, gamma);
+
+            if(out < 0.0f)   out = 0.0f;
+            if(out > 255.0f) out = 255.0f;
+
+            t.lut[c][v] = (uint8_t)lroundf(out);
+        }
+    }
+}
+
+/*---------------------------------------------------------------------*\
+| Gains are 0..1 like the header says; the comparisons also reject NaN  |
+\*---------------------------------------------------------------------*/
+
+static bool GainsValid(float r, float g, float b)
+{
+    return r >= 0.0f && r <= 1.0f
+        && g >= 0.0f && g <= 1.0f
+        && b >= 0.0f && b <= 1.0f;
+}
+
+void CorsairCapellixXTColorCorrection::Load(const std::string& serial)
+{
+    std::string path = CCDeviceSettingsPath(CC_COLOR_FILE_PREFIX, serial);
+    if(path.empty())
+    {
+        return;
+    }
+    FILE* f = fopen(path.c_str(), "r");
+    if(f == nullptr)
+    {
+        return;
+    }
+
+    float        brightness = 1.0f;
+    float        gamma      = 1.0f;
+    float        gains[3]   = { 1.0f, 1.0f, 1.0f };
+    ZoneSettings zones[CC_COLOR_MAX_ZONES];
+    char         line[128];
+
+    memset(zones, 0, sizeof(zones));
+
+    while(fgets(line, sizeof(line), f) != nullptr)
+    {
+        unsigned int zone;
+        float        a;
+        float        r, g, b;
+
+        if(sscanf(line, "brightness %f", &a) == 1 && a >= 0.0f && a <= 100.0f)
+        {
+            brightness = a / 100.0f;
+        }
+        else if(sscanf(line, "gamma %f", &a) == 1 && a >= 0.1f && a <= 5.0f)
+        {
+            gamma = a;
+        }
+        else if(sscanf(line, "white_balance %f %f %f", &r, &g, &b) == 3 && GainsValid(r, g, b))
+        {
+            gains[0] = r;
+            gains[1] = g;
+            gains[2] = b;
+        }
+        else if(sscanf(line, "zone %u brightness %f", &zone, &a) == 2
+             && zone < CC_COLOR_MAX_ZONES && a >= 0.0f && a <= 100.0f)
+        {
+            zones[zone].has_brightness = true;
+            zones[zone].brightness     = a / 100.0f;
+        }
+        else if(sscanf(line, "zone %u white_balance %f %f %f", &zone, &r, &g, &b) == 4
+             && zone < CC_COLOR_MAX_ZONES && GainsValid(r, g, b))
+        {
+            zones[zone].has_gains = true;
+            zones[zone].gains[0]  = r;
+            zones[zone].gains[1]  = g;
+            zones[zone].gains[2]  = b;
+        }
+    }
+    fclose(f);
+
+    identity = true;
+
+    for(unsigned int z = 0; z < CC_COLOR_MAX_ZONES; z++)
+    {
+        float        zb = brightness * (zones[z].has_brightness ? zones[z].brightness : 1.0f);
+        const float* zg = zones[z].has_gains ? zones[z].gains : gains;
+
+        BuildTables(tables[z], zb, gamma, zg);
+
+        if(zb != 1.0f || gamma != 1.0f || zg[0] != 1.0f || zg[1] != 1.0f || zg[2] != 1.0f)
+        {
+            identity = false;
+        }
+    }
+
+    CCLog(CC_LOG_INFO, "%s: color correction %s",
+          serial.c_str(), identity ? "file has no effect" : "loaded");
+}
+
+/*---------------------------------------------------------------------*\
+| Fused correct + pack. Four LEDs per iteration: the three table reads  |
+| per LED are independent, which keeps the loads pipelined. Byte-wide   |
+| table lookups have no SIMD gather, and a frame is at most a few       |
+| hundred LEDs, so this stays scalar.                                   |
+\*---------------------------------------------------------------------*/
+
+void CorsairCapellixXTColorCorrection::PackZone(unsigned int zone, const uint32_t* colors,
+                                                size_t count, uint8_t* out) const
+{
+    const ZoneTables& t = tables[zone < CC_COLOR_MAX_ZONES ? zone : CC_COLOR_MAX_ZONES - 1];
+    const uint8_t*    r = t.lut[0];
+    const uint8_t*    g = t.lut[1];
+    const uint8_t*    b = t.lut[2];
+
+    size_t i = 0;
+
+    for(; i + 4 <= count; i += 4, out += 12)
+    {
+        uint32_t c0 = colors[i + 0];
+        uint32_t c1 = colors[i + 1];
+        uint32_t c2 = colors[i + 2];
+        uint32_t c3 = colors[i + 3];
+
+        out[0]  = r[c0 & 0xFF]; out[1]  = g[(c0 >> 8) & 0xFF]; out[2]  = b[(c0 >> 16) & 0xFF];
+        out[3]  = r[c1 & 0xFF]; out[4]  = g[(c1 >> 8) & 0xFF]; out[5]  = b[(c1 >> 16) & 0xFF];
+        out[6]  = r[c2 & 0xFF]; out[7]  = g[(c2 >> 8) & 0xFF]; out[8]  = b[(c2 >> 16) & 0xFF];
+        out[9]  = r[c3 & 0xFF]; out[10] = g[(c3 >> 8) & 0xFF]; out[11] = b[(c3 >> 16) & 0xFF];
+    }
+
+    for(; i < count; i++, out += 3)
+    {
+        uint32_t c = colors[i];
+
+        out[0] = r[c & 0xFF];
+        out[1] = g[(c >> 8) & 0xFF];
+        out[2] = b[(c >> 16) & 0xFF];
+    }
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*---------------------------------------------------------------------*\
+| Color correction                                                      |
+|                                                                       |
+| The pump head and the fans render the same RGB differently, so each   |
+| zone can get its own correction on top of a global one. Per device    |
+| serial, in CommanderCoreColor-<serial>.conf next to the other         |
+| settings:                                                             |
+|   brightness 80                   global, percent                     |
+|   gamma 2.2                       1.0 = linear                        |
+|   white_balance 1.0 0.85 0.7      R G B gains, 0..1                   |
+|   zone 0 brightness 60            per zone (0 = pump head)            |
+|   zone 1 white_balance 1 0.9 0.8  replaces the global gains           |
+|                                                                       |
+| Every zone's brightness, gamma and gains are folded into three        |
+| 256-entry tables once at load, so the frame path is one table lookup  |
+| per byte, done while packing the colors into the RGB24 wire layout.   |
+| Without a file the tables are the identity and the output is the raw  |
+| colors, as before.                                                    |
+\*---------------------------------------------------------------------*/
+
+#define CC_COLOR_MAX_ZONES          8
+
+class CorsairCapellixXTColorCorrection
+{
+public:
+    CorsairCapellixXTColorCorrection();
+
+    void                        Load(const std::string& serial);
+    bool                        IsIdentity() const;
+
+    /*-----------------------------------------------------------------*\
+    | Correct count colors (OpenRGB layout 0x00BBGGRR) of one zone and   |
+    | write them as R, G, B bytes to out (count * 3 bytes)               |
+    \*-----------------------------------------------------------------*/
+    void                        PackZone(unsigned int zone, const uint32_t* colors,
+                                         size_t count, uint8_t* out) const;
+
+private:
+    struct ZoneSettings
+    {
+        bool                    has_brightness;
+        float                   brightness;
+        bool                    has_gains;
+        float                   gains[3];
+    };
+
+    struct ZoneTables
+    {
+        uint8_t                 lut[3][256];
+    };
+
+    ZoneTables                  tables[CC_COLOR_MAX_ZONES];
+    bool                        identity;
+
+    static void                 BuildTables(ZoneTables& t, float brightness, float gamma, const float gains[3]);
+};
@@ -0,0 +1,308 @@
+#include "CorsairCapellixXTControl.h"
+#include "CorsairCapellixXTController.h"
+#include "CorsairCapellixXTLog.h"
+#include "CorsairCapellixXTSettings.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#endif
+
+CorsairCapellixXTControl::CorsairCapellixXTControl(const std::vector<CorsairCapellixXTController*>& ctrls)
+    : controllers(ctrls)
+{
+}
+
+CorsairCapellixXTControl::~CorsairCapellixXTControl()
+{
+    Stop();
+}
+
+void CorsairCapellixXTControl::Start()
+{
+#ifndef _WIN32
+    if(server_thread != nullptr || controllers.empty())
+    {
+        return;
+    }
+
+    std::string path = SocketPath();
+
+    if(path.empty() || !OpenListener(path))
+    {
+        return;
+    }
+
+    server_thread_run = true;
+    server_thread     = new std::thread(&CorsairCapellixXTControl::ServerThread, this);
+
+    CCLog(CC_LOG_INFO, "control socket on %s", path.c_str());
+#endif
+}
+
+void CorsairCapellixXTControl::Stop()
+{
+    if(server_thread)
+    {
+        server_thread_run = false;
+        server_thread->join();
+        delete server_thread;
+        server_thread = nullptr;
+    }
+
+#ifndef _WIN32
+    if(sock >= 0)
+    {
+        close(sock);
+        sock = -1;
+    }
+
+    if(!socket_path.empty())
+    {
+        unlink(socket_path.c_str());
+        socket_path.clear();
+    }
+#endif
+}
+
+std::string CorsairCapellixXTControl::SocketPath()
+{
+    const char* runtime = getenv("XDG_RUNTIME_DIR");
+
+    if(runtime != nullptr && runtime[0] != '\0')
+    {
+        return std::string(runtime) + "/" + CC_CONTROL_SOCKET_FILE;
+    }
+
+    return CCSettingsPath(CC_CONTROL_SOCKET_FILE);
+}
+
+/*---------------------------------------------------------------------*\
+| Listener. A socket file left by a crashed run is replaced; one that   |
+| still accepts connections belongs to a running instance and is kept.  |
+| The umask is tightened around bind() so the file is never reachable   |
+| by others, not even between bind() and chmod().                       |
+\*---------------------------------------------------------------------*/
+
+bool CorsairCapellixXTControl::OpenListener(const std::string& path)
+{
+#ifdef _WIN32
+    (void)path;
+    return false;
+#else
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+
+    if(path.size() >= sizeof(addr.sun_path))
+    {
+        CCLog(CC_LOG_ERROR, "control socket path too long: %s", path.c_str());
+        return false;
+    }
+
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+    int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    if(probe >= 0)
+    {
+        bool live = connect(probe, (struct sockaddr*)&addr, sizeof(addr)) == 0;
+
+        close(probe);
+
+        if(live)
+        {
+            CCLog(CC_LOG_WARN, "control socket %s is in use by another instance, not listening", path.c_str());
+            return false;
+        }
+    }
+
+    sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(sock < 0)
+    {
+        return false;
+    }
+
+    unlink(path.c_str());
+
+    mode_t old_mask = umask(0077);
+    bool   bound    = bind(sock, (struct sockaddr*)&addr, sizeof(addr)) == 0;
+
+    umask(old_mask);
+
+    if(!bound || listen(sock, 4) < 0)
+    {
+        CCLog(CC_LOG_ERROR, "cannot listen on %s", path.c_str());
+        close(sock);
+        sock = -1;
+        return false;
+    }
+
+    chmod(path.c_str(), 0600);
+
+    socket_path = path;
+    return true;
+#endif
+}
+
+void CorsairCapellixXTControl::ServerThread()
+{
+#ifndef _WIN32
+    while(server_thread_run)
+    {
+        struct pollfd pfd;
+        pfd.fd      = sock;
+        pfd.events  = POLLIN;
+        pfd.revents = 0;
+
+        if(poll(&pfd, 1, CC_CONTROL_POLL_MS) <= 0)
+        {
+            continue;
+        }
+
+        int client = accept(sock, nullptr, nullptr);
+
+        if(client >= 0)
+        {
+            HandleClient(client);
+            close(client);
+        }
+    }
+#endif
+}
+
+/*---------------------------------------------------------------------*\
+| One command line per connection. The peer's uid is checked where the  |
+| platform reports it, so a loosened socket mode does not open it up.   |
+\*---------------------------------------------------------------------*/
+
+void CorsairCapellixXTControl::HandleClient(int client)
+{
+#ifdef _WIN32
+    (void)client;
+#else
+#ifdef SO_PEERCRED
+    struct ucred cred;
+    socklen_t    cred_len = sizeof(cred);
+
+    if(getsockopt(client, SOL_SOCKET, SO_PEERCRED, &cred, &cred_len) != 0 || cred.uid != getuid())
+    {
+        CCLog(CC_LOG_WARN, "control socket: dropped a connection from another user");
+        return;
+    }
+#endif
+
+    std::string request;
+    char        buf[256];
+
+    while(request.size() < CC_CONTROL_REQUEST_MAX && request.find('\n') == std::string::npos)
+    {
+        struct pollfd pfd;
+        pfd.fd      = client;
+        pfd.events  = POLLIN;
+        pfd.revents = 0;
+
+        if(poll(&pfd, 1, CC_CONTROL_READ_TIMEOUT_MS) <= 0)
+        {
+            return;
+        }
+
+        ssize_t n = recv(client, buf, sizeof(buf), 0);
+        if(n <= 0)
+        {
+            break;
+        }
+
+        request.append(buf, (size_t)n);
+    }
+
+    std::string reply = Handle(request.substr(0, request.find('\n')));
+    size_t      sent  = 0;
+
+    while(sent < reply.size())
+    {
+        ssize_t n = send(client, reply.data() + sent, reply.size() - sent, MSG_NOSIGNAL);
+        if(n <= 0)
+        {
+            break;
+        }
+        sent += (size_t)n;
+    }
+#endif
+}
+
+/*---------------------------------------------------------------------*\
+| Commands                                                              |
+\*---------------------------------------------------------------------*/
+
+std::string CorsairCapellixXTControl::Handle(const std::string& line)
+{
+    std::string command = line;
+
+    while(!command.empty() && (command.back() == '\r' || command.back() == ' '))
+    {
+        command.pop_back();
+    }
+
+    if(command == "profiles")
+    {
+        return RenderProfiles();
+    }
+
+    if(command.compare(0, 8, "profile ") == 0)
+    {
+        std::string name = command.substr(8);
+
+        if(!name.empty() && ApplyProfile(name))
+        {
+            return "applied " + name + "\n";
+        }
+
+        return "no profile " + name + "\n";
+    }
+
+    return "unknown command\n";
+}
+
+std::string CorsairCapellixXTControl::RenderProfiles()
+{
+    std::string body;
+
+    for(CorsairCapellixXTController* c : controllers)
+    {
+        std::string active = c->GetActiveProfile();
+
+        body += c->GetSerialString() + ":";
+        for(const std::string& name : c->GetProfileNames())
+        {
+            body += " " + name + (name == active ? "*" : "");
+        }
+        body += "\n";
+    }
+
+    return body;
+}
+
+bool CorsairCapellixXTControl::ApplyProfile(const std::string& name)
+{
+    bool applied = false;
+
+    for(CorsairCapellixXTController* c : controllers)
+    {
+        std::vector<std::string> names = c->GetProfileNames();
+
+        if(std::find(names.begin(), names.end(), name) != names.end())
+        {
+            applied = c->ApplyProfile(name) || applied;
+        }
+    }
+
+    return applied;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <atomic>
+#include <thread>
+
+class CorsairCapellixXTController;
+
+/*---------------------------------------------------------------------*\
+| Control socket (Unix only). Local scripts switch profiles over a Unix |
+| socket that only its owner can use: it is created mode 0600 in        |
+| $XDG_RUNTIME_DIR (the settings folder without it), and a peer of      |
+| another user is dropped even if the mode was loosened. One line per   |
+| connection, answered with one or more lines:                          |
+|   profiles                    per device: names, the active one *     |
+|   profile <name>              apply on every device that has it       |
+| e.g. echo 'profile quiet meeting' | nc -U $XDG_RUNTIME_DIR/...sock    |
+| Only one process may serve it (the daemon and the plugin are never    |
+| run together); a socket another process still answers on is left      |
+| alone. The metrics exporter stays read-only.                          |
+\*---------------------------------------------------------------------*/
+
+#define CC_CONTROL_SOCKET_FILE      "commander-core-control.sock"
+#define CC_CONTROL_POLL_MS          250
+#define CC_CONTROL_REQUEST_MAX      512
+#define CC_CONTROL_READ_TIMEOUT_MS  1000
+
+class CorsairCapellixXTControl
+{
+public:
+    CorsairCapellixXTControl(const std::vector<CorsairCapellixXTController*>& controllers);
+    ~CorsairCapellixXTControl();
+
+    void                                        Start();
+    void                                        Stop();
+
+    std::string                                 Handle(const std::string& line);
+    std::string                                 RenderProfiles();
+    bool                                        ApplyProfile(const std::string& name);
+
+    static std::string                          SocketPath();
+
+private:
+    std::vector<CorsairCapellixXTController*>   controllers;
+
+    std::thread*                                server_thread = nullptr;
+    std::atomic<bool>                           server_thread_run{false};
+    int                                         sock          = -1;
+    std::string                                 socket_path;
+
+    bool                                        OpenListener(const std::string& path);
+    void                                        ServerThread();
+    void                                        HandleClient(int client);
+};
@@ -1,58 +1,39 @@
 #include "CorsairCapellixXTController.h"
+#include "CorsairCapellixXTFrameSync.h"
+#include "CorsairCapellixXTHidraw.h"
+#include "CorsairCapellixXTLog.h"
+#include "CorsairCapellixXTProtocol.h"
+#include "CorsairCapellixXTSettings.h"
+#include "CorsairCapellixXTService.h"
+#include "CorsairCapellixXTTrace.h"
 #include <cstring>
 #include <cstdio>
 #include <cstdlib>
 #include <string>
 #include <thread>
 #include <chrono>
+#include <algorithm>
+#include <cmath>
 
 CorsairCapellixXTController::CorsairCapellixXTController(hid_device* dev, const char* path, uint16_t pid)
-    : dev(dev)
+    : CorsairCapellixXTController(CCTraceWrapTransport(new CorsairCapellixXTHidapiTransport(dev), pid), path, pid)
+{
+}
+
+CorsairCapellixXTController::CorsairCapellixXTController(CorsairCapellixXTTransport* transport, const char* path, uint16_t pid)
+    : transport(transport)
+    , reconnect_enabled(transport->CanReconnect())
     , product_id(pid)
+    , protocol(CCProtocolForPID(pid))
     , device_path(path)
     , total_leds(0)
 {
-    /*-------------------------------------------------------------*\
-    | Buffer sizes based on product ID                              |
-    |   0x0C32 (Commander Core 2 / ST)  = 64-byte buffers           |
-    |   0x0C2A (Commander Core XT)      = 384-byte buffers          |
-    |   All others                      = 96-byte buffers           |
-    \*-------------------------------------------------------------*/
-    if(product_id == COMMANDER_CORE2_PID)
-    {
-        buffer_size         = 64;
-        write_buffer_size   = 65;
-        max_buf_per_request = 61;
-    }
-    else if(product_id == COMMANDER_CORE_XT_PID)
-    {
-        buffer_size         = 384;
-        write_buffer_size   = 385;
-        max_buf_per_request = 381;
-    }
-    else
-    {
-        buffer_size         = 96;
-        write_buffer_size   = 97;
-        max_buf_per_request = 93;
-    }
 
     /*-------------------------------------------------------------*\
     | Read device strings                                           |
     \*-------------------------------------------------------------*/
-    wchar_t buf[256];
-
-    if(hid_get_serial_number_string(dev, buf, 256) == 0)
-    {
-        std::wstring ws(buf);
-        serial = std::string(ws.begin(), ws.end());
-    }
-
-    if(hid_get_product_string(dev, buf, 256) == 0)
-    {
-        std::wstring ws(buf);
-        device_name = std::string(ws.begin(), ws.end());
-    }
+    serial      = transport->GetSerialString();
+    device_name = transport->GetProductString();
 
     /*-------------------------------------------------------------*\
     | Default pump curve: liquid temperature (C) -> pump duty (%).   |
@@ -76,6 +57,23 @@ CorsairCapellixXTController::CorsairCapellixXTController(hid_device* dev, const
     };
 
     LoadPumpMode();
+    LoadCurves();
+    LoadTargets();
+    LoadProfiles();
+
+    /*-------------------------------------------------------------*\
+    | Back in the profile the mode file names; its burst runs once   |
+    | the service thread has the device                              |
+    \*-------------------------------------------------------------*/
+    if(!saved_profile.empty() && UseProfile(saved_profile))
+    {
+        profile_pending.store(true);
+    }
+
+    calibration.Load(serial);
+    ApplyCalibration();
+
+    color_correction.Load(serial);
 }
 
 CorsairCapellixXTController::~CorsairCapellixXTController()
@@ -92,63 +90,267 @@ CorsairCapellixXTController::~CorsairCapellixXTController()
     | lighting on its own, so this is both safe and more robust.         |
     \*-----------------------------------------------------------------*/
 
-    if(dev)
-    {
-        hid_close(dev);
-        dev = nullptr;
-    }
+    delete transport;
+    transport = nullptr;
 }
 
 /*---------------------------------------------------------------------*\
-| Keepalive thread — resend colors every 10s so the device doesn't      |
-| revert to hardware lighting mode                                      |
+| Keepalive — resend colors every 10s so the device doesn't revert to   |
+| hardware lighting mode. The periodic work runs on the shared service  |
+| thread (CorsairCapellixXTService) as the per-device ServiceStep().    |
 \*---------------------------------------------------------------------*/
 
 void CorsairCapellixXTController::StartKeepalive()
 {
-    keepalive_thread_run = true;
-    last_commit_time     = std::chrono::steady_clock::now();
-    keepalive_thread     = new std::thread(&CorsairCapellixXTController::KeepaliveThread, this);
+    last_commit_time  = std::chrono::steady_clock::now();
+    next_cooling_tick = last_commit_time + std::chrono::seconds(PUMP_UPDATE_INTERVAL_SEC);
+    CorsairCapellixXTService::Get()->Register(this);
 }
 
 void CorsairCapellixXTController::StopKeepalive()
 {
-    if(keepalive_thread)
-    {
-        keepalive_thread_run = false;
-        keepalive_thread->join();
-        delete keepalive_thread;
-        keepalive_thread = nullptr;
-    }
+    CorsairCapellixXTService::Get()->Unregister(this);
 }
 
-void CorsairCapellixXTController::KeepaliveThread()
+/*---------------------------------------------------------------------*\
+| One unit of work per call, in priority order. Returns the time this   |
+| device next needs servicing. Only ever called on the service thread.  |
+\*---------------------------------------------------------------------*/
+
+std::chrono::steady_clock::time_point CorsairCapellixXTController::ServiceStep(
+    std::chrono::steady_clock::time_point now)
 {
-    using namespace std::chrono_literals;
+    /*-----------------------------------------------------------------*\
+    | Device gone: poll for it to come back. On Linux the hotplug       |
+    | monitor usually reconnects first; this covers other platforms     |
+    | and any missed uevent.                                            |
+    \*-----------------------------------------------------------------*/
+    if(!connected.load())
+    {
+        cooling_phase = CC_COOLING_IDLE;
+        if(calibration_phase != CC_CALIBRATION_IDLE)
+        {
+            CalibrationAbort("device disconnected");
+        }
+        Reconnect();
+        return now + std::chrono::milliseconds(CC_RECONNECT_POLL_MS);
+    }
 
-    while(keepalive_thread_run.load())
+    /*-----------------------------------------------------------------*\
+    | System resumed: drop any half-done tick or sweep (the readings    |
+    | span the suspend) and put the device back the way we left it      |
+    \*-----------------------------------------------------------------*/
+    if(resume_pending.exchange(false))
     {
-        if((std::chrono::steady_clock::now() - last_commit_time) > 10s)
+        cooling_phase = CC_COOLING_IDLE;
+        if(calibration_phase != CC_CALIBRATION_IDLE)
         {
-            SendKeepalive();
+            CalibrationAbort("system suspended");
         }
+        replay_pending.store(false);
+        ReplayState();
+        return now;
+    }
 
-        /*-------------------------------------------------------------*\
-        | Re-evaluate the pump curve every PUMP_UPDATE_INTERVAL_SEC.     |
-        | Re-sending every cycle also keeps the pump in software-speed   |
-        | mode so it can't revert to the loud hardware default.          |
-        \*-------------------------------------------------------------*/
-        if(++pump_update_counter >= PUMP_UPDATE_INTERVAL_SEC)
+    /*-----------------------------------------------------------------*\
+    | Device answered again after the circuit breaker tripped           |
+    \*-----------------------------------------------------------------*/
+    if(replay_pending.exchange(false))
+    {
+        ReplayState();
+        return now;
+    }
+
+    /*-----------------------------------------------------------------*\
+    | LED ports coming up (startup from the topology cache, or a        |
+    | replay): poll the LED config until two reads in a row agree or    |
+    | the deadline passes. Then check a cached layout against the       |
+    | device, reopen the color endpoint after a replay, and resend the  |
+    | frame in case it arrived before the ports were ready.             |
+    \*-----------------------------------------------------------------*/
+    if((topology_verify_pending || color_restore_pending) && now >= led_ports_ready_time)
+    {
+        std::vector<ChannelInfo> found;
+        unsigned int             found_total = 0;
+        bool                     valid       = ReadLEDConfig(found, found_total);
+        bool                     ready       = valid && SameLayout(found, led_ports_last_read);
+
+        if(valid)
+        {
+            led_ports_last_read = found;
+        }
+        else
+        {
+            led_ports_last_read.clear();
+        }
+
+        if(!ready && now < led_ports_deadline && IsResponding())
+        {
+            led_ports_ready_time = now + std::chrono::milliseconds(CC_LED_READY_POLL_MS);
+            return now;
+        }
+
+        std::chrono::steady_clock::time_point t = RecordInitPhase(CC_INIT_LED_READY, led_ports_init_time);
+
+        if(color_restore_pending)
+        {
+            color_restore_pending = false;
+            OpenColorEndpoint();
+            RecordInitPhase(CC_INIT_COLOR_ENDPOINT, t);
+        }
+
+        LogInitPhases(ready ? "LED ports ready" : "LED ports not ready before the deadline");
+
+        if(topology_verify_pending)
         {
-            pump_update_counter = 0;
-            UpdatePumpFromCurve();
+            topology_verify_pending = false;
+
+            if(ready)
+            {
+                VerifyTopologyCache(found, found_total);
+            }
         }
 
-        std::this_thread::sleep_for(1s);
+        ResendLastFrame();
+        return now;
+    }
+
+    /*-----------------------------------------------------------------*\
+    | Profile switch: speeds and frame in one burst                     |
+    \*-----------------------------------------------------------------*/
+    if(profile_pending.exchange(false))
+    {
+        ProfileBurst();
+        return now;
+    }
+
+    /*-----------------------------------------------------------------*\
+    | Calibration sweep: takes over the speed channels from the cooling |
+    | tick until it finishes. Starts between ticks, never inside one.   |
+    \*-----------------------------------------------------------------*/
+    if(cooling_phase == CC_COOLING_IDLE
+    && calibration_phase == CC_CALIBRATION_IDLE
+    && calibration_requested.exchange(false))
+    {
+        calibration_sweep.Clear();
+        calibration_step  = 0;
+        calibration_phase = CC_CALIBRATION_WRITE;
+        calibration_next  = now;
+
+        CCLog(CC_LOG_INFO, "%s: calibration sweep started", serial.c_str());
+    }
+
+    if(calibration_phase != CC_CALIBRATION_IDLE && now >= calibration_next)
+    {
+        std::unique_lock<std::recursive_mutex> io_lock = LockForCooling();
+
+        calibration_next = CalibrationStep(now);
+        return now;
+    }
+
+    /*-----------------------------------------------------------------*\
+    | Cooling tick, one endpoint transaction per step. Re-sending every |
+    | PUMP_UPDATE_INTERVAL_SEC also keeps the pump in software-speed    |
+    | mode so it can't revert to the loud hardware default. Variants    |
+    | without a pump (Commander Core XT) have no cooling tick.          |
+    \*-----------------------------------------------------------------*/
+    if(protocol->has_pump
+    && cooling_phase == CC_COOLING_IDLE
+    && calibration_phase == CC_CALIBRATION_IDLE
+    && (now >= next_cooling_tick || cooling_requested.exchange(false)))
+    {
+        next_cooling_tick = now + std::chrono::seconds(PUMP_UPDATE_INTERVAL_SEC);
+        cooling_phase     = CC_COOLING_READ_TEMP;
+    }
+
+    std::unique_lock<std::recursive_mutex> io_lock;
+
+    if(cooling_phase != CC_COOLING_IDLE)
+    {
+        io_lock = LockForCooling();
+    }
+
+    switch(cooling_phase)
+    {
+        case CC_COOLING_READ_TEMP:
+            cooling_phase = CoolingReadSensors() ? CC_COOLING_APPLY : CC_COOLING_IDLE;
+            return now;
+
+        case CC_COOLING_APPLY:
+            CoolingApply();
+            cooling_phase = CC_COOLING_READ_SPEEDS;
+            return now;
+
+        case CC_COOLING_READ_SPEEDS:
+            CoolingReadSpeeds();
+            cooling_phase = CC_COOLING_IDLE;
+            return now;
+
+        default:
+            break;
+    }
+
+    std::chrono::steady_clock::time_point keepalive_due =
+        last_commit_time + std::chrono::seconds(CC_KEEPALIVE_INTERVAL_SEC);
+
+    if(now >= keepalive_due)
+    {
+        SendKeepalive();
+        return now;
+    }
+
+    std::chrono::steady_clock::time_point next = protocol->has_pump
+                                               ? std::min(next_cooling_tick, keepalive_due)
+                                               : keepalive_due;
+
+    if(topology_verify_pending || color_restore_pending)
+    {
+        next = std::min(next, led_ports_ready_time);
+    }
+
+    if(calibration_phase != CC_CALIBRATION_IDLE)
+    {
+        next = std::min(next, calibration_next);
     }
+
+    return next;
 }
 
+/*---------------------------------------------------------------------*\
+| Idle keepalive. The ping is one firmware query; a frame resend is     |
+| one chunk per max_payload bytes of frame (12 on the 64-byte           |
+| Commander Core), all under io_mutex. Devices with a pump start on     |
+| the ping, since falling back to hardware mode shows up in the pump    |
+| speed (CheckHardwareRevert) and demotes them to frame resends; the    |
+| hub without a pump has no such signal and large reports, so it always |
+| resends the frame. Byte and lock-time cost is counted for metrics.    |
+\*---------------------------------------------------------------------*/
+
 void CorsairCapellixXTController::SendKeepalive()
+{
+    std::lock_guard<std::recursive_mutex> io_lock(io_mutex);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    uint64_t                              bytes = bytes_written;
+
+    if(keepalive_strategy.load() == CC_KEEPALIVE_FRAME)
+    {
+        ResendLastFrame();
+    }
+    else
+    {
+        Transfer({CMD_GET_FIRMWARE_0, CMD_GET_FIRMWARE_1});
+        last_commit_time = std::chrono::steady_clock::now();
+        pinged_since_frame.store(true);
+    }
+
+    keepalives++;
+    keepalive_bytes   += bytes_written - bytes;
+    keepalive_lock_ns += (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                             std::chrono::steady_clock::now() - start).count();
+}
+
+void CorsairCapellixXTController::ResendLastFrame()
 {
     std::vector<uint8_t> colors_copy;
 
@@ -162,7 +364,7 @@ void CorsairCapellixXTController::SendKeepalive()
         /*-------------------------------------------------------------*\
         | Resend last colors to keep device in software mode            |
         \*-------------------------------------------------------------*/
-        SendColors(colors_copy);
+        SendColors(colors_copy, false);
     }
     else
     {
@@ -180,11 +382,13 @@ void CorsairCapellixXTController::SendKeepalive()
 
 std::string CorsairCapellixXTController::GetDevicePath()
 {
+    std::lock_guard<std::mutex> lock(info_mutex);
     return device_path;
 }
 
 std::string CorsairCapellixXTController::GetFirmwareVersion()
 {
+    std::lock_guard<std::mutex> lock(info_mutex);
     return firmware_version;
 }
 
@@ -203,6 +407,11 @@ uint16_t CorsairCapellixXTController::GetProductID()
     return product_id;
 }
 
+bool CorsairCapellixXTController::HasPump()
+{
+    return protocol->has_pump;
+}
+
 unsigned int CorsairCapellixXTController::GetTotalLEDCount()
 {
     return total_leds;
@@ -213,610 +422,3325 @@ std::vector<ChannelInfo>& CorsairCapellixXTController::GetChannels()
     return channels;
 }
 
-/*---------------------------------------------------------------------*\
-| Core transfer — matches OpenLinkHub cc.go transfer() exactly          |
-|                                                                       |
-| Write packet layout:                                                  |
-|   [0] = 0x00  (HID report ID)                                        |
-|   [1] = 0x08  (fixed protocol header)                                 |
-|   [2..2+len(endpoint)] = endpoint/command bytes                       |
-|   [2+len(endpoint)..] = buffer/payload bytes                          |
-|   ... zero-padded to write_buffer_size                                |
-\*---------------------------------------------------------------------*/
-
-std::vector<uint8_t> CorsairCapellixXTController::Transfer(
-    const std::vector<uint8_t>& endpoint,
-    const std::vector<uint8_t>& buf)
+unsigned int CorsairCapellixXTController::GetFrameSlotLeds(unsigned int zone)
 {
-    std::lock_guard<std::recursive_mutex> lock(io_mutex);
-
-    std::vector<uint8_t> pkt(write_buffer_size, 0x00);
+    return FrameSlotLeds(zone, frame_layout.load());
+}
 
-    pkt[0] = 0x00;                // HID report ID
-    pkt[1] = CC_PROTOCOL_HEADER;  // 0x08
+const CorsairCapellixXTColorCorrection& CorsairCapellixXTController::GetColorCorrection() const
+{
+    return color_correction;
+}
 
-    size_t ep_start = CC_HEADER_SIZE;
-    memcpy(&pkt[ep_start], endpoint.data(), endpoint.size());
+unsigned int CorsairCapellixXTController::FrameSlotLeds(unsigned int zone, int layout)
+{
+    unsigned int led_count = zone < channels.size() ? channels[zone].led_count : 0;
+    bool         last      = zone + 1 == channels.size();
 
-    if(!buf.empty())
+    if(zone == 0 || led_count >= CC_FAN_SLOT_LEDS || (last && layout == CC_FRAME_LAYOUT_TRIMMED))
     {
-        size_t buf_start = ep_start + endpoint.size();
-        memcpy(&pkt[buf_start], buf.data(), buf.size());
+        return led_count;
     }
+    return CC_FAN_SLOT_LEDS;
+}
 
-    hid_write(dev, pkt.data(), write_buffer_size);
-
-    std::this_thread::sleep_for(std::chrono::milliseconds(5));
-
-    std::vector<uint8_t> resp(buffer_size);
-    int bytes_read = hid_read_timeout(dev, resp.data(), buffer_size, 2000);
+size_t CorsairCapellixXTController::FrameBytes(int layout)
+{
+    size_t bytes = 0;
 
-    if(bytes_read > 0)
+    for(unsigned int zone = 0; zone < channels.size(); zone++)
     {
-        resp.resize(bytes_read);
-        return resp;
+        bytes += FrameSlotLeds(zone, layout) * 3;
     }
-
-    return {};
+    return bytes;
 }
 
 /*---------------------------------------------------------------------*\
-| Read endpoint: close-open-read-close (matches OpenLinkHub read())     |
+| Connection handling                                                   |
+|                                                                       |
+| hidapi returns -1 from hid_write / hid_read_timeout once the hidraw   |
+| node is gone (unplug, USB glitch, re-enumeration). The handle is then |
+| closed and every transfer fails fast until Reconnect() reopens the    |
+| device with the same serial.                                          |
 \*---------------------------------------------------------------------*/
 
-std::vector<uint8_t> CorsairCapellixXTController::ReadEndpoint(uint8_t mode)
+bool CorsairCapellixXTController::IsConnected()
 {
-    std::lock_guard<std::recursive_mutex> lock(io_mutex);
-
-    std::vector<uint8_t> mode_buf = { mode };
-
-    Transfer({CMD_CLOSE_ENDPOINT_0, CMD_CLOSE_ENDPOINT_1, CMD_CLOSE_ENDPOINT_2}, mode_buf);
-    Transfer({CMD_OPEN_ENDPOINT_0, CMD_OPEN_ENDPOINT_1}, mode_buf);
-    std::vector<uint8_t> resp = Transfer({CMD_READ_0, CMD_READ_1}, mode_buf);
-    Transfer({CMD_CLOSE_ENDPOINT_0, CMD_CLOSE_ENDPOINT_1, CMD_CLOSE_ENDPOINT_2}, mode_buf);
-
-    return resp;
+    return connected.load();
 }
 
-/*---------------------------------------------------------------------*\
-| Protocol commands                                                     |
-\*---------------------------------------------------------------------*/
-
-void CorsairCapellixXTController::ReadFirmware()
+void CorsairCapellixXTController::MarkDisconnected()
 {
-    std::vector<uint8_t> resp = Transfer({CMD_GET_FIRMWARE_0, CMD_GET_FIRMWARE_1});
+    std::lock_guard<std::recursive_mutex> lock(io_mutex);
 
-    if(resp.size() >= 7)
-    {
-        uint16_t patch = resp[5] | (resp[6] << 8);  // little-endian
-        firmware_version = "v" + std::to_string(resp[3]) + "."
-                               + std::to_string(resp[4]) + "."
-                               + std::to_string(patch);
-    }
-    else
+    if(transport == nullptr)
     {
-        firmware_version = "unknown";
+        return;
     }
-}
 
-void CorsairCapellixXTController::SetSoftwareMode()
-{
-    Transfer({CMD_SOFTWARE_MODE_0, CMD_SOFTWARE_MODE_1,
-              CMD_SOFTWARE_MODE_2, CMD_SOFTWARE_MODE_3});
-}
+    delete transport;
+    transport = nullptr;
+    connected.store(false);
 
-void CorsairCapellixXTController::SetHardwareMode()
-{
-    Transfer({CMD_HARDWARE_MODE_0, CMD_HARDWARE_MODE_1,
-              CMD_HARDWARE_MODE_2, CMD_HARDWARE_MODE_3});
+    CCLog(CC_LOG_WARN, "%s disconnected (%s), waiting for it to return",
+          serial.c_str(), GetDevicePath().c_str());
 }
 
-void CorsairCapellixXTController::InitLedPorts()
+bool CorsairCapellixXTController::Reconnect()
 {
-    for(int i = 0; i < CC_MAX_LED_CHANNELS; i++)
+    if(connected.load())
     {
-        Transfer({0x14, (uint8_t)i, 0x01});
+        return true;
     }
 
-    std::this_thread::sleep_for(std::chrono::milliseconds(500));
-}
-
-void CorsairCapellixXTController::QueryLEDConfig()
-{
-    channels.clear();
-    total_leds = 0;
-
-    std::vector<uint8_t> resp = ReadEndpoint(MODE_GET_LEDS);
+    if(!reconnect_enabled)
+    {
+        return false;
+    }
 
-    if(resp.size() < CC_LED_START_INDEX + CC_LED_BYTES_PER_CHANNEL)
+    /*-----------------------------------------------------------------*\
+    | The hotplug monitor and the keepalive poll can race here; only     |
+    | one of them gets to reopen the device                             |
+    \*-----------------------------------------------------------------*/
+    std::unique_lock<std::mutex> guard(reconnect_mutex, std::try_to_lock);
+    if(!guard.owns_lock())
     {
-        channels.push_back({0, 33, "Pump Head"});
-        channels.push_back({1,  8, "Fan 1"});
-        channels.push_back({2,  8, "Fan 2"});
-        channels.push_back({3,  8, "Fan 3"});
-        total_leds = 57;
-        return;
+        return false;
     }
 
-    for(unsigned int ch = 0; ch < CC_MAX_LED_CHANNELS; ch++)
+    /*-----------------------------------------------------------------*\
+    | Only the device with this serial is ours. Without a serial on     |
+    | either side a second cooler of the same model could be taken, so  |
+    | there is no reconnect then; nor to a node another controller has  |
+    \*-----------------------------------------------------------------*/
+    if(serial.empty())
     {
-        unsigned int off = CC_LED_START_INDEX + ch * CC_LED_BYTES_PER_CHANNEL;
+        return false;
+    }
 
-        if(off + 3 >= resp.size())
+    CorsairCapellixXTTransport* opened = nullptr;
+    std::string                 new_path;
+    hid_device_info*            devs   = hid_enumerate(CORSAIR_VID, product_id);
+
+    for(hid_device_info* cur = devs; cur != nullptr; cur = cur->next)
+    {
+        if(cur->interface_number != 0 || cur->serial_number == nullptr)
         {
-            break;
+            continue;
         }
 
-        uint8_t  status   = resp[off];
-        uint16_t num_leds = resp[off + 2] | (resp[off + 3] << 8);  // LE uint16
+        std::wstring ws(cur->serial_number);
+        if(std::string(ws.begin(), ws.end()) != serial)
+        {
+            continue;
+        }
 
-        if(status == LED_STATUS_CONNECTED && num_leds > 0)
+        if(CorsairCapellixXTService::Get()->IsPathOwned(cur->path, this))
         {
-            std::string name;
-            if(ch == 0)
-            {
-                name = "Pump Head";
-            }
-            else
-            {
-                name = "Fan/Port " + std::to_string(ch);
-            }
+            continue;
+        }
 
-            channels.push_back({ch, num_leds, name});
-            total_leds += num_leds;
+        opened = CCOpenTransport(cur->path);
+
+        if(opened)
+        {
+            new_path = cur->path;
+            break;
         }
     }
 
-    if(channels.empty())
+    hid_free_enumeration(devs);
+
+    if(opened == nullptr)
     {
-        channels.push_back({0, 33, "Pump Head"});
-        channels.push_back({1,  8, "Fan 1"});
-        channels.push_back({2,  8, "Fan 2"});
-        channels.push_back({3,  8, "Fan 3"});
-        total_leds = 57;
+        return false;
     }
-}
 
-void CorsairCapellixXTController::Initialize()
-{
-    ReadFirmware();
-    SetSoftwareMode();
-    InitLedPorts();
-    QueryLEDConfig();
+    CorsairCapellixXTTransport* new_transport = CCTraceWrapTransport(opened, product_id);
 
-    /*-----------------------------------------------------------------*\
-    | Open color endpoint: close then open (stays open for writes)      |
-    \*-----------------------------------------------------------------*/
-    Transfer({CMD_CLOSE_ENDPOINT_0, CMD_CLOSE_ENDPOINT_1, CMD_CLOSE_ENDPOINT_2},
-             {MODE_SET_COLOR});
-    Transfer({CMD_OPEN_COLOR_ENDPOINT_0, CMD_OPEN_COLOR_ENDPOINT_1},
-             {MODE_SET_COLOR});
+    {
+        std::lock_guard<std::recursive_mutex> lock(io_mutex);
+        std::lock_guard<std::mutex>           info_lock(info_mutex);
+        transport   = new_transport;
+        device_path = new_path;
+        connected.store(true);
+    }
 
-    /*-----------------------------------------------------------------*\
-    | Apply the pump curve once immediately so the pump goes quiet at    |
-    | startup instead of waiting for the first keepalive tick           |
-    \*-----------------------------------------------------------------*/
-    UpdatePumpFromCurve();
+    reconnects++;
+
+    CCLog(CC_LOG_INFO, "%s reconnected at %s, restoring state",
+          serial.c_str(), new_path.c_str());
 
     /*-----------------------------------------------------------------*\
-    | Start keepalive thread to prevent revert to hardware lighting     |
+    | State is replayed on the service thread, right away               |
     \*-----------------------------------------------------------------*/
-    StartKeepalive();
+    replay_pending.store(true);
+    CorsairCapellixXTService::Get()->Wake(this);
+
+    return true;
+}
+
+static int64_t CCSteadyNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
 }
 
 /*---------------------------------------------------------------------*\
-| Color output — matches OpenLinkHub writeColor()                       |
-|                                                                       |
-| Write buffer:                                                         |
-|   [0..1] = LE uint16 size (len(color_data) + 2)                      |
-|   [2..3] = 0x00 0x00  (padding to headerWriteSize=4)                 |
-|   [4..5] = dataTypeSetColor (0x12, 0x00)                             |
-|   [6..]  = RGB color data                                            |
-|                                                                       |
-| Chunked into max_buf_per_request-sized pieces and sent via            |
-| CMD_WRITE_COLOR (first chunk) / CMD_WRITE_COLOR_NEXT (rest).         |
+| Watchdog hooks. The stamps are set by the cooling tick only, never by |
+| the watchdog's own failsafe write, so a stalled loop stays visible.   |
 \*---------------------------------------------------------------------*/
 
-void CorsairCapellixXTController::SendColors(const std::vector<uint8_t>& color_data)
+bool CorsairCapellixXTController::WatchdogExempt()
 {
-    if(color_data.empty())
-    {
+    return !connected.load()
+        || !protocol->has_pump
+        || pump_mode.load() == PUMP_MODE_DISABLED
+        || calibration_progress.load() >= 0;
+}
+
+std::chrono::steady_clock::time_point CorsairCapellixXTController::GetLastSpeedWrite()
+{
+    return std::chrono::steady_clock::time_point(std::chrono::nanoseconds(last_speed_write_ns.load()));
+}
+
+std::chrono::steady_clock::time_point CorsairCapellixXTController::GetLastSensorRead()
+{
+    return std::chrono::steady_clock::time_point(std::chrono::nanoseconds(last_sensor_read_ns.load()));
+}
+
+void CorsairCapellixXTController::SetWatchdogAlarm(const std::string& reason)
+{
+    if(!reason.empty() && !watchdog_alarm.load())
+    {
+        watchdog_alarms++;
+    }
+    watchdog_alarm.store(!reason.empty());
+
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    watchdog_reason = reason;
+}
+
+std::string CorsairCapellixXTController::GetWatchdogAlarm()
+{
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    return watchdog_reason;
+}
+
+void CorsairCapellixXTController::NotifyWatchdog()
+{
+    replay_pending.store(true);
+    CorsairCapellixXTService::Get()->Wake(this);
+}
+
+bool CorsairCapellixXTController::WriteFailsafeSpeeds(int lock_timeout_ms)
+{
+    std::chrono::steady_clock::time_point  give_up = std::chrono::steady_clock::now()
+                                                   + std::chrono::milliseconds(lock_timeout_ms);
+    std::unique_lock<std::recursive_mutex> io_lock(io_mutex, std::try_to_lock);
+
+    while(!io_lock.owns_lock() && std::chrono::steady_clock::now() < give_up)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        io_lock.try_lock();
+    }
+
+    if(!io_lock.owns_lock() || !connected.load() || breaker_open.load())
+    {
+        return false;
+    }
+
+    uint8_t pump_duty;
+    uint8_t fan_duty;
+    {
+        std::lock_guard<std::mutex> lock(curve_mutex);
+        pump_duty = mode_pump_duty[PUMP_MODE_PERFORMANCE];
+        fan_duty  = mode_fan_duty[PUMP_MODE_PERFORMANCE];
+    }
+
+    SetSoftwareMode();
+    return WriteSpeeds(pump_duty, fan_duty);
+}
+
+void CorsairCapellixXTController::NotifyResume()
+{
+    if(!connected.load())
+    {
+        return;     // Reconnect() replays state when it comes back
+    }
+
+    resume_pending.store(true);
+    CorsairCapellixXTService::Get()->Wake(this);
+}
+
+/*---------------------------------------------------------------------*\
+| Bring a freshly reopened device back to where we left it. Cooling     |
+| goes first so the loud hardware-default pump window is as short as    |
+| possible; lighting follows once the LED ports are set up again.       |
+\*---------------------------------------------------------------------*/
+
+void CorsairCapellixXTController::ReplayState()
+{
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        std::fill(init_phase_s, init_phase_s + CC_INIT_PHASE_COUNT, -1.0);
+    }
+
+    std::chrono::steady_clock::time_point t = std::chrono::steady_clock::now();
+
+    SetSoftwareMode();
+    t = RecordInitPhase(CC_INIT_SOFTWARE_MODE, t);
+    UpdatePumpFromCurve();
+    t = RecordInitPhase(CC_INIT_COOLING, t);
+
+    if(!lighting_enabled)
+    {
+        LogInitPhases("state restored");
+        last_commit_time = std::chrono::steady_clock::now();
+        return;
+    }
+
+    InitLedPorts();
+    RecordInitPhase(CC_INIT_LED_PORTS, t);
+
+    /*-----------------------------------------------------------------*\
+    | The color endpoint and frame follow once the ports are ready; the |
+    | service thread polls for that without blocking                    |
+    \*-----------------------------------------------------------------*/
+    StartLedPortPolling();
+    color_restore_pending = true;
+    last_commit_time      = std::chrono::steady_clock::now();
+
+    CorsairCapellixXTService::Get()->Wake(this);
+}
+
+/*---------------------------------------------------------------------*\
+| Core transfer — matches OpenLinkHub cc.go transfer() exactly          |
+|                                                                       |
+| Write packet layout:                                                  |
+|   [0] = 0x00  (HID report ID)                                        |
+|   [1] = 0x08  (fixed protocol header)                                 |
+|   [2..2+len(endpoint)] = endpoint/command bytes                       |
+|   [2+len(endpoint)..] = buffer/payload bytes                          |
+|   ... zero-padded to the variant's write size (CCEncodePacket)        |
+|                                                                       |
+| Each command has a CC_COMMAND_DEADLINE_MS budget split across at most |
+| CC_TRANSFER_ATTEMPTS tries. CMD_WRITE_COLOR_NEXT appends to the frame |
+| being written, so it is never resent.                                 |
+\*---------------------------------------------------------------------*/
+
+TransferResult CorsairCapellixXTController::Transfer(
+    const CCCommand& cmd,
+    CCBytes buf)
+{
+    std::lock_guard<std::recursive_mutex> lock(io_mutex);
+
+    TransferResult result;
+
+    if(transport == nullptr)
+    {
+        result.status = CC_TRANSFER_DISCONNECTED;
+        return result;
+    }
+
+    if(breaker_open.load() && !ProbeBreaker())
+    {
+        result.status = CC_TRANSFER_BREAKER_OPEN;
+        return result;
+    }
+
+    bool idempotent = cmd.length == 0 || cmd.bytes[0] != CMD_WRITE_COLOR_NEXT_0;
+    int  attempts   = idempotent ? CC_TRANSFER_ATTEMPTS : 1;
+
+    std::chrono::steady_clock::time_point start    = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point deadline = start + std::chrono::milliseconds(CC_COMMAND_DEADLINE_MS);
+
+    for(int attempt = 0; attempt < attempts; attempt++)
+    {
+        int remaining_ms = (int)std::chrono::duration_cast<std::chrono::milliseconds>(
+                               deadline - std::chrono::steady_clock::now()).count();
+
+        if(remaining_ms <= 0)
+        {
+            break;
+        }
+
+        result = TransferOnce(cmd, buf, std::min(remaining_ms, CC_READ_TIMEOUT_MS));
+
+        if(result.status != CC_TRANSFER_TIMEOUT)
+        {
+            break;
+        }
+    }
+
+    RecordTransfer(std::chrono::steady_clock::now() - start, result.status);
+
+    /*-----------------------------------------------------------------*\
+    | Only timeouts count toward the breaker. An I/O error means the     |
+    | node is gone, which the reconnect path handles instead.           |
+    \*-----------------------------------------------------------------*/
+    if(result.ok())
+    {
+        consecutive_failures = 0;
+    }
+    else if(result.status == CC_TRANSFER_TIMEOUT && ++consecutive_failures >= CC_BREAKER_THRESHOLD)
+    {
+        breaker_open.store(true);
+        breaker_trips++;
+        next_probe_time = std::chrono::steady_clock::now() + std::chrono::milliseconds(CC_BREAKER_PROBE_MS);
+
+        /*-------------------------------------------------------------*\
+        | A flapping device trips and recovers over and over; report    |
+        | that at most once per CC_BREAKER_LOG_INTERVAL_MS               |
+        \*-------------------------------------------------------------*/
+        breaker_logged = breaker_log.Allow();
+
+        if(breaker_logged)
+        {
+            unsigned int hidden = breaker_log.TakeSuppressed();
+
+            if(hidden > 0)
+            {
+                CCLog(CC_LOG_WARN, "%s not responding, pausing I/O (circuit breaker open, %u earlier trips not logged)",
+                      serial.c_str(), hidden);
+            }
+            else
+            {
+                CCLog(CC_LOG_WARN, "%s not responding, pausing I/O (circuit breaker open)", serial.c_str());
+            }
+        }
+    }
+
+    return result;
+}
+
+TransferResult CorsairCapellixXTController::TransferOnce(
+    const CCCommand& cmd,
+    CCBytes buf,
+    int timeout_ms)
+{
+    TransferResult result;
+
+    uint8_t pkt[CC_MAX_WRITE_SIZE];
+    uint8_t resp[CC_MAX_READ_SIZE];
+
+    /*-----------------------------------------------------------------*\
+    | Drain replies that arrived after an earlier command timed out, so |
+    | they can't be mistaken for the reply to this one                  |
+    \*-----------------------------------------------------------------*/
+    unsigned int drained = 0;
+
+    while(drained < CC_DRAIN_MAX_REPORTS && transport->Read(resp, protocol->read_size, 0) > 0)
+    {
+        drained++;
+    }
+
+    if(drained > 0)
+    {
+        stale_replies += drained;
+    }
+
+    unsigned int pkt_size = protocol->encode_packet(pkt, cmd, buf);
+
+    bytes_written += pkt_size;
+
+    if(transport->Write(pkt, pkt_size) < 0)
+    {
+        MarkDisconnected();
+        result.status = CC_TRANSFER_IO_ERROR;
+        return result;
+    }
+
+    /*-----------------------------------------------------------------*\
+    | Read until a reply that echoes this command arrives. Anything     |
+    | else is a late reply to an earlier command (or an unsolicited     |
+    | report) and is discarded without ending the wait. The blocking    |
+    | read is the only pacing: the next command goes out as soon as     |
+    | the device has answered this one, with no fixed settle sleep.     |
+    \*-----------------------------------------------------------------*/
+    std::chrono::steady_clock::time_point deadline =
+        std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+
+    uint8_t echo = cmd.length == 0 ? 0x00 : cmd.bytes[0];
+
+    while(true)
+    {
+        int wait_ms = (int)std::chrono::duration_cast<std::chrono::milliseconds>(
+                          deadline - std::chrono::steady_clock::now()).count();
+
+        int bytes_read = transport->Read(resp, protocol->read_size, std::max(wait_ms, 0));
+
+        if(bytes_read < 0)
+        {
+            MarkDisconnected();
+            result.status = CC_TRANSFER_IO_ERROR;
+            break;
+        }
+
+        if(bytes_read == 0)
+        {
+            result.status = CC_TRANSFER_TIMEOUT;
+            break;
+        }
+
+        if(bytes_read > CC_REPLY_STATUS_INDEX
+        && resp[0] == 0x00
+        && resp[CC_REPLY_ECHO_INDEX] == echo)
+        {
+            result.status = CC_TRANSFER_OK;
+            result.data.assign(resp, resp + bytes_read);
+            break;
+        }
+
+        stale_replies++;
+    }
+
+    return result;
+}
+
+/*---------------------------------------------------------------------*\
+| Breaker probe: at most once per CC_BREAKER_PROBE_MS, send a firmware  |
+| query with a short reply wait. If it answers, close the breaker and   |
+| ask the service thread to replay state, since a device that stopped   |
+| answering may also have dropped out of software mode.                 |
+\*---------------------------------------------------------------------*/
+
+bool CorsairCapellixXTController::ProbeBreaker()
+{
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+    if(now < next_probe_time)
+    {
+        return false;
+    }
+
+    next_probe_time = now + std::chrono::milliseconds(CC_BREAKER_PROBE_MS);
+
+    TransferResult probe = TransferOnce({CMD_GET_FIRMWARE_0, CMD_GET_FIRMWARE_1}, CCBytes(),
+                                        CC_BREAKER_PROBE_TIMEOUT_MS);
+
+    if(!probe.ok())
+    {
+        return false;
+    }
+
+    breaker_open.store(false);
+    replay_pending.store(true);
+    consecutive_failures = 0;
+
+    if(breaker_logged)
+    {
+        CCLog(CC_LOG_INFO, "%s responding again, resuming I/O", serial.c_str());
+    }
+
+    return true;
+}
+
+bool CorsairCapellixXTController::IsResponding()
+{
+    return connected.load() && !breaker_open.load();
+}
+
+/*---------------------------------------------------------------------*\
+| Read endpoint: close-open-read-close (matches OpenLinkHub read())     |
+| The sequence stops at the first failed command and returns it.        |
+\*---------------------------------------------------------------------*/
+
+TransferResult CorsairCapellixXTController::ReadEndpoint(uint8_t mode)
+{
+    std::lock_guard<std::recursive_mutex> lock(io_mutex);
+
+    const uint8_t mode_buf[1] = { mode };
+
+    TransferResult r = Transfer({CMD_CLOSE_ENDPOINT_0, CMD_CLOSE_ENDPOINT_1, CMD_CLOSE_ENDPOINT_2}, mode_buf);
+    if(!r.ok()) return r;
+
+    r = Transfer({CMD_OPEN_ENDPOINT_0, CMD_OPEN_ENDPOINT_1}, mode_buf);
+    if(!r.ok()) return r;
+
+    TransferResult resp = Transfer({CMD_READ_0, CMD_READ_1}, mode_buf);
+    if(!resp.ok()) return resp;
+
+    Transfer({CMD_CLOSE_ENDPOINT_0, CMD_CLOSE_ENDPOINT_1, CMD_CLOSE_ENDPOINT_2}, mode_buf);
+
+    /*-----------------------------------------------------------------*\
+    | The read reply must report success and carry this endpoint's data |
+    | type; a reply for a different endpoint is a desync, not data      |
+    \*-----------------------------------------------------------------*/
+    uint8_t dt0 = 0x00;
+    uint8_t dt1 = 0x00;
+    bool    typed = true;
+
+    switch(mode)
+    {
+        case MODE_GET_SPEEDS: dt0 = DATA_TYPE_GET_SPEEDS_0; dt1 = DATA_TYPE_GET_SPEEDS_1; break;
+        case MODE_GET_LEDS:   dt0 = DATA_TYPE_GET_LEDS_0;   dt1 = DATA_TYPE_GET_LEDS_1;   break;
+        case MODE_GET_TEMPS:  dt0 = DATA_TYPE_GET_TEMPS_0;  dt1 = DATA_TYPE_GET_TEMPS_1;  break;
+        default:              typed = false;                                              break;
+    }
+
+    const std::vector<uint8_t>& d = resp.data;
+
+    if(d.size() < CC_REPLY_DATA_TYPE_INDEX + 2
+    || d[CC_REPLY_STATUS_INDEX] != CC_REPLY_STATUS_OK
+    || (typed && (d[CC_REPLY_DATA_TYPE_INDEX] != dt0 || d[CC_REPLY_DATA_TYPE_INDEX + 1] != dt1)))
+    {
+        stale_replies++;
+        bad_replies++;
+        resp.status = CC_TRANSFER_BAD_REPLY;
+    }
+
+    return resp;
+}
+
+/*---------------------------------------------------------------------*\
+| Write endpoint: close-open-write-close                                |
+|                                                                       |
+| Write buffer (same wrapping as writeColor):                           |
+|   [0..1] = LE uint16 size (len(data) + 2)                             |
+|   [2..3] = 0x00 0x00  (padding)                                       |
+|   [4..5] = data type                                                  |
+|   [6..]  = data                                                       |
+\*---------------------------------------------------------------------*/
+
+TransferResult CorsairCapellixXTController::WriteEndpoint(
+    uint8_t mode,
+    uint8_t data_type_0,
+    uint8_t data_type_1,
+    CCBytes data)
+{
+    uint8_t write_buf[CC_MAX_WRITE_SIZE];
+
+    /*-----------------------------------------------------------------*\
+    | The buffer is sized for the largest report; a longer payload is   |
+    | a caller bug and is refused rather than copied past its end       |
+    \*-----------------------------------------------------------------*/
+    if(data.size + 6 > CC_MAX_WRITE_SIZE)
+    {
+        TransferResult r;
+
+        CCLog(CC_LOG_ERROR, "%s endpoint write of %zu bytes does not fit %u, not sent",
+              serial.c_str(), data.size, CC_MAX_WRITE_SIZE - 6);
+
+        r.status = CC_TRANSFER_TOO_LONG;
+        return r;
+    }
+
+    uint16_t size = (uint16_t)(data.size + 2);
+
+    write_buf[0] = size & 0xFF;
+    write_buf[1] = (size >> 8) & 0xFF;
+    write_buf[2] = 0x00;
+    write_buf[3] = 0x00;
+    write_buf[4] = data_type_0;
+    write_buf[5] = data_type_1;
+    memcpy(write_buf + 6, data.data, data.size);
+
+    std::lock_guard<std::recursive_mutex> lock(io_mutex);
+
+    const uint8_t mode_buf[1] = { mode };
+
+    TransferResult r = Transfer({CMD_CLOSE_ENDPOINT_0, CMD_CLOSE_ENDPOINT_1, CMD_CLOSE_ENDPOINT_2}, mode_buf);
+    if(!r.ok()) return r;
+
+    r = Transfer({CMD_OPEN_ENDPOINT_0, CMD_OPEN_ENDPOINT_1}, mode_buf);
+    if(!r.ok()) return r;
+
+    TransferResult resp = Transfer({CMD_WRITE_0, CMD_WRITE_1}, CCBytes(write_buf, data.size + 6));
+    if(!resp.ok()) return resp;
+
+    Transfer({CMD_CLOSE_ENDPOINT_0, CMD_CLOSE_ENDPOINT_1, CMD_CLOSE_ENDPOINT_2}, mode_buf);
+
+    return resp;
+}
+
+/*---------------------------------------------------------------------*\
+| Protocol commands                                                     |
+\*---------------------------------------------------------------------*/
+
+void CorsairCapellixXTController::ReadFirmware()
+{
+    std::string fw = QueryFirmwareVersion();
+
+    std::lock_guard<std::mutex> lock(info_mutex);
+    firmware_version = fw;
+}
+
+std::string CorsairCapellixXTController::QueryFirmwareVersion()
+{
+    TransferResult        r    = Transfer({CMD_GET_FIRMWARE_0, CMD_GET_FIRMWARE_1});
+    std::vector<uint8_t>& resp = r.data;
+
+    if(r.ok() && resp.size() >= 7 && resp[CC_REPLY_STATUS_INDEX] == CC_REPLY_STATUS_OK)
+    {
+        uint16_t patch = resp[5] | (resp[6] << 8);  // little-endian
+        return "v" + std::to_string(resp[3]) + "."
+                   + std::to_string(resp[4]) + "."
+                   + std::to_string(patch);
+    }
+
+    return "unknown";
+}
+
+void CorsairCapellixXTController::SetSoftwareMode()
+{
+    Transfer({CMD_SOFTWARE_MODE_0, CMD_SOFTWARE_MODE_1,
+              CMD_SOFTWARE_MODE_2, CMD_SOFTWARE_MODE_3});
+}
+
+void CorsairCapellixXTController::SetHardwareMode()
+{
+    Transfer({CMD_HARDWARE_MODE_0, CMD_HARDWARE_MODE_1,
+              CMD_HARDWARE_MODE_2, CMD_HARDWARE_MODE_3});
+}
+
+void CorsairCapellixXTController::InitLedPorts()
+{
+    for(int i = 0; i < CC_MAX_LED_CHANNELS; i++)
+    {
+        Transfer({0x14, (uint8_t)i, 0x01});
+    }
+
+    led_ports_init_time = std::chrono::steady_clock::now();
+}
+
+/*---------------------------------------------------------------------*\
+| LED port readiness. After port init the device needs a moment before  |
+| the LED config reads back; instead of a fixed wait the config itself  |
+| is polled every CC_LED_READY_POLL_MS, up to CC_LED_READY_TIMEOUT_MS.  |
+| The ports come up one by one, so a read with some channels connected  |
+| may still be missing the rest: the layout counts as ready only once   |
+| two consecutive reads agree. WaitLedPortsReady blocks (first start,   |
+| nothing cached); StartLedPortPolling hands the polling to the service |
+| thread.                                                               |
+\*---------------------------------------------------------------------*/
+
+bool CorsairCapellixXTController::SameLayout(const std::vector<ChannelInfo>& a, const std::vector<ChannelInfo>& b)
+{
+    bool same = a.size() == b.size();
+
+    for(size_t i = 0; same && i < a.size(); i++)
+    {
+        same = a[i].port == b[i].port && a[i].led_count == b[i].led_count;
+    }
+
+    return same;
+}
+
+void CorsairCapellixXTController::StartLedPortPolling()
+{
+    led_ports_ready_time = led_ports_init_time;
+    led_ports_deadline   = led_ports_init_time + std::chrono::milliseconds(CC_LED_READY_TIMEOUT_MS);
+    led_ports_last_read.clear();
+}
+
+/*---------------------------------------------------------------------*\
+| Returns true once the layout is stable. On false, out holds the last  |
+| valid read if there was one (left untouched otherwise), good enough   |
+| for this session but not for the topology cache.                      |
+\*---------------------------------------------------------------------*/
+
+bool CorsairCapellixXTController::WaitLedPortsReady(std::vector<ChannelInfo>& out, unsigned int& out_total)
+{
+    std::chrono::steady_clock::time_point deadline =
+        led_ports_init_time + std::chrono::milliseconds(CC_LED_READY_TIMEOUT_MS);
+
+    std::vector<ChannelInfo> previous;
+    bool                     stable = false;
+
+    while(true)
+    {
+        std::vector<ChannelInfo> found;
+        unsigned int             found_total = 0;
+
+        if(ReadLEDConfig(found, found_total))
+        {
+            stable    = SameLayout(found, previous);
+            previous  = found;
+            out       = found;
+            out_total = found_total;
+        }
+        else
+        {
+            previous.clear();
+        }
+
+        if(stable || !IsResponding() || std::chrono::steady_clock::now() >= deadline)
+        {
+            break;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(CC_LED_READY_POLL_MS));
+    }
+
+    RecordInitPhase(CC_INIT_LED_READY, led_ports_init_time);
+    return stable;
+}
+
+/*---------------------------------------------------------------------*\
+| Read the LED channel layout. Returns false (and leaves out untouched) |
+| when the query fails or reports no connected channel, so callers can  |
+| tell a real layout from a guess.                                      |
+\*---------------------------------------------------------------------*/
+
+bool CorsairCapellixXTController::ReadLEDConfig(std::vector<ChannelInfo>& out, unsigned int& out_total)
+{
+    TransferResult        r    = ReadEndpoint(MODE_GET_LEDS);
+    std::vector<uint8_t>& resp = r.data;
+
+    if(!r.ok() || resp.size() < CC_LED_START_INDEX + CC_LED_BYTES_PER_CHANNEL)
+    {
+        return false;
+    }
+
+    std::vector<ChannelInfo> found;
+    unsigned int             total = 0;
+
+    for(unsigned int ch = 0; ch < CC_MAX_LED_CHANNELS; ch++)
+    {
+        unsigned int off = CC_LED_START_INDEX + ch * CC_LED_BYTES_PER_CHANNEL;
+
+        if(off + 3 >= resp.size())
+        {
+            break;
+        }
+
+        uint8_t  status   = resp[off];
+        uint16_t num_leds = resp[off + 2] | (resp[off + 3] << 8);  // LE uint16
+
+        if(status == LED_STATUS_CONNECTED && num_leds > 0)
+        {
+            std::string name;
+            if(ch == 0)
+            {
+                name = "Pump Head";
+            }
+            else
+            {
+                name = "Fan/Port " + std::to_string(ch);
+            }
+
+            found.push_back({ch, num_leds, name});
+            total += num_leds;
+        }
+    }
+
+    if(found.empty())
+    {
+        return false;
+    }
+
+    out       = found;
+    out_total = total;
+    return true;
+}
+
+void CorsairCapellixXTController::QueryLEDConfig()
+{
+    std::vector<ChannelInfo> found;
+    unsigned int             found_total = 0;
+
+    bool stable = WaitLedPortsReady(found, found_total);
+
+    if(!found.empty())
+    {
+        channels   = found;
+        total_leds = found_total;
+    }
+
+    if(stable)
+    {
+        SaveTopologyCache(GetFirmwareVersion(), channels);
+        return;
+    }
+
+    if(!found.empty())
+    {
+        CCLog(CC_LOG_WARN, "%s LED layout still changing at the deadline, using the last read (%u LEDs), not cached",
+              serial.c_str(), total_leds);
+        return;
+    }
+
+    channels.clear();
+    channels.push_back({0, 33, "Pump Head"});
+    channels.push_back({1,  8, "Fan 1"});
+    channels.push_back({2,  8, "Fan 2"});
+    channels.push_back({3,  8, "Fan 3"});
+    total_leds = 57;
+}
+
+/*---------------------------------------------------------------------*\
+| Topology cache — per-serial file with the firmware version and LED    |
+| channel layout from the last successful query:                        |
+|   firmware v2.10.219                                                  |
+|   keepalive frame         only once the ping keepalive has failed     |
+|   layout padded           only once a trimmed color frame was refused |
+|   channel <port> <led_count> <name>                                   |
+\*---------------------------------------------------------------------*/
+
+bool CorsairCapellixXTController::LoadTopologyCache()
+{
+    std::string path = CCDeviceSettingsPath(CC_TOPOLOGY_FILE_PREFIX, serial);
+    if(path.empty())
+    {
+        return false;
+    }
+    FILE* f = fopen(path.c_str(), "r");
+    if(f == nullptr)
+    {
+        return false;
+    }
+
+    std::vector<ChannelInfo> cached;
+    unsigned int             total = 0;
+    std::string              fw;
+    char                     line[256];
+
+    while(fgets(line, sizeof(line), f) != nullptr)
+    {
+        char         text[128];
+        unsigned int port;
+        unsigned int count;
+        int          name_off = 0;
+
+        line[strcspn(line, "\r\n")] = '\0';
+
+        if(sscanf(line, "firmware %127s", text) == 1)
+        {
+            fw = text;
+        }
+        else if(sscanf(line, "keepalive %127s", text) == 1 && strcmp(text, "frame") == 0)
+        {
+            keepalive_strategy.store(CC_KEEPALIVE_FRAME);
+        }
+        else if(sscanf(line, "layout %127s", text) == 1 && strcmp(text, "padded") == 0)
+        {
+            frame_layout.store(CC_FRAME_LAYOUT_PADDED);
+        }
+        else if(sscanf(line, "channel %u %u %n", &port, &count, &name_off) == 2
+             && name_off > 0
+             && port < CC_MAX_LED_CHANNELS
+             && count > 0)
+        {
+            cached.push_back({port, count, std::string(line + name_off)});
+            total += count;
+        }
+    }
+    fclose(f);
+
+    if(cached.empty())
+    {
+        return false;
+    }
+
+    channels         = cached;
+    total_leds       = total;
+    std::lock_guard<std::mutex> lock(info_mutex);
+    firmware_version = fw.empty() ? "unknown" : fw;
+    return true;
+}
+
+void CorsairCapellixXTController::SaveTopologyCache(const std::string& fw, const std::vector<ChannelInfo>& layout)
+{
+    std::string path = CCDeviceSettingsPath(CC_TOPOLOGY_FILE_PREFIX, serial);
+    if(path.empty())
+    {
+        return;
+    }
+    FILE* f = fopen(path.c_str(), "w");
+    if(f == nullptr)
+    {
+        return;
+    }
+    fprintf(f, "firmware %s\n", fw.c_str());
+    if(keepalive_strategy.load() == CC_KEEPALIVE_FRAME && protocol->has_pump)
+    {
+        fprintf(f, "keepalive frame\n");
+    }
+    if(frame_layout.load() == CC_FRAME_LAYOUT_PADDED)
+    {
+        fprintf(f, "layout padded\n");
+    }
+    for(const ChannelInfo& c : layout)
+    {
+        fprintf(f, "channel %u %u %s\n", c.port, c.led_count, c.name.c_str());
+    }
+    fclose(f);
+}
+
+/*---------------------------------------------------------------------*\
+| Background check of a cached layout against the one the LED ports     |
+| reported once ready (service thread; not called when they never       |
+| became ready, which keeps the cache).                                 |
+| A different layout is saved for the next start, since zones already   |
+| handed to OpenRGB can't be resized. The live channels /               |
+| firmware_version are left alone because the RGBController reads them  |
+| from another thread.                                                  |
+\*---------------------------------------------------------------------*/
+
+void CorsairCapellixXTController::VerifyTopologyCache(const std::vector<ChannelInfo>& found, unsigned int found_total)
+{
+    std::string fw = QueryFirmwareVersion();
+
+    bool same = SameLayout(found, channels);
+
+    if(same && fw == GetFirmwareVersion())
+    {
+        return;
+    }
+
+    if(!same)
+    {
+        CCLog(CC_LOG_WARN, "%s LED layout changed (%u -> %u LEDs), restart OpenRGB to apply",
+              serial.c_str(), total_leds, found_total);
+    }
+
+    SaveTopologyCache(fw, found);
+}
+
+/*---------------------------------------------------------------------*\
+| Open color endpoint: close then open (stays open for writes)          |
+\*---------------------------------------------------------------------*/
+
+void CorsairCapellixXTController::OpenColorEndpoint()
+{
+    std::lock_guard<std::recursive_mutex> lock(io_mutex);
+
+    const uint8_t mode_buf[1] = { MODE_SET_COLOR };
+
+    Transfer({CMD_CLOSE_ENDPOINT_0, CMD_CLOSE_ENDPOINT_1, CMD_CLOSE_ENDPOINT_2}, mode_buf);
+    Transfer({CMD_OPEN_COLOR_ENDPOINT_0, CMD_OPEN_COLOR_ENDPOINT_1}, mode_buf);
+}
+
+void CorsairCapellixXTController::Initialize(bool with_lighting)
+{
+    lighting_enabled = with_lighting;
+    keepalive_strategy.store(protocol->has_pump ? CC_KEEPALIVE_PING : CC_KEEPALIVE_FRAME);
+
+    std::chrono::steady_clock::time_point t = std::chrono::steady_clock::now();
+
+    /*-----------------------------------------------------------------*\
+    | Cooling only (headless daemon): no LED ports, no color endpoint   |
+    \*-----------------------------------------------------------------*/
+    if(!lighting_enabled)
+    {
+        ReadFirmware();
+        t = RecordInitPhase(CC_INIT_FIRMWARE, t);
+        SetSoftwareMode();
+        t = RecordInitPhase(CC_INIT_SOFTWARE_MODE, t);
+        UpdatePumpFromCurve();
+        RecordInitPhase(CC_INIT_COOLING, t);
+        LogInitPhases("initialized");
+        StartKeepalive();
+        return;
+    }
+
+    /*-----------------------------------------------------------------*\
+    | With a cached layout the zones are built right away and the wait  |
+    | for the LED ports + LED query move to the service thread          |
+    \*-----------------------------------------------------------------*/
+    bool cached = LoadTopologyCache();
+
+    if(!cached)
+    {
+        ReadFirmware();
+        t = RecordInitPhase(CC_INIT_FIRMWARE, t);
+    }
+
+    SetSoftwareMode();
+    t = RecordInitPhase(CC_INIT_SOFTWARE_MODE, t);
+    InitLedPorts();
+    t = RecordInitPhase(CC_INIT_LED_PORTS, t);
+
+    if(cached)
+    {
+        StartLedPortPolling();
+        topology_verify_pending = true;
+    }
+    else
+    {
+        QueryLEDConfig();
+        t = std::chrono::steady_clock::now();
+    }
+
+    OpenColorEndpoint();
+    t = RecordInitPhase(CC_INIT_COLOR_ENDPOINT, t);
+
+    /*-----------------------------------------------------------------*\
+    | Apply the pump curve once immediately so the pump goes quiet at    |
+    | startup instead of waiting for the first keepalive tick           |
+    \*-----------------------------------------------------------------*/
+    UpdatePumpFromCurve();
+    RecordInitPhase(CC_INIT_COOLING, t);
+    LogInitPhases(cached ? "initialized from the topology cache" : "initialized");
+
+    /*-----------------------------------------------------------------*\
+    | Hand periodic work (keepalive, cooling) to the service thread     |
+    \*-----------------------------------------------------------------*/
+    StartKeepalive();
+}
+
+/*---------------------------------------------------------------------*\
+| Color output — matches OpenLinkHub writeColor()                       |
+|                                                                       |
+| Write buffer:                                                         |
+|   [0..1] = LE uint16 size (len(color_data) + 2)                      |
+|   [2..3] = 0x00 0x00  (padding to headerWriteSize=4)                 |
+|   [4..5] = dataTypeSetColor (0x12, 0x00)                             |
+|   [6..]  = RGB color data                                            |
+|                                                                       |
+| Chunked into max_payload-sized pieces (per PID) and sent via          |
+| CMD_WRITE_COLOR (first chunk) / CMD_WRITE_COLOR_NEXT (rest).         |
+| In a frame sync group, a synced frame holds its last chunk until the  |
+| other members are ready too.                                          |
+\*---------------------------------------------------------------------*/
+
+void CorsairCapellixXTController::SendColors(const std::vector<uint8_t>& color_data, bool synced)
+{
+    if(color_data.empty())
+    {
+        return;
+    }
+
+    /*-----------------------------------------------------------------*\
+    | Hold the device lock across the multi-chunk write so nothing else |
+    | interleaves on the HID pipe, except that a waiting cooling step   |
+    | gets it between chunks (see below)                                |
+    \*-----------------------------------------------------------------*/
+    std::unique_lock<std::recursive_mutex> io_lock(io_mutex);
+
+    /*-----------------------------------------------------------------*\
+    | Store last colors for keepalive resend                            |
+    \*-----------------------------------------------------------------*/
+    {
+        std::lock_guard<std::mutex> lock(color_mutex);
+        last_colors = color_data;
+    }
+
+    /*-----------------------------------------------------------------*\
+    | Until the firmware has accepted one, a trimmed frame is a trial   |
+    | (pump only, or a last fan filling its slot: nothing to trim)      |
+    \*-----------------------------------------------------------------*/
+    size_t trimmed_bytes = FrameBytes(CC_FRAME_LAYOUT_TRIMMED);
+    bool   trial         = !frame_layout_confirmed
+                        && frame_layout.load() == CC_FRAME_LAYOUT_TRIMMED
+                        && color_data.size() == trimmed_bytes
+                        && trimmed_bytes < FrameBytes(CC_FRAME_LAYOUT_PADDED);
+
+    /*-----------------------------------------------------------------*\
+    | Build write buffer (frame switches to the padded copy if a trial  |
+    | is refused, see below)                                            |
+    \*-----------------------------------------------------------------*/
+    const std::vector<uint8_t>* frame = &color_data;
+    std::vector<uint8_t>        padded;
+    bool                        retry = false;
+
+    uint16_t size = (uint16_t)(frame->size() + 2);
+
+    std::vector<uint8_t>& write_buf = frame_buf;
+
+    /*-----------------------------------------------------------------*\
+    | Chunk and send                                                    |
+    \*-----------------------------------------------------------------*/
+    size_t       offset    = 0;
+    int          chunk_num = 0;
+    unsigned int yields    = 0;
+    bool         refused   = false;
+
+    while(chunk_num == 0 || offset < write_buf.size())
+    {
+        /*-------------------------------------------------------------*\
+        | (Re)start: frame_buf may have been reused while the lock was  |
+        | given up, so it is rebuilt for every attempt                  |
+        \*-------------------------------------------------------------*/
+        if(chunk_num == 0)
+        {
+            write_buf.clear();
+            write_buf.push_back(size & 0xFF);           // LE size low
+            write_buf.push_back((size >> 8) & 0xFF);    // LE size high
+            write_buf.push_back(0x00);                  // padding
+            write_buf.push_back(0x00);                  // padding
+            write_buf.push_back(DATA_TYPE_SET_COLOR_0); // 0x12
+            write_buf.push_back(DATA_TYPE_SET_COLOR_1); // 0x00
+            write_buf.insert(write_buf.end(), frame->begin(), frame->end());
+        }
+
+        /*-------------------------------------------------------------*\
+        | A cooling step is waiting: hand it the device between chunks. |
+        | The frame then starts over with the first-chunk command, so   |
+        | the device never sees a frame spliced around other commands.  |
+        | Cooling steps only run on the service thread, so a waiter is  |
+        | never this thread (keepalive resends run there, recursively   |
+        | locked, and never see one).                                   |
+        \*-------------------------------------------------------------*/
+        if(chunk_num > 0 && yields < CC_COLOR_MAX_YIELDS && cooling_waiters.load() > 0)
+        {
+            io_lock.unlock();
+            {
+                std::unique_lock<std::mutex> lock(priority_mutex);
+                priority_cv.wait_for(lock, std::chrono::milliseconds(CC_COLOR_YIELD_WAIT_MS),
+                                     [this] { return cooling_waiters.load() == 0; });
+            }
+            io_lock.lock();
+
+            yields++;
+            frame_yields++;
+            offset    = 0;
+            chunk_num = 0;
+            continue;
+        }
+
+        size_t chunk_size = write_buf.size() - offset;
+        if(chunk_size > protocol->max_payload)
+        {
+            chunk_size = protocol->max_payload;
+        }
+
+        CCBytes chunk(write_buf.data() + offset, chunk_size);
+
+        /*-------------------------------------------------------------*\
+        | Last chunk of a synced frame: wait for the group, then send   |
+        | at this device's start time. Leaving the round for a cooling  |
+        | step goes through the yield above. The wait for the start     |
+        | time is sliced the same way, and a cooling step that turns up |
+        | during it ends the wait: the frame yields if it still can,    |
+        | else its last chunk goes out now and cooling follows it.      |
+        \*-------------------------------------------------------------*/
+        CCFrameSlot slot      = { 0, std::chrono::steady_clock::time_point(), false };
+        bool        can_yield = chunk_num > 0 && yields < CC_COLOR_MAX_YIELDS;
+
+        if(synced && frame_sync != nullptr && offset + chunk_size == write_buf.size())
+        {
+            slot = frame_sync->Arrive(this, can_yield);
+
+            if(slot.yield)
+            {
+                continue;
+            }
+
+            std::chrono::steady_clock::time_point t = std::chrono::steady_clock::now();
+
+            while(slot.round != 0 && t < slot.start && !CoolingWaiting())
+            {
+                std::this_thread::sleep_until(std::min(slot.start, t + std::chrono::milliseconds(CC_FRAME_SYNC_SLICE_MS)));
+                t = std::chrono::steady_clock::now();
+            }
+
+            if(slot.round != 0 && can_yield && CoolingWaiting())
+            {
+                frame_sync->Committed(this, slot.round, false, t, t);
+                continue;
+            }
+        }
+
+        std::chrono::steady_clock::time_point sent = std::chrono::steady_clock::now();
+
+        TransferResult r;
+
+        if(chunk_num == 0)
+        {
+            r = Transfer({CMD_WRITE_COLOR_0, CMD_WRITE_COLOR_1}, chunk);
+        }
+        else
+        {
+            r = Transfer({CMD_WRITE_COLOR_NEXT_0, CMD_WRITE_COLOR_NEXT_1}, chunk);
+        }
+
+        if(slot.round != 0)
+        {
+            frame_sync->Committed(this, slot.round, r.ok(), sent, std::chrono::steady_clock::now());
+        }
+
+        /*-------------------------------------------------------------*\
+        | Abandon the rest of the frame; the keepalive resends it       |
+        \*-------------------------------------------------------------*/
+        if(!r.ok())
+        {
+            frames_skipped++;
+
+            /*---------------------------------------------------------*\
+            | A lost padded retry is no verdict: trial again next frame |
+            \*---------------------------------------------------------*/
+            if(retry)
+            {
+                frame_layout.store(CC_FRAME_LAYOUT_TRIMMED);
+
+                std::lock_guard<std::mutex> lock(color_mutex);
+                last_colors = color_data;
+            }
+
+            return;
+        }
+
+        /*-------------------------------------------------------------*\
+        | Writes are not validated by Transfer(); the status byte is    |
+        | the only sign of a frame the firmware did not take            |
+        \*-------------------------------------------------------------*/
+        refused = refused || (r.data.size() > CC_REPLY_STATUS_INDEX && r.data[CC_REPLY_STATUS_INDEX] != CC_REPLY_STATUS_OK);
+
+        offset += chunk_size;
+        chunk_num++;
+
+        /*-------------------------------------------------------------*\
+        | Trimmed trial refused. A bad status alone proves little, so   |
+        | the same colors go out padded at once, still under this lock: |
+        | unsynced and without yields, so nothing runs in between.      |
+        \*-------------------------------------------------------------*/
+        if(trial && refused && offset == write_buf.size())
+        {
+            padded = color_data;
+            padded.resize(FrameBytes(CC_FRAME_LAYOUT_PADDED), 0x00);
+            frame_layout.store(CC_FRAME_LAYOUT_PADDED);
+
+            {
+                std::lock_guard<std::mutex> lock(color_mutex);
+                last_colors = padded;
+            }
+
+            frame     = &padded;
+            size      = (uint16_t)(frame->size() + 2);
+            trial     = false;
+            retry     = true;
+            refused   = false;
+            synced    = false;
+            yields    = CC_COLOR_MAX_YIELDS;
+            offset    = 0;
+            chunk_num = 0;
+        }
+    }
+
+    frames_sent++;
+    last_commit_time = std::chrono::steady_clock::now();
+    pinged_since_frame.store(false);
+
+    /*-----------------------------------------------------------------*\
+    | Settle the trial. Padded taken: keep it, also for later starts    |
+    | (topology cache). Padded refused as well: the status byte does    |
+    | not tell the layouts apart on this firmware, so trimmed stays and |
+    | the trial ends here instead of doubling every frame.              |
+    \*-----------------------------------------------------------------*/
+    if(retry && !refused)
+    {
+        frame_layout_confirmed = true;
+
+        CCLog(CC_LOG_WARN, "%s rejected the trimmed color frame, padding every fan slot",
+              serial.c_str());
+
+        SaveTopologyCache(GetFirmwareVersion(), channels);
+    }
+    else if(retry)
+    {
+        frame_layout.store(CC_FRAME_LAYOUT_TRIMMED);
+        frame_layout_confirmed = true;
+
+        {
+            std::lock_guard<std::mutex> lock(color_mutex);
+            last_colors = color_data;
+        }
+
+        CCLog(CC_LOG_WARN, "%s refused the padded color frame too, status not layout related, keeping the trimmed frame",
+              serial.c_str());
+    }
+    else if(trial)
+    {
+        frame_layout_confirmed = true;
+
+        CCLog(CC_LOG_INFO, "%s accepts the trimmed color frame: %zu bytes in %d chunks instead of %zu",
+              serial.c_str(), color_data.size(), chunk_num, FrameBytes(CC_FRAME_LAYOUT_PADDED));
+    }
+}
+
+/*---------------------------------------------------------------------*\
+| Pump / fan speed control (endpoint 0x18, dataType 0x07 0x00)          |
+|                                                                       |
+| Speed buffer (one channel here, the pump):                            |
+|   [0]    = channel count (1)                                          |
+|   [1..4] = { channel, mode(0=percent), duty, 0x00 }                   |
+| Wrapped like writeColor: LE16 size, 0x00 0x00 pad, dataType, data.    |
+\*---------------------------------------------------------------------*/
+
+void CorsairCapellixXTController::SetPumpDuty(uint8_t duty)
+{
+    /*-----------------------------------------------------------------*\
+    | SAFETY: clamp to a floor so the pump never stops (no flow).        |
+    | Measured: <=10% => 0 rpm, 20% => ~690 rpm, 30% => ~1150 rpm.       |
+    \*-----------------------------------------------------------------*/
+    {
+        std::lock_guard<std::mutex> lock(curve_mutex);
+        if(duty < pump_floor) duty = pump_floor;
+    }
+    if(duty < PUMP_DUTY_MIN) duty = PUMP_DUTY_MIN;
+    if(duty > PUMP_DUTY_MAX) duty = PUMP_DUTY_MAX;
+
+    if(!protocol->has_pump)
+    {
+        return;
+    }
+
+    uint8_t      speed_data[CC_MAX_SPEED_PAYLOAD];
+    unsigned int speed_size = protocol->encode_pump_speed(speed_data, duty);
+
+    if(WriteEndpoint(MODE_SET_SPEED, DATA_TYPE_SET_SPEED_0, DATA_TYPE_SET_SPEED_1,
+                     CCBytes(speed_data, speed_size)).ok())
+    {
+        last_pump_duty.store(duty);
+    }
+}
+
+/*---------------------------------------------------------------------*\
+| Read AIO liquid temperature (channel 0 of the temperature endpoint)   |
+|   response[6]   = status (0x00 == connected)                          |
+|   response[7:9] = temperature * 10, little-endian                     |
+\*---------------------------------------------------------------------*/
+
+float CorsairCapellixXTController::ReadLiquidTemp()
+{
+    if(!protocol->has_pump)
+    {
+        return -1.0f;
+    }
+
+    std::lock_guard<std::recursive_mutex> lock(io_mutex);
+
+    TransferResult        r    = ReadEndpoint(MODE_GET_TEMPS);
+    std::vector<uint8_t>& resp = r.data;
+
+    if(!r.ok() || resp.size() < 9)
+    {
+        return -1.0f;
+    }
+    if(resp[6] != 0x00)
+    {
+        return -1.0f;
+    }
+
+    int16_t raw   = (int16_t)(resp[7] | (resp[8] << 8));
+    float   tempC = (float)raw / 10.0f;
+
+    /*-----------------------------------------------------------------*\
+    | Plausibility: reject out-of-range values outright, and hold back  |
+    | a sudden jump until the next reading confirms it                  |
+    \*-----------------------------------------------------------------*/
+    if(tempC < CC_LIQUID_TEMP_MIN_C || tempC > CC_LIQUID_TEMP_MAX_C)
+    {
+        rejected_readings++;
+        return -1.0f;
+    }
+
+    float last = last_liquid_temp.load();
+
+    if(last > 0.0f && std::fabs(tempC - last) > CC_LIQUID_TEMP_MAX_STEP_C)
+    {
+        bool confirmed = suspect_liquid_temp >= 0.0f
+                      && std::fabs(tempC - suspect_liquid_temp) <= CC_LIQUID_TEMP_MAX_STEP_C;
+
+        if(!confirmed)
+        {
+            suspect_liquid_temp = tempC;
+            rejected_readings++;
+            return -1.0f;
+        }
+    }
+
+    suspect_liquid_temp = -1.0f;
+    return tempC;
+}
+
+/*---------------------------------------------------------------------*\
+| Read every speed channel in one endpoint read                         |
+|   response[5]            = channel count                              |
+|   response[6+2i..8+2i]   = channel i RPM, little-endian               |
+| Implausible values are reported as -1.                                |
+\*---------------------------------------------------------------------*/
+
+bool CorsairCapellixXTController::ReadSpeeds(std::vector<int>& rpm)
+{
+    TransferResult        r    = ReadEndpoint(MODE_GET_SPEEDS);
+    std::vector<uint8_t>& resp = r.data;
+
+    rpm.clear();
+
+    if(!r.ok() || resp.size() < 8)
+    {
+        return false;
+    }
+
+    unsigned int count = resp[5];
+
+    for(unsigned int ch = 0; ch < count && 7 + ch * 2 < resp.size(); ch++)
+    {
+        int value = (int)(int16_t)(resp[6 + ch * 2] | (resp[7 + ch * 2] << 8));
+
+        if(value < 0 || value > CC_RPM_MAX)
+        {
+            rejected_readings++;
+            value = -1;
+        }
+
+        rpm.push_back(value);
+    }
+
+    return !rpm.empty();
+}
+
+/*---------------------------------------------------------------------*\
+| Read pump RPM (channel 0 of the speeds endpoint)                      |
+\*---------------------------------------------------------------------*/
+
+int CorsairCapellixXTController::ReadPumpRpm()
+{
+    std::vector<int> rpm;
+
+    if(!ReadSpeeds(rpm) || rpm.size() <= PUMP_CHANNEL)
+    {
+        return -1;
+    }
+
+    return rpm[PUMP_CHANNEL];
+}
+
+/*---------------------------------------------------------------------*\
+| Read first radiator fan RPM (speed channel 1)                         |
+\*---------------------------------------------------------------------*/
+
+int CorsairCapellixXTController::ReadFanRpm()
+{
+    std::vector<int> rpm;
+
+    if(!ReadSpeeds(rpm) || rpm.size() <= FAN_CHANNEL_FIRST)
+    {
+        return -1;
+    }
+
+    return rpm[FAN_CHANNEL_FIRST];
+}
+
+/*---------------------------------------------------------------------*\
+| Drive pump (channel 0) and all radiator fans (channels 1..6) in a     |
+| single speed write. Fans are clamped to their floor so they never     |
+| stall (FAN_DUTY_MIN, or the calibrated stall duty plus a margin); the |
+| pump to its floor, never below PUMP_DUTY_MIN.                         |
+\*---------------------------------------------------------------------*/
+
+bool CorsairCapellixXTController::SetCooling(uint8_t pump_duty, uint8_t fan_duty)
+{
+    {
+        std::lock_guard<std::mutex> lock(curve_mutex);
+        if(pump_duty < pump_floor) pump_duty = pump_floor;
+        if(fan_duty  < fan_floor)  fan_duty  = fan_floor;
+    }
+
+    return WriteSpeeds(pump_duty, fan_duty);
+}
+
+/*---------------------------------------------------------------------*\
+| The one speed write path. The calibration sweep calls it directly so  |
+| the fans can be taken below their floor to find the stall; the pump   |
+| clamp here is the hard safety floor and applies to every caller.      |
+\*---------------------------------------------------------------------*/
+
+bool CorsairCapellixXTController::WriteSpeeds(uint8_t pump_duty, uint8_t fan_duty)
+{
+    if(pump_duty < PUMP_DUTY_MIN) pump_duty = PUMP_DUTY_MIN;
+    if(pump_duty > PUMP_DUTY_MAX) pump_duty = PUMP_DUTY_MAX;
+    if(fan_duty  > 100)           fan_duty  = 100;
+
+    if(!protocol->has_pump)
+    {
+        return false;
+    }
+
+    /*-----------------------------------------------------------------*\
+    | Pump on channel 0, fans on 1..6 (unconnected ports are harmlessly |
+    | ignored)                                                          |
+    \*-----------------------------------------------------------------*/
+    uint8_t      speed_data[CC_MAX_SPEED_PAYLOAD];
+    unsigned int speed_size = protocol->encode_speeds(speed_data, pump_duty, fan_duty);
+
+    if(!WriteEndpoint(MODE_SET_SPEED, DATA_TYPE_SET_SPEED_0, DATA_TYPE_SET_SPEED_1,
+                      CCBytes(speed_data, speed_size)).ok())
+    {
+        return false;
+    }
+
+    last_pump_duty.store(pump_duty);
+    last_fan_duty.store(fan_duty);
+    return true;
+}
+
+/*---------------------------------------------------------------------*\
+| Linear interpolation across the pump curve                            |
+\*---------------------------------------------------------------------*/
+
+uint8_t CorsairCapellixXTController::EvalCurve(const std::vector<CurvePoint>& curve, float tempC)
+{
+    if(curve.empty())
+    {
+        return PUMP_DUTY_MIN;
+    }
+
+    if(tempC <= curve.front().tempC)
+    {
+        return curve.front().duty;
+    }
+    if(tempC >= curve.back().tempC)
+    {
+        return curve.back().duty;
+    }
+
+    for(size_t i = 1; i < curve.size(); i++)
+    {
+        const CurvePoint& a = curve[i - 1];
+        const CurvePoint& b = curve[i];
+        if(tempC <= b.tempC)
+        {
+            float span = b.tempC - a.tempC;
+            float frac = span > 0.0f ? (tempC - a.tempC) / span : 0.0f;
+            float duty = a.duty + frac * ((float)b.duty - (float)a.duty);
+            return (uint8_t)(duty + 0.5f);
+        }
+    }
+
+    return curve.back().duty;
+}
+
+/*---------------------------------------------------------------------*\
+| Read liquid temp, evaluate the curve, drive the pump                  |
+\*---------------------------------------------------------------------*/
+
+void CorsairCapellixXTController::UpdatePumpFromCurve()
+{
+    if(!connected.load() || !protocol->has_pump)
+    {
+        return;
+    }
+
+    if(CoolingReadSensors())
+    {
+        CoolingApply();
+        CoolingReadSpeeds();
+    }
+}
+
+const char* CorsairCapellixXTController::PumpModeName(int mode)
+{
+    switch(mode)
+    {
+        case PUMP_MODE_SILENT:       return "Silent";
+        case PUMP_MODE_QUIET:        return "Quiet";
+        case PUMP_MODE_BALANCED:     return "Balanced";
+        case PUMP_MODE_PERFORMANCE:  return "Performance";
+        case PUMP_MODE_DISABLED:     return "Disabled";
+        case PUMP_MODE_TARGET:       return "Target";
+        case PUMP_MODE_AUTO:
+        default:                     return "Auto";
+    }
+}
+
+/*---------------------------------------------------------------------*\
+| Cooling tick, split so the service thread can run it one endpoint     |
+| transaction at a time:                                                |
+|   CoolingReadSensors -> CoolingApply -> CoolingReadSpeeds             |
+| Returns false when the tick should stop (Disabled mode).              |
+\*---------------------------------------------------------------------*/
+
+bool CorsairCapellixXTController::CoolingReadSensors()
+{
+    if(pump_mode.load() == PUMP_MODE_DISABLED)
+    {
+        /*-------------------------------------------------------------*\
+        | Hands off: don't send any speed commands so the pump/fans run |
+        | on their own (or under an external tool). RGB is unaffected.  |
+        \*-------------------------------------------------------------*/
+        if(logged_mode != PUMP_MODE_DISABLED)
+        {
+            CCLog(CC_LOG_INFO, "serial=%s mode=Disabled (pump/fans not managed)", serial.c_str());
+            logged_mode = PUMP_MODE_DISABLED;
+        }
+        return false;
+    }
+
+    tick_liquid_temp = ReadLiquidTemp();
+    if(tick_liquid_temp >= 0.0f)
+    {
+        last_liquid_temp.store(tick_liquid_temp);
+        last_sensor_read_ns.store(CCSteadyNs());
+    }
+
+    ReadFanSources();
+
+    return true;
+}
+
+/*---------------------------------------------------------------------*\
+| hwmon fan sources: one pread() per source per tick, cached in hwmon   |
+| for CoolingApply and copied for the metrics                           |
+\*---------------------------------------------------------------------*/
+
+void CorsairCapellixXTController::ReadFanSources()
+{
+    {
+        std::lock_guard<std::mutex> lock(curve_mutex);
+
+        if(fan_sources_changed)
+        {
+            hwmon.Open(fan_sources);
+            fan_sources_changed = false;
+        }
+    }
+
+    std::vector<std::pair<std::string, float>> readings;
+
+    hwmon.ReadAll();
+
+    for(size_t i = 0; i < hwmon.Count(); i++)
+    {
+        if(hwmon.Valid(i))
+        {
+            readings.push_back({hwmon.Name(i), hwmon.Temp(i)});
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    last_fan_sources.swap(readings);
+}
+
+void CorsairCapellixXTController::CoolingApply()
+{
+    float   tempC = tick_liquid_temp;
+    uint8_t pump_duty;
+    uint8_t fan_duty;
+
+    int     mode = pump_mode.load();
+
+    switch(mode)
+    {
+        case PUMP_MODE_SILENT:
+        case PUMP_MODE_QUIET:
+        case PUMP_MODE_BALANCED:
+        case PUMP_MODE_PERFORMANCE:
+            {
+                std::lock_guard<std::mutex> lock(curve_mutex);
+                pump_duty = profile_pump_duty >= 0 ? (uint8_t)profile_pump_duty : mode_pump_duty[mode];
+                fan_duty  = profile_fan_duty  >= 0 ? (uint8_t)profile_fan_duty  : mode_fan_duty[mode];
+            }
+            break;
+        case PUMP_MODE_TARGET:
+            TargetDuties(pump_duty, fan_duty);
+            break;
+        case PUMP_MODE_AUTO:
+        default:
+            if(tempC >= 0.0f)
+            {
+                float curve_temp = tempC + FeedForwardBoost();
+                float fan_temp   = curve_temp;
+                float source_temp;
+
+                std::lock_guard<std::mutex> lock(curve_mutex);
+
+                /*-----------------------------------------------------*\
+                | With fan sources the fans follow the hottest of them, |
+                | the liquid only if listed; with none readable they    |
+                | fall back to the liquid                               |
+                \*-----------------------------------------------------*/
+                if(hwmon.Hottest(source_temp))
+                {
+                    fan_temp = fan_source_liquid ? std::max(curve_temp, source_temp) : source_temp;
+                }
+
+                pump_duty = EvalCurve(profile_pump_curve.empty() ? pump_curve : profile_pump_curve, curve_temp);
+                fan_duty  = EvalCurve(profile_fan_curve.empty()  ? fan_curve  : profile_fan_curve,  fan_temp);
+            }
+            else
+            {
+                pump_duty = last_pump_duty.load();
+                fan_duty  = last_fan_duty.load();
+            }
+            break;
+    }
+
+    last_applied_mode = mode;
+    tick_write_failed = !SetCooling(pump_duty, fan_duty);
+
+    if(!tick_write_failed)
+    {
+        last_speed_write_ns.store(CCSteadyNs());
+    }
+}
+
+/*---------------------------------------------------------------------*\
+| Target RPM mode. Feed-forward from the duty->RPM model, feedback as   |
+| an RPM correction on the model's input: each allowed change moves the |
+| correction by CC_TARGET_GAIN_PCT of the error last measured, so a     |
+| model that is off by a constant factor still converges in a few       |
+| ticks. The measurement is the previous tick's speed read, taken       |
+| PUMP_UPDATE_INTERVAL_SEC after that tick's write. Changes are at      |
+| least CC_TARGET_MIN_CHANGE_SEC apart, so each one is judged on a      |
+| settled reading and the duty moves a bounded number of times a       |
+| minute.                                                               |
+\*---------------------------------------------------------------------*/
+
+void CCUpdateTargetCorrection(float& correction, int target, int measured)
+{
+    int error = target - measured;
+
+    if(measured < 0 || std::abs(error) <= CC_TARGET_DEADBAND_RPM)
+    {
+        return;
+    }
+
+    float limit = target * CC_TARGET_MAX_CORRECTION_PCT / 100.0f;
+
+    correction += error * CC_TARGET_GAIN_PCT / 100.0f;
+    correction  = std::max(-limit, std::min(limit, correction));
+}
+
+void CorsairCapellixXTController::TargetDuties(uint8_t& pump_duty, uint8_t& fan_duty)
+{
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+    bool entering = last_applied_mode != PUMP_MODE_TARGET;
+
+    if(entering || targets_changed.exchange(false))
+    {
+        pump_target_correction = 0.0f;
+        fan_target_correction  = 0.0f;
+        target_last_change     = std::chrono::steady_clock::time_point();
+    }
+
+    pump_duty = last_pump_duty.load();
+    fan_duty  = last_fan_duty.load();
+
+    if(now - target_last_change < std::chrono::seconds(CC_TARGET_MIN_CHANGE_SEC))
+    {
+        return;
+    }
+
+    /*-----------------------------------------------------------------*\
+    | Fans: mean of the channels that are spinning                      |
+    \*-----------------------------------------------------------------*/
+    int pump_rpm = -1;
+    int fan_rpm  = -1;
+
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex);
+
+        int sum   = 0;
+        int count = 0;
+
+        for(unsigned int ch = FAN_CHANNEL_FIRST; ch <= FAN_CHANNEL_LAST && ch < last_rpms.size(); ch++)
+        {
+            if(last_rpms[ch] >= CC_CALIBRATION_STALL_RPM)
+            {
+                sum += last_rpms[ch];
+                count++;
+            }
+        }
+
+        pump_rpm = last_rpms.size() > PUMP_CHANNEL ? last_rpms[PUMP_CHANNEL] : -1;
+        fan_rpm  = count > 0 ? sum / count : -1;
+    }
+
+    std::lock_guard<std::mutex> lock(curve_mutex);
+
+    if(!entering)
+    {
+        CCUpdateTargetCorrection(pump_target_correction, pump_target_rpm, pump_rpm);
+        CCUpdateTargetCorrection(fan_target_correction,  fan_target_rpm,  fan_rpm);
+    }
+
+    int pump = speed_model.DutyForRpm(PUMP_CHANNEL, (int)(pump_target_rpm + pump_target_correction));
+    int fan  = -1;
+
+    for(unsigned int ch = FAN_CHANNEL_FIRST; ch <= FAN_CHANNEL_LAST; ch++)
+    {
+        fan = std::max(fan, speed_model.DutyForRpm(ch, (int)(fan_target_rpm + fan_target_correction)));
+    }
+
+    uint8_t new_pump = (uint8_t)std::max<int>(pump < 0 ? PUMP_DUTY_QUIET : pump, pump_floor);
+    uint8_t new_fan  = (uint8_t)std::max<int>(fan  < 0 ? FAN_DUTY_QUIET  : fan,  fan_floor);
+
+    if(entering || new_pump != pump_duty || new_fan != fan_duty)
+    {
+        target_last_change = now;
+    }
+
+    pump_duty = new_pump;
+    fan_duty  = new_fan;
+}
+
+/*---------------------------------------------------------------------*\
+| Feed-forward from CPU load (Auto mode). The liquid lags a load step   |
+| by tens of seconds, so a burst that lasts a couple of ticks moves the |
+| curves ahead of the coolant. The boost is a temperature offset rather |
+| than a duty, so it follows the shape of the curves and can never take |
+| them below what the liquid asks for. Load is sampled only while this  |
+| runs, so modes other than Auto do not keep the file open busy.        |
+\*---------------------------------------------------------------------*/
+
+float CorsairCapellixXTController::FeedForwardBoost()
+{
+    float max_c;
+    {
+        std::lock_guard<std::mutex> lock(curve_mutex);
+        max_c = feedforward_max_c;
+    }
+
+    if(max_c <= 0.0f)
+    {
+        return 0.0f;
+    }
+
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+    int load = cpu_load.Sample();
+
+    if(load < CC_FF_LOAD_START_PCT)
+    {
+        if(++ff_quiet_ticks >= CC_FF_REARM_TICKS)
+        {
+            ff_busy_ticks = 0;
+
+            if(ff_logged)
+            {
+                CCLog(CC_LOG_INFO, "serial=%s load burst over, curves follow the liquid temperature", serial.c_str());
+                ff_logged = false;
+            }
+        }
+        return 0.0f;
+    }
+
+    ff_quiet_ticks = 0;
+
+    if(ff_busy_ticks < CC_FF_SUSTAIN_TICKS && ++ff_busy_ticks == CC_FF_SUSTAIN_TICKS)
+    {
+        ff_burst_start = now;
+    }
+
+    if(ff_busy_ticks < CC_FF_SUSTAIN_TICKS)
+    {
+        return 0.0f;
+    }
+
+    float elapsed = std::chrono::duration<float>(now - ff_burst_start).count();
+    float fade    = elapsed <= CC_FF_HOLD_SEC ? 1.0f
+                  : std::max(0.0f, 1.0f - (elapsed - CC_FF_HOLD_SEC) / CC_FF_FADE_SEC);
+    float boost   = max_c * (load - CC_FF_LOAD_START_PCT) / (100.0f - CC_FF_LOAD_START_PCT) * fade;
+
+    if(!ff_logged && boost > 0.0f)
+    {
+        CCLog(CC_LOG_INFO, "serial=%s cpu_load=%d%% pre-ramping, curves see liquid +%.1f C",
+              serial.c_str(), load, boost);
+        ff_logged = true;
+    }
+
+    return boost;
+}
+
+void CorsairCapellixXTController::CoolingReadSpeeds()
+{
+    std::vector<int> rpm;
+    bool             speeds_ok = ReadSpeeds(rpm);
+
+    if(speeds_ok && rpm.size() > FAN_CHANNEL_FIRST)
+    {
+        last_pump_rpm.store(rpm[PUMP_CHANNEL]);
+        last_fan_rpm.store(rpm[FAN_CHANNEL_FIRST]);
+        last_sensor_read_ns.store(CCSteadyNs());
+    }
+    else
+    {
+        last_pump_rpm.store(-1);
+        last_fan_rpm.store(-1);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        last_rpms = rpm;
+    }
+
+    /*-----------------------------------------------------------------*\
+    | Status line: info when the mode or a duty changed, debug on every |
+    | other tick                                                        |
+    \*-----------------------------------------------------------------*/
+    int     mode      = pump_mode.load();
+    uint8_t pump_duty = last_pump_duty.load();
+    uint8_t fan_duty  = last_fan_duty.load();
+    bool    changed   = mode != logged_mode || pump_duty != logged_pump_duty || fan_duty != logged_fan_duty;
+
+    logged_mode      = mode;
+    logged_pump_duty = pump_duty;
+    logged_fan_duty  = fan_duty;
+
+    CCLog(changed ? CC_LOG_INFO : CC_LOG_DEBUG,
+          "serial=%s mode=%s liquid_c=%.1f pump_duty=%u pump_rpm=%d fan_duty=%u fan_rpm=%d",
+          serial.c_str(), PumpModeName(mode), tick_liquid_temp,
+          (unsigned)pump_duty, last_pump_rpm.load(), (unsigned)fan_duty, last_fan_rpm.load());
+
+    CheckHardwareRevert(rpm);
+    RecordTelemetry(rpm, speeds_ok);
+}
+
+/*---------------------------------------------------------------------*\
+| A device that dropped back to hardware mode ignores our speed writes  |
+| and runs the pump on its own curve. Flag that when the pump is well   |
+| above the speed model for the written duty on consecutive ticks with  |
+| an unchanged duty, and replay state. If only pings kept it alive      |
+| since the last frame, the firmware wants frames: switch the keepalive |
+| over and remember that in the topology cache.                         |
+\*---------------------------------------------------------------------*/
+
+void CorsairCapellixXTController::CheckHardwareRevert(const std::vector<int>& rpm)
+{
+    uint8_t duty = last_pump_duty.load();
+
+    if(rpm.size() <= PUMP_CHANNEL || rpm[PUMP_CHANNEL] < 0
+    || last_applied_mode == PUMP_MODE_DISABLED || duty != revert_duty)
+    {
+        revert_ticks = 0;
+        revert_duty  = duty;
+        return;
+    }
+
+    int expected;
+    {
+        std::lock_guard<std::mutex> lock(curve_mutex);
+        expected = speed_model.RpmForDuty(PUMP_CHANNEL, duty);
+    }
+
+    int excess = rpm[PUMP_CHANNEL] - expected;
+
+    if(expected < 0 || excess < CC_REVERT_MIN_RPM_DELTA || excess * 100 < expected * CC_REVERT_MIN_RPM_PCT)
+    {
+        revert_ticks = 0;
+        return;
+    }
+
+    if(++revert_ticks < CC_REVERT_TICKS)
+    {
+        return;
+    }
+
+    revert_ticks = 0;
+
+    CCLog(CC_LOG_WARN, "%s pump at %d rpm for %u%% duty (expected about %d), device fell back to hardware mode, restoring",
+          serial.c_str(), rpm[PUMP_CHANNEL], (unsigned)duty, expected);
+
+    if(pinged_since_frame.load() && keepalive_strategy.exchange(CC_KEEPALIVE_FRAME) == CC_KEEPALIVE_PING)
+    {
+        CCLog(CC_LOG_WARN, "%s does not accept the ping keepalive, resending the color frame instead",
+              serial.c_str());
+
+        if(lighting_enabled && !channels.empty())
+        {
+            SaveTopologyCache(GetFirmwareVersion(), channels);
+        }
+    }
+
+    replay_pending.store(true);
+}
+
+/*---------------------------------------------------------------------*\
+| One history record per cooling tick. Opening the segment is the only  |
+| file work and happens once; after that a record is a memcpy into the  |
+| mapping. Replayed traces are not recorded, so a replay cannot mix     |
+| into the real device's history.                                       |
+\*---------------------------------------------------------------------*/
+
+void CorsairCapellixXTController::RecordTelemetry(const std::vector<int>& rpm, bool speeds_ok)
+{
+    if(!telemetry_opened)
+    {
+        telemetry_opened = true;
+
+        bool replay;
+        {
+            std::lock_guard<std::recursive_mutex> lock(io_mutex);
+            replay = transport != nullptr && !transport->CanReconnect();
+        }
+
+        if(replay || !telemetry.Open(serial))
+        {
+            return;
+        }
+    }
+
+    if(!telemetry.IsOpen())
+    {
+        return;
+    }
+
+    CCTelemetryRecord record;
+    memset(&record, 0, sizeof(record));
+
+    unsigned int rejected = rejected_readings.load();
+
+    if(tick_liquid_temp < 0.0f)          record.flags |= CC_TELEMETRY_TEMP_INVALID;
+    if(!speeds_ok)                       record.flags |= CC_TELEMETRY_SPEED_FAILED;
+    if(tick_write_failed)                record.flags |= CC_TELEMETRY_WRITE_FAILED;
+    if(breaker_open.load())              record.flags |= CC_TELEMETRY_BREAKER_OPEN;
+    if(rejected != telemetry_rejected)   record.flags |= CC_TELEMETRY_REJECTED;
+    telemetry_rejected = rejected;
+
+    record.liquid_decidegrees = tick_liquid_temp >= 0.0f ? (int16_t)std::lround(tick_liquid_temp * 10.0f)
+                                                         : (int16_t)CC_TELEMETRY_NO_TEMP;
+    record.mode               = (uint8_t)last_applied_mode;
+    record.channel_count      = (uint8_t)std::min<unsigned int>(protocol->speed_channels, CC_TELEMETRY_CHANNELS);
+
+    uint8_t pump_duty = last_pump_duty.load();
+    uint8_t fan_duty  = last_fan_duty.load();
+
+    for(unsigned int ch = 0; ch < CC_TELEMETRY_CHANNELS; ch++)
+    {
+        record.duty[ch] = ch >= record.channel_count ? 0 : (ch == PUMP_CHANNEL ? pump_duty : fan_duty);
+        record.rpm[ch]  = (ch < rpm.size() && rpm[ch] >= 0) ? (uint16_t)rpm[ch] : (uint16_t)CC_TELEMETRY_NO_RPM;
+    }
+
+    telemetry.Append(record);
+}
+
+void CorsairCapellixXTController::SetPumpCurve(const std::vector<CurvePoint>& points)
+{
+    if(!points.empty())
+    {
+        std::lock_guard<std::mutex> lock(curve_mutex);
+        pump_curve = points;
+    }
+}
+
+void CorsairCapellixXTController::SetFanCurve(const std::vector<CurvePoint>& points)
+{
+    if(!points.empty())
+    {
+        std::lock_guard<std::mutex> lock(curve_mutex);
+        fan_curve = points;
+    }
+}
+
+float CorsairCapellixXTController::GetLastLiquidTemp()
+{
+    return last_liquid_temp.load();
+}
+
+uint8_t CorsairCapellixXTController::GetLastPumpDuty()
+{
+    return last_pump_duty.load();
+}
+
+/*---------------------------------------------------------------------*\
+| Pump mode selection + persistence                                     |
+\*---------------------------------------------------------------------*/
+
+static std::string PumpModeConfigPath()
+{
+    return CCSettingsPath(CC_PUMP_MODE_FILE);
+}
+
+void CorsairCapellixXTController::SetPumpMode(int mode)
+{
+    if(mode < PUMP_MODE_AUTO || mode > PUMP_MODE_TARGET)
+    {
+        mode = PUMP_MODE_AUTO;
+    }
+    LeaveProfile();
+    pump_mode.store(mode);
+    SavePumpMode();
+
+    /*-----------------------------------------------------------------*\
+    | Apply the new mode on the next service step instead of blocking   |
+    | the caller (the GUI thread) on device I/O                         |
+    \*-----------------------------------------------------------------*/
+    cooling_requested.store(true);
+    CorsairCapellixXTService::Get()->Wake(this);
+}
+
+int CorsairCapellixXTController::GetPumpMode()
+{
+    return pump_mode.load();
+}
+
+void CorsairCapellixXTController::LoadPumpMode()
+{
+    std::string path = PumpModeConfigPath();
+    if(path.empty())
+    {
+        return;
+    }
+    FILE* f = fopen(path.c_str(), "r");
+    if(f == nullptr)
+    {
+        return;                 // no saved file yet -> stays default (Auto)
+    }
+    int m = PUMP_MODE_AUTO;
+    if(fscanf(f, "%d", &m) == 1 && m >= PUMP_MODE_AUTO && m <= PUMP_MODE_TARGET)
+    {
+        pump_mode.store(m);
+    }
+
+    /*-----------------------------------------------------------------*\
+    | Optional second line: "profile <name>" selects a profile          |
+    \*-----------------------------------------------------------------*/
+    std::string profile;
+    char        line[128];
+
+    while(fgets(line, sizeof(line), f) != nullptr)
+    {
+        char name[64];
+
+        if(sscanf(line, "profile %63[^\r\n]", name) == 1)
+        {
+            profile = name;
+            profile.erase(profile.find_last_not_of(" \t") + 1);
+        }
+    }
+    fclose(f);
+
+    std::lock_guard<std::mutex> lock(curve_mutex);
+    saved_profile = profile;
+}
+
+void CorsairCapellixXTController::SavePumpMode()
+{
+    std::string path = PumpModeConfigPath();
+    if(path.empty())
+    {
+        return;
+    }
+    FILE* f = fopen(path.c_str(), "w");
+    if(f == nullptr)
+    {
+        return;
+    }
+    fprintf(f, "%d\n", pump_mode.load());
+
+    std::string profile = GetActiveProfile();
+    if(!profile.empty())
+    {
+        fprintf(f, "profile %s\n", profile.c_str());
+    }
+    fclose(f);
+}
+
+/*---------------------------------------------------------------------*\
+| Curve file (optional) — overrides the built-in Auto curves:           |
+|   # liquid temperature (C) -> duty (%)                                |
+|   pump 50 30                                                          |
+|   fan  50 20                                                          |
+| A curve with no valid points keeps its current definition.            |
+\*---------------------------------------------------------------------*/
+
+void CorsairCapellixXTController::LoadCurves()
+{
+    std::string path = CCSettingsPath(CC_CURVES_FILE);
+    if(path.empty())
+    {
+        return;
+    }
+    FILE* f = fopen(path.c_str(), "r");
+    if(f == nullptr)
+    {
+        return;
+    }
+
+    std::vector<CurvePoint>      pump_points;
+    std::vector<CurvePoint>      fan_points;
+    std::vector<CCHwmonSelector> sources;
+    bool                         source_liquid = false;
+    float                        feedforward   = 0.0f;
+    char                         line[128];
+
+    while(fgets(line, sizeof(line), f) != nullptr)
+    {
+        char         which[8];
+        float        tempC;
+        unsigned int duty;
+        char         chip[64];
+        char         label[64];
+
+        /*-------------------------------------------------------------*\
+        | fansource <chip> <label>, the label may contain spaces        |
+        | ("Package id 0"); fansource liquid keeps the liquid sensor in |
+        | the set                                                       |
+        \*-------------------------------------------------------------*/
+        int fields = sscanf(line, "fansource %63s %63[^\r\n]", chip, label);
+
+        if(fields == 1 && strcmp(chip, "liquid") == 0)
+        {
+            source_liquid = true;
+            continue;
+        }
+        if(fields == 2)
+        {
+            std::string trimmed(label);
+            trimmed.erase(trimmed.find_last_not_of(" \t") + 1);
+            sources.push_back({chip, trimmed});
+            continue;
+        }
+
+        if(sscanf(line, "feedforward %f", &tempC) == 1)
+        {
+            feedforward = std::max(0.0f, std::min(CC_FF_MAX_C, tempC));
+            continue;
+        }
+
+        if(sscanf(line, "%7s %f %u", which, &tempC, &duty) != 3 || duty > 100)
+        {
+            continue;
+        }
+
+        if(strcmp(which, "pump") == 0)
+        {
+            pump_points.push_back({tempC, (uint8_t)duty});
+        }
+        else if(strcmp(which, "fan") == 0)
+        {
+            fan_points.push_back({tempC, (uint8_t)duty});
+        }
+    }
+    fclose(f);
+
+    auto by_temp = [](const CurvePoint& a, const CurvePoint& b) { return a.tempC < b.tempC; };
+    std::sort(pump_points.begin(), pump_points.end(), by_temp);
+    std::sort(fan_points.begin(),  fan_points.end(),  by_temp);
+
+    SetPumpCurve(pump_points);
+    SetFanCurve(fan_points);
+
+    std::lock_guard<std::mutex> lock(curve_mutex);
+    feedforward_max_c = feedforward;
+    fan_source_liquid = source_liquid;
+
+    bool same = sources.size() == fan_sources.size();
+
+    for(size_t i = 0; same && i < sources.size(); i++)
+    {
+        same = sources[i].chip == fan_sources[i].chip && sources[i].label == fan_sources[i].label;
+    }
+
+    if(!same)
+    {
+        fan_sources         = sources;
+        fan_sources_changed = true;
+    }
+}
+
+/*---------------------------------------------------------------------*\
+| Profiles file (optional). "profile <name>" starts a profile and the   |
+| lines after it fill it in; anything left out stays as it is:          |
+|   profile render                                                      |
+|   mode performance                                                    |
+|   color all 000000                                                    |
+|   profile quiet meeting                                               |
+|   mode quiet                                                          |
+|   duty 40 20              pump / fan duty for the (fixed) mode        |
+|   pump 50 30              Auto curve points, as in the curves file    |
+|   fan  50 20                                                          |
+|   target 2150 1040        Target RPM pump / fan speeds                |
+|   color 0 ff0000          zone 0 (pump head); several colors = per LED|
+| Parsed once per (re)load, so a switch never reads the disk.           |
+\*---------------------------------------------------------------------*/
+
+static bool ParseColors(const char* text, std::vector<uint8_t>& out)
+{
+    char hex[8];
+    int  used;
+
+    while(sscanf(text, "%7s%n", hex, &used) == 1)
+    {
+        if(strlen(hex) != 6 || strspn(hex, "0123456789abcdefABCDEF") != 6)
+        {
+            return false;
+        }
+
+        unsigned long rgb = strtoul(hex, nullptr, 16);
+
+        out.push_back((uint8_t)(rgb >> 16));
+        out.push_back((uint8_t)(rgb >> 8));
+        out.push_back((uint8_t)rgb);
+        text += used;
+    }
+
+    return !out.empty();
+}
+
+void CorsairCapellixXTController::LoadProfiles()
+{
+    std::vector<CCProfile> loaded;
+    std::string            path = CCSettingsPath(CC_PROFILES_FILE);
+    FILE*                  f    = path.empty() ? nullptr : fopen(path.c_str(), "r");
+
+    char line[256];
+
+    while(f != nullptr && fgets(line, sizeof(line), f) != nullptr)
+    {
+        char         name[64];
+        char         which[16];
+        float        tempC;
+        unsigned int pump;
+        unsigned int fan;
+        int          used;
+
+        if(sscanf(line, "profile %63[^\r\n]", name) == 1)
+        {
+            CCProfile profile;
+
+            profile.name            = name;
+            profile.name.erase(profile.name.find_last_not_of(" \t") + 1);
+            profile.mode            = -1;
+            profile.pump_duty       = -1;
+            profile.fan_duty        = -1;
+            profile.pump_target_rpm = -1;
+            profile.fan_target_rpm  = -1;
+
+            loaded.push_back(profile);
+            continue;
+        }
+
+        if(loaded.empty())
+        {
+            continue;
+        }
+
+        CCProfile& profile = loaded.back();
+
+        if(sscanf(line, "mode %15s", which) == 1)
+        {
+            for(int mode = PUMP_MODE_AUTO; mode <= PUMP_MODE_TARGET; mode++)
+            {
+                std::string mode_name = PumpModeName(mode);
+                std::transform(mode_name.begin(), mode_name.end(), mode_name.begin(), ::tolower);
+
+                if(mode_name == which)
+                {
+                    profile.mode = mode;
+                }
+            }
+        }
+        else if(sscanf(line, "duty %u %u", &pump, &fan) == 2 && pump <= 100 && fan <= 100)
+        {
+            profile.pump_duty = (int)pump;
+            profile.fan_duty  = (int)fan;
+        }
+        else if(sscanf(line, "target %u %u", &pump, &fan) == 2 && pump <= CC_RPM_MAX && fan <= CC_RPM_MAX)
+        {
+            profile.pump_target_rpm = (int)pump;
+            profile.fan_target_rpm  = (int)fan;
+        }
+        else if(sscanf(line, "color %15s %n", which, &used) == 1)
+        {
+            std::vector<uint8_t> colors;
+
+            if(!ParseColors(line + used, colors))
+            {
+                continue;
+            }
+
+            if(strcmp(which, "all") == 0)
+            {
+                profile.all_color.assign(colors.begin(), colors.begin() + 3);
+            }
+            else if(strspn(which, "0123456789") == strlen(which) && atoi(which) < CC_MAX_LED_CHANNELS)
+            {
+                unsigned int zone = (unsigned int)atoi(which);
+
+                if(profile.zone_colors.size() <= zone)
+                {
+                    profile.zone_colors.resize(zone + 1);
+                }
+                profile.zone_colors[zone] = colors;
+            }
+        }
+        else if(sscanf(line, "%15s %f %u", which, &tempC, &pump) == 3 && pump <= 100)
+        {
+            if(strcmp(which, "pump") == 0)
+            {
+                profile.pump_curve.push_back({tempC, (uint8_t)pump});
+            }
+            else if(strcmp(which, "fan") == 0)
+            {
+                profile.fan_curve.push_back({tempC, (uint8_t)pump});
+            }
+        }
+    }
+
+    if(f != nullptr)
+    {
+        fclose(f);
+    }
+
+    auto by_temp = [](const CurvePoint& a, const CurvePoint& b) { return a.tempC < b.tempC; };
+
+    for(CCProfile& profile : loaded)
+    {
+        std::sort(profile.pump_curve.begin(), profile.pump_curve.end(), by_temp);
+        std::sort(profile.fan_curve.begin(),  profile.fan_curve.end(),  by_temp);
+
+        bool fixed = profile.mode >= PUMP_MODE_SILENT && profile.mode <= PUMP_MODE_PERFORMANCE;
+
+        if(profile.pump_duty >= 0 && !fixed)
+        {
+            CCLog(CC_LOG_WARN, "profile \"%s\": duty needs a fixed mode (silent, quiet, balanced, performance), ignored",
+                  profile.name.c_str());
+            profile.pump_duty = -1;
+            profile.fan_duty  = -1;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(curve_mutex);
+    profiles.swap(loaded);
+}
+
+std::vector<std::string> CorsairCapellixXTController::GetProfileNames()
+{
+    std::lock_guard<std::mutex> lock(curve_mutex);
+    std::vector<std::string>    names;
+
+    for(const CCProfile& profile : profiles)
+    {
+        names.push_back(profile.name);
+    }
+    return names;
+}
+
+std::string CorsairCapellixXTController::GetActiveProfile()
+{
+    std::lock_guard<std::mutex> lock(curve_mutex);
+    return active_profile;
+}
+
+/*---------------------------------------------------------------------*\
+| Switch the settings to a profile, no device I/O: its curves and       |
+| duties become the overlay, its mode and targets are set as the pane   |
+| would set them (targets are only saved when they change, so a reload  |
+| does not rewrite the file it was triggered by)                        |
+\*---------------------------------------------------------------------*/
+
+bool CorsairCapellixXTController::UseProfile(const std::string& name)
+{
+    int  mode          = -1;
+    bool targets_moved = false;
+
+    {
+        std::lock_guard<std::mutex> lock(curve_mutex);
+
+        std::vector<CCProfile>::const_iterator profile =
+            std::find_if(profiles.begin(), profiles.end(), [&name](const CCProfile& p) { return p.name == name; });
+
+        if(profile == profiles.end())
+        {
+            return false;
+        }
+
+        active_profile     = profile->name;
+        profile_pump_curve = profile->pump_curve;
+        profile_fan_curve  = profile->fan_curve;
+        profile_pump_duty  = profile->pump_duty;
+        profile_fan_duty   = profile->fan_duty;
+        mode               = profile->mode;
+
+        if(profile->pump_target_rpm >= 0
+        && (profile->pump_target_rpm != pump_target_rpm || profile->fan_target_rpm != fan_target_rpm))
+        {
+            pump_target_rpm = profile->pump_target_rpm;
+            fan_target_rpm  = profile->fan_target_rpm;
+            targets_moved   = true;
+        }
+    }
+
+    if(mode >= 0)
+    {
+        pump_mode.store(mode);
+    }
+
+    if(targets_moved)
+    {
+        targets_changed.store(true);
+        SaveTargets();
+    }
+
+    return true;
+}
+
+void CorsairCapellixXTController::LeaveProfile()
+{
+    std::lock_guard<std::mutex> lock(curve_mutex);
+
+    active_profile.clear();
+    profile_pump_curve.clear();
+    profile_fan_curve.clear();
+    profile_pump_duty = -1;
+    profile_fan_duty  = -1;
+}
+
+bool CorsairCapellixXTController::ApplyProfile(const std::string& name)
+{
+    if(!UseProfile(name))
+    {
+        CCLog(CC_LOG_WARN, "serial=%s no profile named \"%s\"", serial.c_str(), name.c_str());
+        return false;
+    }
+
+    SavePumpMode();
+
+    profile_switches++;
+    profile_pending.store(true);
+    CorsairCapellixXTService::Get()->Wake(this);
+
+    return true;
+}
+
+/*---------------------------------------------------------------------*\
+| The switch on the device, on the service thread: one cooling write    |
+| for the new mode and the profile's frame, under one lock acquisition  |
+| so nothing runs between them and no half-switched state is visible    |
+| or audible. Without a pump, in Disabled mode or while calibrating the |
+| speeds are left alone; without colors the frame is.                   |
+\*---------------------------------------------------------------------*/
+
+void CorsairCapellixXTController::ProfileBurst()
+{
+    CCProfile profile;
+    {
+        std::lock_guard<std::mutex> lock(curve_mutex);
+
+        std::vector<CCProfile>::const_iterator found =
+            std::find_if(profiles.begin(), profiles.end(), [this](const CCProfile& p) { return p.name == active_profile; });
+
+        if(found == profiles.end())
+        {
+            return;
+        }
+        profile = *found;
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    std::unique_lock<std::recursive_mutex> io_lock = LockForCooling();
+
+    bool                 speeds = protocol->has_pump
+                               && pump_mode.load() != PUMP_MODE_DISABLED
+                               && calibration_phase == CC_CALIBRATION_IDLE;
+    std::vector<uint8_t> frame  = lighting_enabled ? BuildProfileFrame(profile) : std::vector<uint8_t>();
+
+    if(speeds)
+    {
+        CoolingApply();
+    }
+    if(!frame.empty())
+    {
+        SendColors(frame, false);
+    }
+
+    io_lock.unlock();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        profile_burst_s = seconds;
+    }
+
+    CCLog(CC_LOG_INFO, "serial=%s profile \"%s\" applied (mode=%s%s%s) in %.1f ms",
+          serial.c_str(), profile.name.c_str(), PumpModeName(pump_mode.load()),
+          speeds ? ", speeds" : "", frame.empty() ? "" : ", colors", seconds * 1000.0);
+}
+
+/*---------------------------------------------------------------------*\
+| A wire frame with the profile's colors. Zones it has no color for     |
+| keep the bytes of the last frame sent, so only what it names changes. |
+\*---------------------------------------------------------------------*/
+
+std::vector<uint8_t> CorsairCapellixXTController::BuildProfileFrame(const CCProfile& profile)
+{
+    size_t size = 0;
+
+    for(unsigned int zone = 0; zone < channels.size(); zone++)
+    {
+        size += GetFrameSlotLeds(zone) * 3;
+    }
+
+    std::vector<uint8_t> frame;
+    {
+        std::lock_guard<std::mutex> lock(color_mutex);
+        frame = last_colors;
+    }
+
+    if(frame.size() != size)
+    {
+        frame.assign(size, 0x00);
+    }
+
+    size_t offset  = 0;
+    bool   colored = false;
+
+    for(unsigned int zone = 0; zone < channels.size(); zone++)
+    {
+        const std::vector<uint8_t>& colors = zone < profile.zone_colors.size() && !profile.zone_colors[zone].empty()
+                                           ? profile.zone_colors[zone] : profile.all_color;
+
+        /*-------------------------------------------------------------*\
+        | Profile colors are plain RGB like OpenRGB's, so they get the  |
+        | device's color correction on the way to the wire, the same as |
+        | the zones kept from the last frame                            |
+        \*-------------------------------------------------------------*/
+        if(!colors.empty())
+        {
+            size_t                count = colors.size() / 3;
+            std::vector<uint32_t> zone_colors(channels[zone].led_count);
+
+            for(unsigned int led = 0; led < channels[zone].led_count; led++)
+            {
+                const uint8_t* rgb = colors.data() + std::min<size_t>(led, count - 1) * 3;
+
+                zone_colors[led] = rgb[0] | (rgb[1] << 8) | (rgb[2] << 16);
+            }
+
+            color_correction.PackZone(zone, zone_colors.data(), zone_colors.size(), frame.data() + offset);
+            colored = true;
+        }
+
+        offset += GetFrameSlotLeds(zone) * 3;
+    }
+
+    if(!colored)
+    {
+        frame.clear();
+    }
+    return frame;
+}
+
+/*---------------------------------------------------------------------*\
+| Target file for PUMP_MODE_TARGET:                                     |
+|   pump 2150                                                           |
+|   fan  1040                                                           |
+| Missing or out-of-range lines keep the current target.                |
+\*---------------------------------------------------------------------*/
+
+void CorsairCapellixXTController::SetSpeedTargets(int pump_rpm, int fan_rpm)
+{
+    {
+        std::lock_guard<std::mutex> lock(curve_mutex);
+        pump_target_rpm = std::max(0, std::min(CC_RPM_MAX, pump_rpm));
+        fan_target_rpm  = std::max(0, std::min(CC_RPM_MAX, fan_rpm));
+    }
+    SaveTargets();
+
+    targets_changed.store(true);
+    cooling_requested.store(true);
+    CorsairCapellixXTService::Get()->Wake(this);
+}
+
+void CorsairCapellixXTController::GetSpeedTargets(int& pump_rpm, int& fan_rpm)
+{
+    std::lock_guard<std::mutex> lock(curve_mutex);
+    pump_rpm = pump_target_rpm;
+    fan_rpm  = fan_target_rpm;
+}
+
+void CorsairCapellixXTController::LoadTargets()
+{
+    std::string path = CCSettingsPath(CC_TARGETS_FILE);
+    if(path.empty())
+    {
+        return;
+    }
+    FILE* f = fopen(path.c_str(), "r");
+    if(f == nullptr)
+    {
+        return;
+    }
+
+    char line[128];
+
+    while(fgets(line, sizeof(line), f) != nullptr)
+    {
+        char which[8];
+        int  rpm;
+
+        if(sscanf(line, "%7s %d", which, &rpm) != 2 || rpm < 0 || rpm > CC_RPM_MAX)
+        {
+            continue;
+        }
+
+        std::lock_guard<std::mutex> lock(curve_mutex);
+
+        if(strcmp(which, "pump") == 0 && rpm != pump_target_rpm)
+        {
+            pump_target_rpm = rpm;
+            targets_changed.store(true);
+        }
+        else if(strcmp(which, "fan") == 0 && rpm != fan_target_rpm)
+        {
+            fan_target_rpm = rpm;
+            targets_changed.store(true);
+        }
+    }
+    fclose(f);
+}
+
+void CorsairCapellixXTController::SaveTargets()
+{
+    std::string path = CCSettingsPath(CC_TARGETS_FILE);
+    if(path.empty())
+    {
+        return;
+    }
+    FILE* f = fopen(path.c_str(), "w");
+    if(f == nullptr)
+    {
         return;
     }
 
-    /*-----------------------------------------------------------------*\
-    | Hold the device lock for the whole multi-chunk write so a pump     |
-    | update on the keepalive thread can't interleave on the HID pipe    |
-    \*-----------------------------------------------------------------*/
-    std::lock_guard<std::recursive_mutex> io_lock(io_mutex);
+    int pump_rpm;
+    int fan_rpm;
+    GetSpeedTargets(pump_rpm, fan_rpm);
+
+    fprintf(f, "pump %d\nfan %d\n", pump_rpm, fan_rpm);
+    fclose(f);
+}
+
+/*---------------------------------------------------------------------*\
+| Re-read the mode and curve files (another tool or the plugin pane     |
+| changed them) and apply the result on the next service step           |
+\*---------------------------------------------------------------------*/
+
+void CorsairCapellixXTController::ReloadSettings()
+{
+    LoadPumpMode();
+    LoadCurves();
+    LoadTargets();
+    LoadProfiles();
 
     /*-----------------------------------------------------------------*\
-    | Store last colors for keepalive resend                            |
+    | The mode file may name a profile: a new one gets its burst, the   |
+    | same one only has its overlay put back; none leaves it            |
     \*-----------------------------------------------------------------*/
+    std::string wanted;
+    std::string current;
     {
-        std::lock_guard<std::mutex> lock(color_mutex);
-        last_colors = color_data;
+        std::lock_guard<std::mutex> lock(curve_mutex);
+        wanted  = saved_profile;
+        current = active_profile;
     }
 
-    /*-----------------------------------------------------------------*\
-    | Build write buffer                                                |
-    \*-----------------------------------------------------------------*/
-    uint16_t size = (uint16_t)(color_data.size() + 2);
+    if(wanted.empty() || !UseProfile(wanted))
+    {
+        LeaveProfile();
+    }
+    else if(wanted != current)
+    {
+        profile_switches++;
+        profile_pending.store(true);
+    }
 
-    std::vector<uint8_t> write_buf;
-    write_buf.push_back(size & 0xFF);           // LE size low
-    write_buf.push_back((size >> 8) & 0xFF);    // LE size high
-    write_buf.push_back(0x00);                  // padding
-    write_buf.push_back(0x00);                  // padding
-    write_buf.push_back(DATA_TYPE_SET_COLOR_0); // 0x12
-    write_buf.push_back(DATA_TYPE_SET_COLOR_1); // 0x00
-    write_buf.insert(write_buf.end(), color_data.begin(), color_data.end());
+    CorsairCapellixXTCalibration loaded;
+    loaded.Load(serial);
+    {
+        std::lock_guard<std::mutex> lock(curve_mutex);
+        calibration = loaded;
+    }
+    ApplyCalibration();
 
-    /*-----------------------------------------------------------------*\
-    | Chunk and send                                                    |
-    \*-----------------------------------------------------------------*/
-    size_t offset = 0;
-    int chunk_num = 0;
+    cooling_requested.store(true);
+    CorsairCapellixXTService::Get()->Wake(this);
+}
+
+/*---------------------------------------------------------------------*\
+| Calibration sweep. The pump goes from full down to its safety floor   |
+| with the fans held at the Quiet duty, then the fans go from full to   |
+| off with the pump held at Balanced for flow while they stop. Each     |
+| step is a write, a settle wait and samples until the speed is stable; |
+| the service thread keeps lighting and other devices going meanwhile.  |
+\*---------------------------------------------------------------------*/
+
+struct CCCalibrationStep
+{
+    uint8_t         pump_duty;
+    uint8_t         fan_duty;
+    bool            fans;           // record the fan channels, else the pump
+};
 
-    while(offset < write_buf.size())
+static const CCCalibrationStep CC_CALIBRATION_SWEEP[] =
+{
+    { 100,                FAN_DUTY_QUIET, false },
+    {  90,                FAN_DUTY_QUIET, false },
+    {  80,                FAN_DUTY_QUIET, false },
+    {  70,                FAN_DUTY_QUIET, false },
+    {  60,                FAN_DUTY_QUIET, false },
+    {  50,                FAN_DUTY_QUIET, false },
+    {  40,                FAN_DUTY_QUIET, false },
+    { PUMP_DUTY_MIN,      FAN_DUTY_QUIET, false },
+    { PUMP_DUTY_BALANCED, 100,            true  },
+    { PUMP_DUTY_BALANCED,  80,            true  },
+    { PUMP_DUTY_BALANCED,  60,            true  },
+    { PUMP_DUTY_BALANCED,  45,            true  },
+    { PUMP_DUTY_BALANCED,  35,            true  },
+    { PUMP_DUTY_BALANCED,  25,            true  },
+    { PUMP_DUTY_BALANCED,  20,            true  },
+    { PUMP_DUTY_BALANCED,  15,            true  },
+    { PUMP_DUTY_BALANCED,  10,            true  },
+    { PUMP_DUTY_BALANCED,   5,            true  },
+    { PUMP_DUTY_BALANCED,   0,            true  },
+};
+
+static const unsigned int CC_CALIBRATION_STEPS = sizeof(CC_CALIBRATION_SWEEP) / sizeof(CC_CALIBRATION_SWEEP[0]);
+
+bool CorsairCapellixXTController::StartCalibration()
+{
+    if(!protocol->has_pump || !connected.load() || pump_mode.load() == PUMP_MODE_DISABLED)
     {
-        size_t chunk_size = write_buf.size() - offset;
-        if(chunk_size > max_buf_per_request)
-        {
-            chunk_size = max_buf_per_request;
-        }
+        return false;
+    }
 
-        std::vector<uint8_t> chunk(write_buf.begin() + offset,
-                                   write_buf.begin() + offset + chunk_size);
+    calibration_progress.store(0);
+    calibration_requested.store(true);
+    CorsairCapellixXTService::Get()->Wake(this);
+    return true;
+}
 
-        if(chunk_num == 0)
+int CorsairCapellixXTController::GetCalibrationProgress()
+{
+    return calibration_progress.load();
+}
+
+bool CorsairCapellixXTController::IsCalibrated()
+{
+    std::lock_guard<std::mutex> lock(curve_mutex);
+    return !calibration.Empty();
+}
+
+std::chrono::steady_clock::time_point CorsairCapellixXTController::CalibrationStep(
+    std::chrono::steady_clock::time_point now)
+{
+    if(calibration_step >= CC_CALIBRATION_STEPS)
+    {
+        CalibrationFinish();
+        return now;
+    }
+
+    const CCCalibrationStep& step = CC_CALIBRATION_SWEEP[calibration_step];
+
+    if(calibration_phase == CC_CALIBRATION_WRITE)
+    {
+        float tempC = ReadLiquidTemp();
+
+        if(tempC >= 0.0f)
         {
-            Transfer({CMD_WRITE_COLOR_0, CMD_WRITE_COLOR_1}, chunk);
+            last_liquid_temp.store(tempC);
         }
-        else
+        if(tempC > CC_CALIBRATION_MAX_LIQUID_C)
+        {
+            CalibrationAbort("liquid temperature too high");
+            return now;
+        }
+        if(!WriteSpeeds(step.pump_duty, step.fan_duty))
         {
-            Transfer({CMD_WRITE_COLOR_NEXT_0, CMD_WRITE_COLOR_NEXT_1}, chunk);
+            CalibrationAbort("speed write failed");
+            return now;
         }
 
-        offset += chunk_size;
-        chunk_num++;
+        calibration_samples = 0;
+        calibration_last_rpm.clear();
+        calibration_phase   = CC_CALIBRATION_SAMPLE;
+        return now + std::chrono::milliseconds(CC_CALIBRATION_SETTLE_MS);
     }
 
-    last_commit_time = std::chrono::steady_clock::now();
-}
+    std::vector<int> rpm;
 
-/*---------------------------------------------------------------------*\
-| Pump / fan speed control (endpoint 0x18, dataType 0x07 0x00)          |
-|                                                                       |
-| Speed buffer (one channel here, the pump):                            |
-|   [0]    = channel count (1)                                          |
-|   [1..4] = { channel, mode(0=percent), duty, 0x00 }                   |
-| Wrapped like writeColor: LE16 size, 0x00 0x00 pad, dataType, data.    |
-\*---------------------------------------------------------------------*/
+    if(!ReadSpeeds(rpm))
+    {
+        CalibrationAbort("speed read failed");
+        return now;
+    }
+
+    calibration_samples++;
 
-void CorsairCapellixXTController::SetPumpDuty(uint8_t duty)
-{
     /*-----------------------------------------------------------------*\
-    | SAFETY: clamp to a floor so the pump never stops (no flow).        |
-    | Measured: <=10% => 0 rpm, 20% => ~690 rpm, 30% => ~1150 rpm.       |
+    | Settled once every channel being measured reads the same as last |
+    | time, within the tolerance                                        |
     \*-----------------------------------------------------------------*/
-    if(duty < PUMP_DUTY_MIN) duty = PUMP_DUTY_MIN;
-    if(duty > PUMP_DUTY_MAX) duty = PUMP_DUTY_MAX;
+    unsigned int first  = step.fans ? FAN_CHANNEL_FIRST : PUMP_CHANNEL;
+    unsigned int last   = step.fans ? std::min<unsigned int>(FAN_CHANNEL_LAST, rpm.size() - 1) : PUMP_CHANNEL;
+    bool         stable = calibration_last_rpm.size() == rpm.size();
 
-    std::vector<uint8_t> speed_data =
+    for(unsigned int ch = first; stable && ch <= last && ch < rpm.size(); ch++)
     {
-        0x01,                       // channel count
-        (uint8_t)PUMP_CHANNEL,      // channel id (pump = 0)
-        SPEED_MODE_PERCENT,         // mode (fixed percent)
-        duty,                       // duty %
-        0x00,
-    };
+        int delta = std::abs(rpm[ch] - calibration_last_rpm[ch]);
 
-    uint16_t size = (uint16_t)(speed_data.size() + 2);
+        stable = rpm[ch] >= 0
+              && delta * 100 <= std::max(rpm[ch], CC_CALIBRATION_STALL_RPM) * CC_CALIBRATION_TOLERANCE_PCT;
+    }
 
-    std::vector<uint8_t> write_buf;
-    write_buf.push_back(size & 0xFF);
-    write_buf.push_back((size >> 8) & 0xFF);
-    write_buf.push_back(0x00);
-    write_buf.push_back(0x00);
-    write_buf.push_back(DATA_TYPE_SET_SPEED_0);
-    write_buf.push_back(DATA_TYPE_SET_SPEED_1);
-    write_buf.insert(write_buf.end(), speed_data.begin(), speed_data.end());
+    if(!stable && calibration_samples < CC_CALIBRATION_MAX_SAMPLES)
+    {
+        calibration_last_rpm = rpm;
+        return now + std::chrono::milliseconds(CC_CALIBRATION_SAMPLE_MS);
+    }
 
-    std::lock_guard<std::recursive_mutex> lock(io_mutex);
-    Transfer({CMD_CLOSE_ENDPOINT_0, CMD_CLOSE_ENDPOINT_1, CMD_CLOSE_ENDPOINT_2}, {MODE_SET_SPEED});
-    Transfer({CMD_OPEN_ENDPOINT_0, CMD_OPEN_ENDPOINT_1}, {MODE_SET_SPEED});
-    Transfer({CMD_WRITE_0, CMD_WRITE_1}, write_buf);
-    Transfer({CMD_CLOSE_ENDPOINT_0, CMD_CLOSE_ENDPOINT_1, CMD_CLOSE_ENDPOINT_2}, {MODE_SET_SPEED});
+    for(unsigned int ch = first; ch <= last && ch < rpm.size(); ch++)
+    {
+        if(rpm[ch] >= 0)
+        {
+            calibration_sweep.AddReading(ch, step.fans ? step.fan_duty : step.pump_duty, rpm[ch]);
+        }
+    }
 
-    last_pump_duty.store(duty);
+    calibration_step++;
+    calibration_phase = CC_CALIBRATION_WRITE;
+    calibration_progress.store((int)(calibration_step * 100 / CC_CALIBRATION_STEPS));
+    return now;
 }
 
-/*---------------------------------------------------------------------*\
-| Read AIO liquid temperature (channel 0 of the temperature endpoint)   |
-|   response[6]   = status (0x00 == connected)                          |
-|   response[7:9] = temperature * 10, little-endian                     |
-\*---------------------------------------------------------------------*/
-
-float CorsairCapellixXTController::ReadLiquidTemp()
+void CorsairCapellixXTController::CalibrationFinish()
 {
-    std::vector<uint8_t> resp = ReadEndpoint(MODE_GET_TEMPS);
+    calibration_phase = CC_CALIBRATION_IDLE;
+    calibration_sweep.Finish();
 
-    if(resp.size() < 9)
+    if(calibration_sweep.Channel(PUMP_CHANNEL) == nullptr)
     {
-        return -1.0f;
+        CalibrationAbort("no pump speed readings");
+        return;
     }
-    if(resp[6] != 0x00)
+
+    calibration_sweep.Save(serial);
     {
-        return -1.0f;
+        std::lock_guard<std::mutex> lock(curve_mutex);
+        calibration = calibration_sweep;
     }
+    ApplyCalibration();
 
-    int16_t raw = (int16_t)(resp[7] | (resp[8] << 8));
-    return (float)raw / 10.0f;
+    calibration_progress.store(-1);
+    cooling_requested.store(true);
 }
 
-/*---------------------------------------------------------------------*\
-| Read pump RPM (channel 0 of the speeds endpoint)                      |
-\*---------------------------------------------------------------------*/
-
-int CorsairCapellixXTController::ReadPumpRpm()
+void CorsairCapellixXTController::CalibrationAbort(const char* reason)
 {
-    std::vector<uint8_t> resp = ReadEndpoint(MODE_GET_SPEEDS);
-
-    if(resp.size() < 8)
-    {
-        return -1;
-    }
+    CCLog(CC_LOG_WARN, "%s: calibration abandoned (%s)", serial.c_str(), reason);
 
-    return (int)(int16_t)(resp[6] | (resp[7] << 8));
+    calibration_phase = CC_CALIBRATION_IDLE;
+    calibration_progress.store(-1);
+    cooling_requested.store(true);
 }
 
 /*---------------------------------------------------------------------*\
-| Read first radiator fan RPM (speed channel 1)                         |
+| Mode duties and floors from the calibration table. The pump floor is  |
+| the duty reaching the Silent reference speed, never below             |
+| PUMP_DUTY_MIN; the fan floor sits CC_CALIBRATION_STALL_MARGIN above   |
+| the highest stall duty of any fan. A fixed mode gets the lowest duty  |
+| that brings every channel to the mode's reference speed. Performance  |
+| stays at full. Without a table the built-in constants apply.          |
 \*---------------------------------------------------------------------*/
 
-int CorsairCapellixXTController::ReadFanRpm()
+void CorsairCapellixXTController::ApplyCalibration()
 {
-    std::vector<uint8_t> resp = ReadEndpoint(MODE_GET_SPEEDS);
+    std::lock_guard<std::mutex> lock(curve_mutex);
 
-    if(resp.size() < 10)
-    {
-        return -1;
-    }
+    static const uint8_t default_pump[PUMP_MODE_DISABLED] =
+        { PUMP_DUTY_SILENT, PUMP_DUTY_SILENT, PUMP_DUTY_QUIET, PUMP_DUTY_BALANCED, PUMP_DUTY_PERFORMANCE };
+    static const uint8_t default_fan[PUMP_MODE_DISABLED]  =
+        { FAN_DUTY_SILENT,  FAN_DUTY_SILENT,  FAN_DUTY_QUIET,  FAN_DUTY_BALANCED,  FAN_DUTY_PERFORMANCE };
 
-    // [6:8] = pump (ch0), [8:10] = fan1 (ch1)
-    return (int)(int16_t)(resp[8] | (resp[9] << 8));
-}
+    memcpy(mode_pump_duty, default_pump, sizeof(mode_pump_duty));
+    memcpy(mode_fan_duty,  default_fan,  sizeof(mode_fan_duty));
+    pump_floor = PUMP_DUTY_MIN;
+    fan_floor  = FAN_DUTY_MIN;
 
-/*---------------------------------------------------------------------*\
-| Drive pump (channel 0) and all radiator fans (channels 1..6) in a     |
-| single speed write. Fans are clamped to FAN_DUTY_MIN so they never    |
-| stall (~300 rpm floor); the pump is clamped to PUMP_DUTY_MIN.         |
-\*---------------------------------------------------------------------*/
+    /*-----------------------------------------------------------------*\
+    | Model for the Target RPM feed-forward: the measured table, or    |
+    | the reference speeds the fixed duties were tuned for             |
+    \*-----------------------------------------------------------------*/
+    speed_model = calibration;
 
-void CorsairCapellixXTController::SetCooling(uint8_t pump_duty, uint8_t fan_duty)
-{
-    if(pump_duty < PUMP_DUTY_MIN) pump_duty = PUMP_DUTY_MIN;
-    if(pump_duty > PUMP_DUTY_MAX) pump_duty = PUMP_DUTY_MAX;
-    if(fan_duty  < FAN_DUTY_MIN)  fan_duty  = FAN_DUTY_MIN;
-    if(fan_duty  > 100)           fan_duty  = 100;
+    if(calibration.Empty())
+    {
+        speed_model.AddReading(PUMP_CHANNEL,      PUMP_DUTY_SILENT,      PUMP_RPM_SILENT);
+        speed_model.AddReading(PUMP_CHANNEL,      PUMP_DUTY_QUIET,       PUMP_RPM_QUIET);
+        speed_model.AddReading(PUMP_CHANNEL,      PUMP_DUTY_BALANCED,    PUMP_RPM_BALANCED);
+        speed_model.AddReading(PUMP_CHANNEL,      PUMP_DUTY_PERFORMANCE, PUMP_RPM_PERFORMANCE);
+        speed_model.AddReading(FAN_CHANNEL_FIRST, FAN_DUTY_SILENT,       FAN_RPM_SILENT);
+        speed_model.AddReading(FAN_CHANNEL_FIRST, FAN_DUTY_QUIET,        FAN_RPM_QUIET);
+        speed_model.AddReading(FAN_CHANNEL_FIRST, FAN_DUTY_BALANCED,     FAN_RPM_BALANCED);
+        speed_model.AddReading(FAN_CHANNEL_FIRST, FAN_DUTY_PERFORMANCE,  FAN_RPM_PERFORMANCE);
+        speed_model.Finish();
+        return;
+    }
 
-    int channel_count = 1 + (FAN_CHANNEL_LAST - FAN_CHANNEL_FIRST + 1);  // pump + 6 fans
+    auto pump_duty_for = [this](int rpm, uint8_t fallback)
+    {
+        int duty = calibration.DutyForRpm(PUMP_CHANNEL, rpm);
+        return (uint8_t)std::max<int>(duty < 0 ? fallback : duty, pump_floor);
+    };
 
-    std::vector<uint8_t> speed_data;
-    speed_data.push_back((uint8_t)channel_count);
+    pump_floor                             = pump_duty_for(PUMP_RPM_SILENT,   PUMP_DUTY_SILENT);
+    mode_pump_duty[PUMP_MODE_SILENT]       = pump_floor;
+    mode_pump_duty[PUMP_MODE_QUIET]        = pump_duty_for(PUMP_RPM_QUIET,    PUMP_DUTY_QUIET);
+    mode_pump_duty[PUMP_MODE_BALANCED]     = pump_duty_for(PUMP_RPM_BALANCED, PUMP_DUTY_BALANCED);
 
-    // pump (channel 0)
-    speed_data.push_back((uint8_t)PUMP_CHANNEL);
-    speed_data.push_back(SPEED_MODE_PERCENT);
-    speed_data.push_back(pump_duty);
-    speed_data.push_back(0x00);
+    int  stall     = -1;
+    int  fan_lo    = 100;
+    bool have_fans = false;
 
-    // fans (channels 1..6 — unconnected ports are harmlessly ignored)
-    for(int ch = FAN_CHANNEL_FIRST; ch <= FAN_CHANNEL_LAST; ch++)
+    for(unsigned int ch = FAN_CHANNEL_FIRST; ch <= FAN_CHANNEL_LAST; ch++)
     {
-        speed_data.push_back((uint8_t)ch);
-        speed_data.push_back(SPEED_MODE_PERCENT);
-        speed_data.push_back(fan_duty);
-        speed_data.push_back(0x00);
+        const CCChannelCalibration* c = calibration.Channel(ch);
+
+        if(c != nullptr && !c->points.empty())
+        {
+            have_fans = true;
+            stall     = std::max(stall, c->stall_duty);
+            fan_lo    = std::min<int>(fan_lo, c->points.front().duty);
+        }
     }
 
-    uint16_t size = (uint16_t)(speed_data.size() + 2);
+    if(have_fans)
+    {
+        fan_floor = (uint8_t)std::min(100, stall >= 0 ? stall + CC_CALIBRATION_STALL_MARGIN : fan_lo);
 
-    std::vector<uint8_t> write_buf;
-    write_buf.push_back(size & 0xFF);
-    write_buf.push_back((size >> 8) & 0xFF);
-    write_buf.push_back(0x00);
-    write_buf.push_back(0x00);
-    write_buf.push_back(DATA_TYPE_SET_SPEED_0);
-    write_buf.push_back(DATA_TYPE_SET_SPEED_1);
-    write_buf.insert(write_buf.end(), speed_data.begin(), speed_data.end());
+        auto fan_duty_for = [this](int rpm, uint8_t fallback)
+        {
+            int duty = -1;
 
-    std::lock_guard<std::recursive_mutex> lock(io_mutex);
-    Transfer({CMD_CLOSE_ENDPOINT_0, CMD_CLOSE_ENDPOINT_1, CMD_CLOSE_ENDPOINT_2}, {MODE_SET_SPEED});
-    Transfer({CMD_OPEN_ENDPOINT_0, CMD_OPEN_ENDPOINT_1}, {MODE_SET_SPEED});
-    Transfer({CMD_WRITE_0, CMD_WRITE_1}, write_buf);
-    Transfer({CMD_CLOSE_ENDPOINT_0, CMD_CLOSE_ENDPOINT_1, CMD_CLOSE_ENDPOINT_2}, {MODE_SET_SPEED});
+            for(unsigned int ch = FAN_CHANNEL_FIRST; ch <= FAN_CHANNEL_LAST; ch++)
+            {
+                duty = std::max(duty, calibration.DutyForRpm(ch, rpm));
+            }
 
-    last_pump_duty.store(pump_duty);
-    last_fan_duty.store(fan_duty);
+            return (uint8_t)std::max<int>(duty < 0 ? fallback : duty, fan_floor);
+        };
+
+        mode_fan_duty[PUMP_MODE_SILENT]    = fan_duty_for(FAN_RPM_SILENT,   FAN_DUTY_SILENT);
+        mode_fan_duty[PUMP_MODE_QUIET]     = fan_duty_for(FAN_RPM_QUIET,    FAN_DUTY_QUIET);
+        mode_fan_duty[PUMP_MODE_BALANCED]  = fan_duty_for(FAN_RPM_BALANCED, FAN_DUTY_BALANCED);
+    }
+
+    mode_pump_duty[PUMP_MODE_AUTO] = mode_pump_duty[PUMP_MODE_SILENT];
+    mode_fan_duty[PUMP_MODE_AUTO]  = mode_fan_duty[PUMP_MODE_SILENT];
+
+    CCLog(CC_LOG_INFO, "%s: calibrated duties pump %u/%u/%u%% (floor %u%%), fans %u/%u/%u%% (floor %u%%)",
+          serial.c_str(),
+          (unsigned)mode_pump_duty[PUMP_MODE_SILENT], (unsigned)mode_pump_duty[PUMP_MODE_QUIET],
+          (unsigned)mode_pump_duty[PUMP_MODE_BALANCED], (unsigned)pump_floor,
+          (unsigned)mode_fan_duty[PUMP_MODE_SILENT], (unsigned)mode_fan_duty[PUMP_MODE_QUIET],
+          (unsigned)mode_fan_duty[PUMP_MODE_BALANCED], (unsigned)fan_floor);
 }
 
 /*---------------------------------------------------------------------*\
-| Linear interpolation across the pump curve                            |
+| Metrics bookkeeping. RecordTransfer runs under io_mutex at the end    |
+| of every Transfer(); GetStats only copies cached values, so a scrape  |
+| never waits on device I/O.                                            |
 \*---------------------------------------------------------------------*/
 
-uint8_t CorsairCapellixXTController::EvalCurve(const std::vector<CurvePoint>& curve, float tempC)
+void CorsairCapellixXTController::RecordTransfer(std::chrono::steady_clock::duration elapsed,
+                                                 CorsairTransferStatus status)
 {
-    if(curve.empty())
-    {
-        return PUMP_DUTY_MIN;
-    }
-
-    if(tempC <= curve.front().tempC)
+    if(status == CC_TRANSFER_TIMEOUT)
     {
-        return curve.front().duty;
+        transfer_timeouts++;
     }
-    if(tempC >= curve.back().tempC)
+    else if(status == CC_TRANSFER_IO_ERROR)
     {
-        return curve.back().duty;
+        transfer_io_errors++;
     }
 
-    for(size_t i = 1; i < curve.size(); i++)
+    double seconds = std::chrono::duration<double>(elapsed).count();
+
+    std::lock_guard<std::mutex> lock(stats_mutex);
+
+    for(unsigned int i = 0; i < CC_LATENCY_BUCKET_COUNT; i++)
     {
-        const CurvePoint& a = curve[i - 1];
-        const CurvePoint& b = curve[i];
-        if(tempC <= b.tempC)
+        if(seconds <= CC_LATENCY_BUCKETS_S[i])
         {
-            float span = b.tempC - a.tempC;
-            float frac = span > 0.0f ? (tempC - a.tempC) / span : 0.0f;
-            float duty = a.duty + frac * ((float)b.duty - (float)a.duty);
-            return (uint8_t)(duty + 0.5f);
+            latency_buckets[i]++;
+            break;
         }
     }
 
-    return curve.back().duty;
+    latency_count++;
+    latency_sum_s += seconds;
 }
 
 /*---------------------------------------------------------------------*\
-| Read liquid temp, evaluate the curve, drive the pump                  |
+| Device lock for one cooling step. Announces itself first so a color   |
+| frame on another thread yields at its next chunk boundary; the time   |
+| until the lock is held is the cooling latency that lighting adds,     |
+| kept as a histogram and worst case for the metrics.                   |
 \*---------------------------------------------------------------------*/
 
-void CorsairCapellixXTController::UpdatePumpFromCurve()
+std::unique_lock<std::recursive_mutex> CorsairCapellixXTController::LockForCooling()
 {
-    if(pump_mode.load() == PUMP_MODE_DISABLED)
-    {
-        /*-------------------------------------------------------------*\
-        | Hands off: don't send any speed commands so the pump/fans run |
-        | on their own (or under an external tool). RGB is unaffected.  |
-        \*-------------------------------------------------------------*/
-        printf("[CommanderCore] mode=Disabled (pump/fans not managed)\n");
-        fflush(stdout);
-        return;
-    }
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    cooling_waiters++;
+
+    std::unique_lock<std::recursive_mutex> io_lock(io_mutex);
 
-    float tempC = ReadLiquidTemp();
-    if(tempC >= 0.0f)
     {
-        last_liquid_temp.store(tempC);
+        std::lock_guard<std::mutex> lock(priority_mutex);
+        cooling_waiters--;
     }
+    priority_cv.notify_all();
 
-    int         mode = pump_mode.load();
-    const char* mode_name;
-    uint8_t     pump_duty;
-    uint8_t     fan_duty;
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
 
-    switch(mode)
+    std::lock_guard<std::mutex> lock(stats_mutex);
+
+    for(unsigned int i = 0; i < CC_LATENCY_BUCKET_COUNT; i++)
     {
-        case PUMP_MODE_SILENT:       pump_duty = PUMP_DUTY_SILENT;      fan_duty = FAN_DUTY_SILENT;      mode_name = "Silent";      break;
-        case PUMP_MODE_QUIET:        pump_duty = PUMP_DUTY_QUIET;       fan_duty = FAN_DUTY_QUIET;       mode_name = "Quiet";       break;
-        case PUMP_MODE_BALANCED:     pump_duty = PUMP_DUTY_BALANCED;    fan_duty = FAN_DUTY_BALANCED;    mode_name = "Balanced";    break;
-        case PUMP_MODE_PERFORMANCE:  pump_duty = PUMP_DUTY_PERFORMANCE; fan_duty = FAN_DUTY_PERFORMANCE; mode_name = "Performance"; break;
-        case PUMP_MODE_AUTO:
-        default:
-            mode_name = "Auto";
-            if(tempC >= 0.0f)
-            {
-                pump_duty = EvalCurve(pump_curve, tempC);
-                fan_duty  = EvalCurve(fan_curve,  tempC);
-            }
-            else
-            {
-                pump_duty = last_pump_duty.load();
-                fan_duty  = last_fan_duty.load();
-            }
+        if(seconds <= CC_LATENCY_BUCKETS_S[i])
+        {
+            cooling_wait_buckets[i]++;
             break;
+        }
     }
 
-    SetCooling(pump_duty, fan_duty);
+    cooling_wait_count++;
+    cooling_wait_sum_s += seconds;
+    cooling_wait_max_s  = std::max(cooling_wait_max_s, seconds);
 
-    int prpm = ReadPumpRpm();
-    int frpm = ReadFanRpm();
-    printf("[CommanderCore] mode=%s liquid=%.1fC | pump=%u%%/%drpm | fans=%u%%/%drpm\n",
-           mode_name, tempC, (unsigned)pump_duty, prpm, (unsigned)fan_duty, frpm);
-    fflush(stdout);
+    return io_lock;
 }
 
-void CorsairCapellixXTController::SetPumpCurve(const std::vector<CurvePoint>& points)
+/*---------------------------------------------------------------------*\
+| Frame sync group hooks                                                |
+\*---------------------------------------------------------------------*/
+
+void CorsairCapellixXTController::SetFrameSync(CorsairCapellixXTFrameSync* sync)
 {
-    if(!points.empty())
-    {
-        pump_curve = points;
-    }
+    std::lock_guard<std::recursive_mutex> io_lock(io_mutex);
+    frame_sync = sync;
 }
 
-float CorsairCapellixXTController::GetLastLiquidTemp()
+bool CorsairCapellixXTController::CoolingWaiting()
 {
-    return last_liquid_temp.load();
+    return cooling_waiters.load() > 0;
 }
 
-uint8_t CorsairCapellixXTController::GetLastPumpDuty()
+void CorsairCapellixXTController::RecordFrameSync(double skew_s, bool complete)
 {
-    return last_pump_duty.load();
+    std::lock_guard<std::mutex> lock(stats_mutex);
+
+    for(unsigned int i = 0; i < CC_SKEW_BUCKET_COUNT; i++)
+    {
+        if(skew_s <= CC_SKEW_BUCKETS_S[i])
+        {
+            sync_skew_buckets[i]++;
+            break;
+        }
+    }
+
+    sync_skew_count++;
+    sync_skew_sum_s += skew_s;
+    sync_skew_max_s  = std::max(sync_skew_max_s, skew_s);
+
+    if(!complete)
+    {
+        sync_partial++;
+    }
 }
 
 /*---------------------------------------------------------------------*\
-| Pump mode selection + persistence                                     |
+| Bring-up phase timings: each call stores the time since start for the |
+| phase and returns now, to chain into the next phase. Logged at info   |
+| once per bring-up, phases not run are left out.                       |
 \*---------------------------------------------------------------------*/
 
-static std::string PumpModeConfigPath()
+std::chrono::steady_clock::time_point CorsairCapellixXTController::RecordInitPhase(
+    CorsairInitPhase phase, std::chrono::steady_clock::time_point start)
 {
-    const char* home = getenv("HOME");
-    if(home == nullptr)
-    {
-        return "";
-    }
-    return std::string(home) + "/.config/OpenRGB/plugins/settings/CommanderCorePump.conf";
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    init_phase_s[phase] = std::chrono::duration<double>(now - start).count();
+
+    return now;
 }
 
-void CorsairCapellixXTController::SetPumpMode(int mode)
+void CorsairCapellixXTController::LogInitPhases(const char* what)
 {
-    if(mode < PUMP_MODE_AUTO || mode > PUMP_MODE_DISABLED)
+    char   line[CC_LOG_LINE_MAX];
+    size_t used = 0;
+
     {
-        mode = PUMP_MODE_AUTO;
+        std::lock_guard<std::mutex> lock(stats_mutex);
+
+        for(unsigned int phase = 0; phase < CC_INIT_PHASE_COUNT && used < sizeof(line); phase++)
+        {
+            if(init_phase_s[phase] >= 0.0)
+            {
+                used += snprintf(line + used, sizeof(line) - used, " %s_ms=%.1f",
+                                 CC_INIT_PHASE_NAMES[phase], init_phase_s[phase] * 1000.0);
+            }
+        }
     }
-    pump_mode.store(mode);
-    SavePumpMode();
-    UpdatePumpFromCurve();      // apply the new mode immediately
-}
 
-int CorsairCapellixXTController::GetPumpMode()
-{
-    return pump_mode.load();
+    line[std::min(used, sizeof(line) - 1)] = '\0';
+
+    CCLog(CC_LOG_INFO, "serial=%s %s:%s", serial.c_str(), what, line);
 }
 
-void CorsairCapellixXTController::LoadPumpMode()
+CorsairCapellixXTStats CorsairCapellixXTController::GetStats()
 {
-    std::string path = PumpModeConfigPath();
-    if(path.empty())
-    {
-        return;
-    }
-    FILE* f = fopen(path.c_str(), "r");
-    if(f == nullptr)
-    {
-        return;                 // no saved file yet -> stays default (Auto)
-    }
-    int m = PUMP_MODE_AUTO;
-    if(fscanf(f, "%d", &m) == 1 && m >= PUMP_MODE_AUTO && m <= PUMP_MODE_DISABLED)
+    CorsairCapellixXTStats stats;
+
+    stats.connected         = connected.load();
+    stats.breaker_open      = breaker_open.load();
+    stats.pump_mode         = pump_mode.load();
+    stats.liquid_temp       = last_liquid_temp.load() > 0.0f ? last_liquid_temp.load() : -1.0f;
+    stats.pump_duty         = last_pump_duty.load();
+    stats.fan_duty          = last_fan_duty.load();
+    stats.timeouts          = transfer_timeouts.load();
+    stats.io_errors         = transfer_io_errors.load();
+    stats.bad_replies       = bad_replies.load();
+    stats.breaker_trips     = breaker_trips.load();
+    stats.reconnects        = reconnects.load();
+    stats.frames_sent       = frames_sent.load();
+    stats.frames_skipped    = frames_skipped.load();
+    stats.stale_replies     = stale_replies.load();
+    stats.rejected_readings = rejected_readings.load();
+    stats.keepalive_strategy = keepalive_strategy.load();
+    stats.frame_layout       = frame_layout.load();
+    stats.keepalives         = keepalives.load();
+    stats.keepalive_bytes    = keepalive_bytes.load();
+    stats.keepalive_lock_s   = keepalive_lock_ns.load() / 1e9;
+    stats.profile            = GetActiveProfile();   // takes curve_mutex, so before stats_mutex
+    stats.profile_switches   = profile_switches.load();
+
+    std::lock_guard<std::mutex> lock(stats_mutex);
+
+    stats.rpm                = last_rpms;
+    stats.watchdog_alarm     = watchdog_alarm.load();
+    stats.watchdog_alarms    = watchdog_alarms.load();
+    stats.speed_write_age_s  = last_speed_write_ns.load() > 0
+                             ? (CCSteadyNs() - last_speed_write_ns.load()) / 1e9 : -1.0;
+    stats.sensor_read_age_s  = last_sensor_read_ns.load() > 0
+                             ? (CCSteadyNs() - last_sensor_read_ns.load()) / 1e9 : -1.0;
+    stats.frame_yields       = frame_yields.load();
+    stats.cooling_wait_count = cooling_wait_count;
+    stats.cooling_wait_sum_s = cooling_wait_sum_s;
+    stats.cooling_wait_max_s = cooling_wait_max_s;
+    stats.sync_skew_count    = sync_skew_count;
+    stats.sync_skew_sum_s    = sync_skew_sum_s;
+    stats.sync_skew_max_s    = sync_skew_max_s;
+    stats.sync_partial       = sync_partial;
+    stats.profile_burst_s    = profile_burst_s;
+    stats.fan_sources   = last_fan_sources;
+    stats.latency_count = latency_count;
+    stats.latency_sum_s = latency_sum_s;
+
+    for(unsigned int i = 0; i < CC_LATENCY_BUCKET_COUNT; i++)
     {
-        pump_mode.store(m);
+        stats.latency_buckets[i]      = latency_buckets[i];
+        stats.cooling_wait_buckets[i] = cooling_wait_buckets[i];
     }
-    fclose(f);
-}
 
-void CorsairCapellixXTController::SavePumpMode()
-{
-    std::string path = PumpModeConfigPath();
-    if(path.empty())
+    for(unsigned int i = 0; i < CC_SKEW_BUCKET_COUNT; i++)
     {
-        return;
+        stats.sync_skew_buckets[i] = sync_skew_buckets[i];
     }
-    FILE* f = fopen(path.c_str(), "w");
-    if(f == nullptr)
+
+    for(unsigned int phase = 0; phase < CC_INIT_PHASE_COUNT; phase++)
     {
-        return;
+        stats.init_phase_s[phase] = init_phase_s[phase];
     }
-    fprintf(f, "%d\n", pump_mode.load());
-    fclose(f);
+
+    return stats;
 }
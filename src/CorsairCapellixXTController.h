@@ -6,8 +6,17 @@
 #include <atomic>
 #include <thread>
 #include <mutex>
+#include <condition_variable>
 #include <chrono>
+#include <initializer_list>
 #include <hidapi.h>
+#include "CorsairCapellixXTCalibration.h"
+#include "CorsairCapellixXTColor.h"
+#include "CorsairCapellixXTHwmon.h"
+#include "CorsairCapellixXTLoad.h"
+#include "CorsairCapellixXTLog.h"
+#include "CorsairCapellixXTTelemetry.h"
+#include "CorsairCapellixXTTransport.h"
 
 // Commander Core USB identifiers (verified against OpenLinkHub's device list).
 //   0x0C1C / 0x0C32 are AIO controllers (Capellix / Capellix XT) - this plugin's
@@ -34,6 +43,8 @@ static const size_t COMMANDER_CORE_PID_COUNT = 3;
 #define CC_LED_START_INDEX          6       // LED data offset in read response
 #define CC_LED_BYTES_PER_CHANNEL    4       // bytes per channel in LED config
 #define CC_MAX_LED_CHANNELS         7       // max LED channels on Commander Core
+#define CC_LED_READY_POLL_MS        20      // LED config polls while the ports come up
+#define CC_LED_READY_TIMEOUT_MS     1000    // give up waiting for a valid LED config
 
 // Command bytes (endpoint parameter to transfer())
 #define CMD_OPEN_ENDPOINT_0         0x0D
@@ -72,6 +83,23 @@ static const size_t COMMANDER_CORE_PID_COUNT = 3;
 #define MODE_GET_LEDS               0x20
 #define MODE_SET_COLOR              0x22
 
+// Reply layout: [0] = 0x00 for command replies, [1] = echo of the command's
+// first byte, [2] = status (0x00 = ok). Endpoint reads then carry the data
+// type at [3..4] and the payload from [5].
+#define CC_REPLY_ECHO_INDEX         1
+#define CC_REPLY_STATUS_INDEX       2
+#define CC_REPLY_DATA_TYPE_INDEX    3
+#define CC_REPLY_STATUS_OK          0x00
+#define CC_DRAIN_MAX_REPORTS        16      // stale reports discarded before each write
+
+// Data types returned by endpoint reads
+#define DATA_TYPE_GET_SPEEDS_0      0x06
+#define DATA_TYPE_GET_SPEEDS_1      0x00
+#define DATA_TYPE_GET_LEDS_0        0x0F
+#define DATA_TYPE_GET_LEDS_1        0x00
+#define DATA_TYPE_GET_TEMPS_0       0x10
+#define DATA_TYPE_GET_TEMPS_1       0x00
+
 // Data type prefix for color writes
 #define DATA_TYPE_SET_COLOR_0       0x12
 #define DATA_TYPE_SET_COLOR_1       0x00
@@ -97,6 +125,215 @@ static const size_t COMMANDER_CORE_PID_COUNT = 3;
 #define PUMP_DUTY_MIN               30      // SAFETY floor: <=10% stops the pump (no coolant flow)
 #define PUMP_DUTY_MAX               100
 #define PUMP_UPDATE_INTERVAL_SEC    3       // re-evaluate the curve every N seconds
+#define CC_KEEPALIVE_INTERVAL_SEC   10      // resend the frame after N idle seconds
+#define CC_RECONNECT_POLL_MS        250     // reopen attempts while disconnected
+
+// Cooling I/O priority: a color frame from another thread gives up the device
+// lock at a chunk boundary while a cooling step waits for it, then restarts
+// from its first chunk. At most CC_COLOR_MAX_YIELDS yields per frame, each
+// waiting at most CC_COLOR_YIELD_WAIT_MS, so lighting cannot starve either.
+#define CC_COLOR_MAX_YIELDS         4
+#define CC_COLOR_YIELD_WAIT_MS      250
+
+// CPU load feed-forward for Auto mode (off unless the curves file has a
+// "feedforward <max C>" line). Sustained load above CC_FF_LOAD_START_PCT raises
+// the temperature the curves see by up to max C at 100 % load, in full for
+// CC_FF_HOLD_SEC from the start of the burst, then fading out over
+// CC_FF_FADE_SEC as the liquid temperature catches up. A new burst needs
+// CC_FF_REARM_TICKS quiet ticks first.
+#define CC_FF_LOAD_START_PCT        60
+#define CC_FF_SUSTAIN_TICKS         2       // busy ticks in a row before boosting
+#define CC_FF_HOLD_SEC              45
+#define CC_FF_FADE_SEC              60
+#define CC_FF_REARM_TICKS           10
+#define CC_FF_MAX_C                 20.0f   // upper bound for the configured boost
+
+// Hardware-mode fallback detection for the ping keepalive: the pump runs this
+// much faster than the model predicts for the written duty, on this many ticks
+// in a row with the duty unchanged
+#define CC_REVERT_MIN_RPM_DELTA     600
+#define CC_REVERT_MIN_RPM_PCT       40
+#define CC_REVERT_TICKS             2
+
+// Sensor plausibility. Readings outside these bounds never reach the curve.
+// A liquid temperature jump larger than CC_LIQUID_TEMP_MAX_STEP_C is held back
+// until a second reading confirms it.
+#define CC_LIQUID_TEMP_MIN_C        5.0f
+#define CC_LIQUID_TEMP_MAX_C        90.0f
+#define CC_LIQUID_TEMP_MAX_STEP_C   8.0f
+#define CC_RPM_MAX                  10000
+
+// Transfer deadlines and circuit breaker. A command gets CC_TRANSFER_ATTEMPTS
+// tries within CC_COMMAND_DEADLINE_MS, so one transfer never holds io_mutex for
+// longer than that. After CC_BREAKER_THRESHOLD consecutive failed commands the
+// breaker trips: commands fail immediately and a single firmware query probes
+// the device every CC_BREAKER_PROBE_MS until it answers again.
+#define CC_READ_TIMEOUT_MS          200     // per-attempt reply wait
+#define CC_COMMAND_DEADLINE_MS      400     // total budget for one command
+#define CC_TRANSFER_ATTEMPTS        2       // first try + one retry on timeout
+#define CC_BREAKER_THRESHOLD        5       // consecutive failures before tripping
+#define CC_BREAKER_PROBE_MS         2000    // probe interval while tripped
+#define CC_BREAKER_PROBE_TIMEOUT_MS 100     // reply wait for the probe itself
+#define CC_BREAKER_LOG_INTERVAL_MS  30000   // breaker trips logged at most this often
+
+// Outcome of a single command on the HID pipe
+enum CorsairTransferStatus
+{
+    CC_TRANSFER_OK              = 0,    // reply received
+    CC_TRANSFER_TIMEOUT         = 1,    // no reply before the command deadline
+    CC_TRANSFER_IO_ERROR        = 2,    // hid_write / hid_read failed (device gone)
+    CC_TRANSFER_DISCONNECTED    = 3,    // no open handle, nothing sent
+    CC_TRANSFER_BREAKER_OPEN    = 4,    // circuit breaker tripped, nothing sent
+    CC_TRANSFER_BAD_REPLY       = 5,    // reply failed status / data type validation
+    CC_TRANSFER_TOO_LONG        = 6,    // payload does not fit a write report, nothing sent
+};
+
+struct TransferResult
+{
+    CorsairTransferStatus   status = CC_TRANSFER_DISCONNECTED;
+    std::vector<uint8_t>    data;
+
+    bool                    ok() const { return status == CC_TRANSFER_OK; }
+};
+
+// Command bytes for one Transfer() (at most four), built in place from a brace
+// list such as {CMD_READ_0, CMD_READ_1} without a heap allocation
+struct CCCommand
+{
+    uint8_t                 bytes[4];
+    uint8_t                 length;
+
+    constexpr CCCommand(std::initializer_list<uint8_t> list)
+        : bytes{}, length(0)
+    {
+        for(uint8_t b : list)
+        {
+            if(length < sizeof(bytes))
+            {
+                bytes[length++] = b;
+            }
+        }
+    }
+};
+
+// Non-owning view of payload bytes: a vector, an array or pointer + length
+struct CCBytes
+{
+    const uint8_t*          data;
+    size_t                  size;
+
+    CCBytes() : data(nullptr), size(0) {}
+    CCBytes(const uint8_t* d, size_t n) : data(d), size(n) {}
+    CCBytes(const std::vector<uint8_t>& v) : data(v.data()), size(v.size()) {}
+    template<size_t N> CCBytes(const uint8_t (&a)[N]) : data(a), size(N) {}
+};
+
+struct CorsairCapellixXTProtocol;
+class CorsairCapellixXTFrameSync;
+
+// Upper bounds (seconds) of the Transfer() latency histogram kept for the
+// metrics exporter; the final +Inf bucket is implied
+#define CC_LATENCY_BUCKET_COUNT     8
+static const double CC_LATENCY_BUCKETS_S[CC_LATENCY_BUCKET_COUNT] =
+{
+    0.002, 0.005, 0.010, 0.020, 0.050, 0.100, 0.200, 0.500
+};
+
+// Upper bounds (seconds) of the frame sync skew histogram, finer than the above
+#define CC_SKEW_BUCKET_COUNT        7
+static const double CC_SKEW_BUCKETS_S[CC_SKEW_BUCKET_COUNT] =
+{
+    0.0002, 0.0005, 0.001, 0.002, 0.005, 0.010, 0.020
+};
+
+// How the idle keepalive proves to the firmware that software control is alive
+enum CorsairKeepaliveStrategy
+{
+    CC_KEEPALIVE_PING           = 0,    // one firmware query
+    CC_KEEPALIVE_FRAME          = 1,    // resend the whole color frame
+};
+
+// Color frame layout. Fan ports sit in fixed CC_FAN_SLOT_LEDS slots; only the
+// last one's padding is not needed to place any LED, so frames end after the
+// last LED unless the firmware rejected that once.
+enum CorsairFrameLayout
+{
+    CC_FRAME_LAYOUT_TRIMMED     = 0,    // no padding after the last LED
+    CC_FRAME_LAYOUT_PADDED      = 1,    // every fan slot padded, the last one too
+};
+
+// Bring-up phases timed for the log and the metrics exporter
+enum CorsairInitPhase
+{
+    CC_INIT_FIRMWARE            = 0,    // firmware version query
+    CC_INIT_SOFTWARE_MODE       = 1,    // switch to software control
+    CC_INIT_LED_PORTS           = 2,    // the seven port-init commands
+    CC_INIT_LED_READY           = 3,    // port init until the LED config reads back valid
+    CC_INIT_COLOR_ENDPOINT      = 4,    // open the color endpoint
+    CC_INIT_COOLING             = 5,    // first speed write
+    CC_INIT_PHASE_COUNT
+};
+
+static const char* const CC_INIT_PHASE_NAMES[CC_INIT_PHASE_COUNT] =
+{
+    "firmware", "software_mode", "led_ports", "led_ready", "color_endpoint", "cooling"
+};
+
+// Cached device state and I/O counters. Filled from values the service
+// thread already keeps, so taking a snapshot never touches the device.
+struct CorsairCapellixXTStats
+{
+    bool                    connected;
+    bool                    breaker_open;
+    int                     pump_mode;
+    float                   liquid_temp;            // < 0 until the first reading
+    uint8_t                 pump_duty;
+    uint8_t                 fan_duty;
+    std::vector<int>        rpm;                    // per speed channel, -1 = no reading
+    std::vector<std::pair<std::string, float>> fan_sources;     // "chip/label", last tick's valid readings
+    std::string             profile;                // active profile, empty = none
+    uint64_t                profile_switches;
+    double                  profile_burst_s;        // last switch's I/O burst, < 0 = none yet
+
+    uint64_t                latency_buckets[CC_LATENCY_BUCKET_COUNT];   // not cumulative
+    uint64_t                latency_count;
+    double                  latency_sum_s;
+
+    uint64_t                timeouts;
+    uint64_t                io_errors;
+    uint64_t                bad_replies;
+    uint64_t                breaker_trips;
+    uint64_t                reconnects;
+    uint64_t                frames_sent;
+    uint64_t                frames_skipped;         // abandoned after a failed chunk
+    uint64_t                stale_replies;
+    uint64_t                rejected_readings;
+
+    int                     keepalive_strategy;     // CorsairKeepaliveStrategy
+    int                     frame_layout;           // CorsairFrameLayout
+    uint64_t                keepalives;
+    uint64_t                keepalive_bytes;        // report bytes written, retries included
+    double                  keepalive_lock_s;       // io_mutex held by keepalives
+
+    uint64_t                cooling_wait_buckets[CC_LATENCY_BUCKET_COUNT];  // not cumulative
+    uint64_t                cooling_wait_count;
+    double                  cooling_wait_sum_s;
+    double                  cooling_wait_max_s;     // worst wait for the device lock
+    uint64_t                frame_yields;           // color frames restarted for cooling
+
+    uint64_t                sync_skew_buckets[CC_SKEW_BUCKET_COUNT];    // not cumulative
+    uint64_t                sync_skew_count;        // synced frames (rounds this device was in)
+    double                  sync_skew_sum_s;
+    double                  sync_skew_max_s;        // worst spread of last-chunk completions
+    uint64_t                sync_partial;           // rounds released without every member
+
+    bool                    watchdog_alarm;
+    uint64_t                watchdog_alarms;
+    double                  speed_write_age_s;      // since the control loop's last speed write
+    double                  sensor_read_age_s;      // since its last sensor read
+
+    double                  init_phase_s[CC_INIT_PHASE_COUNT];     // last bring-up, < 0 = not run
+};
 
 // Selectable pump operating modes (exposed as radio buttons in the plugin pane).
 // Fixed-mode duties are calibrated from the measured duty->RPM sweep on this pump.
@@ -108,6 +345,7 @@ enum CorsairPumpMode
     PUMP_MODE_BALANCED    = 3,   // fixed, ~iCUE "Balanced" band
     PUMP_MODE_PERFORMANCE = 4,   // fixed, ~iCUE "Extreme"  band
     PUMP_MODE_DISABLED    = 5,   // hands off — let the pump/fans run externally
+    PUMP_MODE_TARGET      = 6,   // closed loop: hold the target pump / fan RPMs
 };
 
 #define PUMP_DUTY_SILENT            30      // ~1130 rpm (quietest safe flow)
@@ -115,6 +353,17 @@ enum CorsairPumpMode
 #define PUMP_DUTY_BALANCED          80      // ~2500 rpm
 #define PUMP_DUTY_PERFORMANCE      100      // ~2800 rpm
 
+// Reference speeds the fixed duties were tuned for. A calibrated device
+// gets whichever duty reaches the same speed on its own pump and fans.
+#define PUMP_RPM_SILENT             1130
+#define PUMP_RPM_QUIET              2150
+#define PUMP_RPM_BALANCED           2500
+#define PUMP_RPM_PERFORMANCE        2800
+#define FAN_RPM_SILENT              560
+#define FAN_RPM_QUIET               1040
+#define FAN_RPM_BALANCED            1550
+#define FAN_RPM_PERFORMANCE         2140
+
 // Radiator fans are speed channels 1..6 (channel 0 is the pump). Each mode
 // drives the fans too, so "Silent" actually quiets the loudest component.
 #define FAN_CHANNEL_FIRST           1
@@ -125,6 +374,33 @@ enum CorsairPumpMode
 #define FAN_DUTY_BALANCED           65
 #define FAN_DUTY_PERFORMANCE       100
 
+// Target RPM mode. Each tick the duty comes from the duty->RPM model (the
+// calibration table, or the reference speeds above without one) evaluated at
+// target + correction; the correction takes CC_TARGET_GAIN_PCT of the remaining
+// error, limited to CC_TARGET_MAX_CORRECTION_PCT of the target. Errors inside
+// the deadband are left alone, and the duty changes at most every
+// CC_TARGET_MIN_CHANGE_SEC (unchanged duties are still resent each tick).
+#define CC_TARGET_DEFAULT_PUMP_RPM  PUMP_RPM_QUIET
+#define CC_TARGET_DEFAULT_FAN_RPM   FAN_RPM_QUIET
+#define CC_TARGET_GAIN_PCT          80
+#define CC_TARGET_MAX_CORRECTION_PCT 50
+#define CC_TARGET_DEADBAND_RPM      40
+#define CC_TARGET_MIN_CHANGE_SEC    6
+
+// One feedback step: moves correction by the gain share of target - measured
+// and clamps it; no-op inside the deadband or without a reading (measured < 0)
+void CCUpdateTargetCorrection(float& correction, int target, int measured);
+
+// Calibration sweep timing: wait CC_CALIBRATION_SETTLE_MS after each duty
+// change, then sample every CC_CALIBRATION_SAMPLE_MS until two readings agree
+// within CC_CALIBRATION_TOLERANCE_PCT (at most CC_CALIBRATION_MAX_SAMPLES).
+// The sweep is abandoned if the liquid warms past CC_CALIBRATION_MAX_LIQUID_C.
+#define CC_CALIBRATION_SETTLE_MS    4000
+#define CC_CALIBRATION_SAMPLE_MS    1000
+#define CC_CALIBRATION_MAX_SAMPLES  8
+#define CC_CALIBRATION_TOLERANCE_PCT 3
+#define CC_CALIBRATION_MAX_LIQUID_C 50.0f
+
 // A single (liquid temperature -> pump duty%) point on the control curve
 struct CurvePoint
 {
@@ -132,6 +408,23 @@ struct CurvePoint
     uint8_t         duty;
 };
 
+// A named profile from the profiles file: everything a switch changes at once.
+// Colors are RGB24 wire bytes; a zone without its own uses all_color, and
+// one without either keeps what it shows.
+struct CCProfile
+{
+    std::string                         name;
+    int                                 mode;               // CorsairPumpMode, -1 = unchanged
+    int                                 pump_duty;          // replaces the fixed mode's duties, -1 = none
+    int                                 fan_duty;
+    std::vector<CurvePoint>             pump_curve;         // Auto curves, empty = the curves file's
+    std::vector<CurvePoint>             fan_curve;
+    int                                 pump_target_rpm;    // Target RPM speeds, -1 = unchanged
+    int                                 fan_target_rpm;
+    std::vector<uint8_t>                all_color;          // 3 bytes, or empty
+    std::vector<std::vector<uint8_t>>   zone_colors;        // per zone, one color or one per LED
+};
+
 struct ChannelInfo
 {
     unsigned int    port;
@@ -139,10 +432,16 @@ struct ChannelInfo
     std::string     name;
 };
 
+// Each fan port (zones 1+) occupies a fixed slot of this many LEDs in the
+// color frame, however many LEDs the fan has; the pump head is not padded,
+// and neither is the last fan in the trimmed layout.
+#define CC_FAN_SLOT_LEDS            34
+
 class CorsairCapellixXTController
 {
 public:
     CorsairCapellixXTController(hid_device* dev, const char* path, uint16_t pid);
+    CorsairCapellixXTController(CorsairCapellixXTTransport* transport, const char* path, uint16_t pid);
     ~CorsairCapellixXTController();
 
     std::string                 GetDevicePath();
@@ -150,29 +449,87 @@ public:
     std::string                 GetSerialString();
     std::string                 GetDeviceName();
     uint16_t                    GetProductID();
+    bool                        HasPump();
 
     unsigned int                GetTotalLEDCount();
     std::vector<ChannelInfo>&   GetChannels();
+    unsigned int                GetFrameSlotLeds(unsigned int zone);
+
+    /*-----------------------------------------------------------------*\
+    | This device's color correction, loaded once at construction and   |
+    | shared with the RGBController so profile frames match its frames |
+    \*-----------------------------------------------------------------*/
+    const CorsairCapellixXTColorCorrection& GetColorCorrection() const;
 
-    void                        Initialize();
+    void                        Initialize(bool with_lighting = true);
     void                        SetSoftwareMode();
     void                        SetHardwareMode();
     void                        QueryLEDConfig();
-    void                        SendColors(const std::vector<uint8_t>& color_data);
+    void                        SendColors(const std::vector<uint8_t>& color_data, bool synced = true);
 
     void                        StartKeepalive();
     void                        StopKeepalive();
 
     /*-----------------------------------------------------------------*\
-    | Pump speed control (liquid-temp curve, runs in the keepalive      |
+    | Called by the shared service thread only: one unit of periodic    |
+    | work, returns when this device next needs servicing               |
+    \*-----------------------------------------------------------------*/
+    std::chrono::steady_clock::time_point ServiceStep(std::chrono::steady_clock::time_point now);
+
+    /*-----------------------------------------------------------------*\
+    | Hotplug: a failed HID call marks the device disconnected; the     |
+    | hotplug monitor (or the service thread's poll) reopens the same    |
+    | serial and replays software mode, endpoints, colors and cooling    |
+    \*-----------------------------------------------------------------*/
+    bool                        IsConnected();
+    void                        MarkDisconnected();
+    bool                        Reconnect();
+
+    /*-----------------------------------------------------------------*\
+    | The system woke from suspend: the device came back in its         |
+    | hardware default, so replay state on the service thread now       |
+    \*-----------------------------------------------------------------*/
+    void                        NotifyResume();
+    bool                        IsResponding();
+
+    /*-----------------------------------------------------------------*\
+    | Watchdog (CorsairCapellixXTWatchdog): when the control loop last  |
+    | wrote speeds and read sensors, and the alarm it raises. Exempt    |
+    | while there is no loop to watch (disconnected, Disabled, no pump, |
+    | calibrating). NotifyWatchdog() asks for a state replay; the       |
+    | failsafe write runs on the caller's thread and gives up if the    |
+    | device lock stays held. GetWatchdogAlarm() is empty if no alarm.  |
+    \*-----------------------------------------------------------------*/
+    bool                        WatchdogExempt();
+    std::chrono::steady_clock::time_point GetLastSpeedWrite();
+    std::chrono::steady_clock::time_point GetLastSensorRead();
+    void                        SetWatchdogAlarm(const std::string& reason);
+    std::string                 GetWatchdogAlarm();
+    void                        NotifyWatchdog();
+    bool                        WriteFailsafeSpeeds(int lock_timeout_ms);
+
+    /*-----------------------------------------------------------------*\
+    | Frame sync group (CorsairCapellixXTFrameSync): frames sent with   |
+    | synced set finish together with the other members'. Keepalive     |
+    | resends are not synced. SetFrameSync() waits for a frame in       |
+    | flight, so the group can be deleted once it returns.              |
+    \*-----------------------------------------------------------------*/
+    void                        SetFrameSync(CorsairCapellixXTFrameSync* sync);
+    bool                        CoolingWaiting();
+    void                        RecordFrameSync(double skew_s, bool complete);
+
+    /*-----------------------------------------------------------------*\
+    | Pump speed control (liquid-temp curve, runs on the service        |
     | thread so it shares this process's exclusive device access)       |
     \*-----------------------------------------------------------------*/
     void                        SetPumpDuty(uint8_t duty);
-    void                        SetCooling(uint8_t pump_duty, uint8_t fan_duty);
+    bool                        SetCooling(uint8_t pump_duty, uint8_t fan_duty);
     float                       ReadLiquidTemp();
+    bool                        ReadSpeeds(std::vector<int>& rpm);
     int                         ReadPumpRpm();
     int                         ReadFanRpm();
     void                        SetPumpCurve(const std::vector<CurvePoint>& points);
+    void                        SetFanCurve(const std::vector<CurvePoint>& points);
     float                       GetLastLiquidTemp();
     uint8_t                     GetLastPumpDuty();
 
@@ -183,15 +540,50 @@ public:
     void                        SetPumpMode(int mode);
     int                         GetPumpMode();
 
+    /*-----------------------------------------------------------------*\
+    | Targets for PUMP_MODE_TARGET, persisted like the mode              |
+    \*-----------------------------------------------------------------*/
+    void                        SetSpeedTargets(int pump_rpm, int fan_rpm);
+    void                        GetSpeedTargets(int& pump_rpm, int& fan_rpm);
+
+    /*-----------------------------------------------------------------*\
+    | Re-read the mode / curve files written by another process         |
+    \*-----------------------------------------------------------------*/
+    void                        ReloadSettings();
+
+    /*-----------------------------------------------------------------*\
+    | Profiles (CommanderCoreProfiles.conf), loaded with the other      |
+    | settings. ApplyProfile() switches at once and hands the service   |
+    | thread one burst: speeds and frame under a single lock. False if  |
+    | there is no such profile. Choosing a mode leaves the profile.     |
+    \*-----------------------------------------------------------------*/
+    std::vector<std::string>    GetProfileNames();
+    std::string                 GetActiveProfile();
+    bool                        ApplyProfile(const std::string& name);
+
+    /*-----------------------------------------------------------------*\
+    | Duty -> RPM calibration sweep, run on the service thread. Refused |
+    | without a pump and in Disabled mode (it drives the speeds).        |
+    | Progress is 0..100 while running, -1 otherwise.                    |
+    \*-----------------------------------------------------------------*/
+    bool                        StartCalibration();
+    int                         GetCalibrationProgress();
+    bool                        IsCalibrated();
+
+    /*-----------------------------------------------------------------*\
+    | Snapshot for the metrics exporter (no device I/O)                  |
+    \*-----------------------------------------------------------------*/
+    CorsairCapellixXTStats      GetStats();
+    static const char*          PumpModeName(int mode);
+
 private:
-    hid_device*                 dev;
+    CorsairCapellixXTTransport* transport;
+    bool                        reconnect_enabled;
     uint16_t                    product_id;
-    unsigned int                buffer_size;
-    unsigned int                write_buffer_size;
-    unsigned int                max_buf_per_request;
+    const CorsairCapellixXTProtocol* protocol;     // per-PID sizes and encoders
 
-    std::string                 device_path;
-    std::string                 firmware_version;
+    std::string                 device_path;        // under info_mutex
+    std::string                 firmware_version;   // under info_mutex
     std::string                 serial;
     std::string                 device_name;
 
@@ -199,13 +591,106 @@ private:
     std::vector<ChannelInfo>    channels;
 
     /*-----------------------------------------------------------------*\
-    | Keepalive — resend colors every 10s to prevent hardware revert    |
+    | Keepalive — after 10 idle seconds, ping (or resend the frame) to  |
+    | prevent hardware revert                                           |
     \*-----------------------------------------------------------------*/
-    std::thread*                                keepalive_thread = nullptr;
-    std::atomic<bool>                           keepalive_thread_run{false};
     std::mutex                                  color_mutex;
     std::vector<uint8_t>                        last_colors;
+    std::vector<uint8_t>                        frame_buf;      // reused color frame, under io_mutex
     std::chrono::steady_clock::time_point       last_commit_time;
+    std::atomic<int>                            keepalive_strategy{CC_KEEPALIVE_PING};
+    std::atomic<int>                            frame_layout{CC_FRAME_LAYOUT_TRIMMED};
+    bool                                        frame_layout_confirmed  = false;   // under io_mutex
+    uint64_t                                    bytes_written = 0;      // under io_mutex
+    std::atomic<uint64_t>                       keepalives{0};
+    std::atomic<uint64_t>                       keepalive_bytes{0};
+    std::atomic<uint64_t>                       keepalive_lock_ns{0};
+    std::atomic<bool>                           pinged_since_frame{false};
+    unsigned int                                revert_ticks = 0;       // service thread only
+
+    /*-----------------------------------------------------------------*\
+    | Cooling priority: cooling_waiters counts cooling steps waiting    |
+    | for io_mutex (changed under priority_mutex); a color frame on     |
+    | another thread yields to them between chunks                      |
+    \*-----------------------------------------------------------------*/
+    std::mutex                                  priority_mutex;
+    std::condition_variable                     priority_cv;
+    std::atomic<int>                            cooling_waiters{0};
+    std::atomic<uint64_t>                       frame_yields{0};
+    CorsairCapellixXTFrameSync*                 frame_sync = nullptr;  // under io_mutex
+    uint8_t                                     revert_duty  = 0;
+
+    /*-----------------------------------------------------------------*\
+    | Connection state — transport is nullptr while disconnected        |
+    \*-----------------------------------------------------------------*/
+    std::atomic<bool>                           connected{true};
+    bool                                        lighting_enabled = true;
+    std::mutex                                  reconnect_mutex;
+    std::mutex                                  info_mutex;     // device_path, firmware_version
+
+    /*-----------------------------------------------------------------*\
+    | Circuit breaker (guarded by io_mutex except the atomic flags)     |
+    \*-----------------------------------------------------------------*/
+    unsigned int                                consecutive_failures = 0;
+    std::atomic<bool>                           breaker_open{false};
+    std::atomic<bool>                           replay_pending{false};
+    std::atomic<bool>                           resume_pending{false};
+
+    /*-----------------------------------------------------------------*\
+    | Watchdog: control loop successes (steady clock ns) and the alarm  |
+    | text, under stats_mutex                                           |
+    \*-----------------------------------------------------------------*/
+    std::atomic<int64_t>                        last_speed_write_ns{0};
+    std::atomic<int64_t>                        last_sensor_read_ns{0};
+    std::atomic<bool>                           watchdog_alarm{false};
+    std::atomic<uint64_t>                       watchdog_alarms{0};
+    std::string                                 watchdog_reason;
+    std::chrono::steady_clock::time_point       next_probe_time;
+    CCLogLimiter                                breaker_log{CC_BREAKER_LOG_INTERVAL_MS};
+    bool                                        breaker_logged = false;
+
+    /*-----------------------------------------------------------------*\
+    | Reply correlation counters (replies discarded as stale / foreign) |
+    \*-----------------------------------------------------------------*/
+    std::atomic<unsigned int>                   stale_replies{0};
+    std::atomic<unsigned int>                   rejected_readings{0};
+    float                                       suspect_liquid_temp     = -1.0f;   // jump held back until a tick confirms it
+
+    /*-----------------------------------------------------------------*\
+    | Metrics: latency histogram and last speeds under stats_mutex,     |
+    | everything else lock-free                                         |
+    \*-----------------------------------------------------------------*/
+    std::mutex                                  stats_mutex;
+    uint64_t                                    latency_buckets[CC_LATENCY_BUCKET_COUNT] = {};
+    uint64_t                                    latency_count = 0;
+    double                                      latency_sum_s = 0.0;
+    std::vector<int>                            last_rpms;
+    std::vector<std::pair<std::string, float>>  last_fan_sources;
+    std::atomic<uint64_t>                       transfer_timeouts{0};
+    std::atomic<uint64_t>                       transfer_io_errors{0};
+    std::atomic<uint64_t>                       bad_replies{0};
+    std::atomic<uint64_t>                       breaker_trips{0};
+    std::atomic<uint64_t>                       reconnects{0};
+    std::atomic<uint64_t>                       frames_sent{0};
+    std::atomic<uint64_t>                       frames_skipped{0};
+    double                                      init_phase_s[CC_INIT_PHASE_COUNT] = { -1.0, -1.0, -1.0, -1.0, -1.0, -1.0 };
+    uint64_t                                    cooling_wait_buckets[CC_LATENCY_BUCKET_COUNT] = {};
+    uint64_t                                    cooling_wait_count = 0;
+    double                                      cooling_wait_sum_s = 0.0;
+    double                                      cooling_wait_max_s = 0.0;
+    uint64_t                                    sync_skew_buckets[CC_SKEW_BUCKET_COUNT] = {};
+    uint64_t                                    sync_skew_count = 0;
+    double                                      sync_skew_sum_s = 0.0;
+    double                                      sync_skew_max_s = 0.0;
+    uint64_t                                    sync_partial    = 0;
+
+    std::unique_lock<std::recursive_mutex> LockForCooling();
+
+    void                        RecordTransfer(std::chrono::steady_clock::duration elapsed,
+                                               CorsairTransferStatus status);
+    std::chrono::steady_clock::time_point RecordInitPhase(CorsairInitPhase phase,
+                                               std::chrono::steady_clock::time_point start);
+    void                        LogInitPhases(const char* what);
 
     /*-----------------------------------------------------------------*\
     | Serializes ALL device I/O so the pump-curve updates and the color  |
@@ -216,21 +701,162 @@ private:
     /*-----------------------------------------------------------------*\
     | Pump control state                                                 |
     \*-----------------------------------------------------------------*/
+    std::mutex                                  curve_mutex;
     std::vector<CurvePoint>                     pump_curve;
     std::vector<CurvePoint>                     fan_curve;
-    int                                         pump_update_counter = 0;
+    std::atomic<int>                            last_pump_rpm{-1};
+    std::atomic<int>                            last_fan_rpm{-1};
     std::atomic<float>                          last_liquid_temp{0.0f};
     std::atomic<uint8_t>                        last_pump_duty{0};
     std::atomic<uint8_t>                        last_fan_duty{0};
     std::atomic<int>                            pump_mode{PUMP_MODE_AUTO};
 
-    void                        KeepaliveThread();
+    /*-----------------------------------------------------------------*\
+    | Mode duties and floors, from the calibration table when there is  |
+    | one and the built-in constants otherwise (under curve_mutex)       |
+    \*-----------------------------------------------------------------*/
+    CorsairCapellixXTCalibration                calibration;
+    CorsairCapellixXTColorCorrection            color_correction;   // read-only after construction
+    uint8_t                                     mode_pump_duty[PUMP_MODE_DISABLED];
+    uint8_t                                     mode_fan_duty[PUMP_MODE_DISABLED];
+    uint8_t                                     pump_floor = PUMP_DUTY_MIN;
+    uint8_t                                     fan_floor  = FAN_DUTY_MIN;
+    CorsairCapellixXTCalibration                speed_model;    // calibration, or the reference speeds
+
+    /*-----------------------------------------------------------------*\
+    | Target RPM mode: targets under curve_mutex, loop state on the      |
+    | service thread only                                               |
+    \*-----------------------------------------------------------------*/
+    int                                         pump_target_rpm = CC_TARGET_DEFAULT_PUMP_RPM;
+    int                                         fan_target_rpm  = CC_TARGET_DEFAULT_FAN_RPM;
+    int                                         last_applied_mode = -1;
+    float                                       pump_target_correction = 0.0f;
+    float                                       fan_target_correction  = 0.0f;
+    std::chrono::steady_clock::time_point       target_last_change;
+    std::atomic<bool>                           targets_changed{false};
+
+    /*-----------------------------------------------------------------*\
+    | CPU load feed-forward: setting under curve_mutex, burst state on  |
+    | the service thread only                                           |
+    \*-----------------------------------------------------------------*/
+    float                                       feedforward_max_c = 0.0f;
+    CCCpuLoad                                   cpu_load;
+    unsigned int                                ff_busy_ticks   = 0;
+    unsigned int                                ff_quiet_ticks  = 0;
+    std::chrono::steady_clock::time_point       ff_burst_start;
+    bool                                        ff_logged       = false;
+
     void                        SendKeepalive();
+    void                        ResendLastFrame();
+    unsigned int                FrameSlotLeds(unsigned int zone, int layout);
+    size_t                      FrameBytes(int layout);
+    void                        CheckHardwareRevert(const std::vector<int>& rpm);
+
+    /*-----------------------------------------------------------------*\
+    | Service state machine (touched only on the service thread)        |
+    \*-----------------------------------------------------------------*/
+    enum CoolingPhase
+    {
+        CC_COOLING_IDLE,
+        CC_COOLING_READ_TEMP,
+        CC_COOLING_APPLY,
+        CC_COOLING_READ_SPEEDS,
+    };
+
+    CoolingPhase                                cooling_phase           = CC_COOLING_IDLE;
+    std::atomic<bool>                           cooling_requested{false};
+    std::chrono::steady_clock::time_point       next_cooling_tick;
+    std::chrono::steady_clock::time_point       led_ports_ready_time;       // next LED config poll
+    std::chrono::steady_clock::time_point       led_ports_init_time;        // port init finished
+    std::chrono::steady_clock::time_point       led_ports_deadline;
+    std::vector<ChannelInfo>                    led_ports_last_read;        // previous valid poll, to confirm
+    bool                                        color_restore_pending   = false;
+    float                                       tick_liquid_temp        = -1.0f;
+
+    /*-----------------------------------------------------------------*\
+    | Fan curve sources from the curves file (under curve_mutex); the   |
+    | open sensors belong to the service thread, which reopens them     |
+    | when fan_sources_changed is set                                   |
+    \*-----------------------------------------------------------------*/
+    std::vector<CCHwmonSelector>                fan_sources;
+    bool                                        fan_source_liquid       = false;
+    bool                                        fan_sources_changed     = false;
+    CCHwmonSensors                              hwmon;
+
+    /*-----------------------------------------------------------------*\
+    | Profiles (under curve_mutex). The active profile's curves and     |
+    | duties are an overlay on the curves file and mode duties, dropped |
+    | when another mode is chosen; saved_profile is the one named in    |
+    | the mode file.                                                    |
+    \*-----------------------------------------------------------------*/
+    std::vector<CCProfile>                      profiles;
+    std::string                                 active_profile;
+    std::string                                 saved_profile;
+    std::vector<CurvePoint>                     profile_pump_curve;
+    std::vector<CurvePoint>                     profile_fan_curve;
+    int                                         profile_pump_duty       = -1;
+    int                                         profile_fan_duty        = -1;
+    std::atomic<bool>                           profile_pending{false};
+    std::atomic<uint64_t>                       profile_switches{0};
+    double                                      profile_burst_s         = -1.0;    // under stats_mutex
+
+    // Last status logged at info level; later ticks with the same state go to debug
+    int                                         logged_mode             = -1;
+    uint8_t                                     logged_pump_duty        = 0;
+    uint8_t                                     logged_fan_duty         = 0;
+
+    // Telemetry history, opened on the first cooling tick
+    CCTelemetryWriter                           telemetry;
+    bool                                        telemetry_opened        = false;
+    bool                                        tick_write_failed       = false;
+    unsigned int                                telemetry_rejected      = 0;
+
+    bool                        CoolingReadSensors();
+    void                        CoolingApply();
+    void                        CoolingReadSpeeds();
+    void                        TargetDuties(uint8_t& pump_duty, uint8_t& fan_duty);
+    float                       FeedForwardBoost();
+    void                        ReadFanSources();
+    void                        RecordTelemetry(const std::vector<int>& rpm, bool speeds_ok);
+
+    /*-----------------------------------------------------------------*\
+    | Calibration sweep state (service thread only, except the atomics) |
+    \*-----------------------------------------------------------------*/
+    enum CalibrationPhase
+    {
+        CC_CALIBRATION_IDLE,
+        CC_CALIBRATION_WRITE,
+        CC_CALIBRATION_SAMPLE,
+    };
+
+    CalibrationPhase                            calibration_phase       = CC_CALIBRATION_IDLE;
+    std::atomic<bool>                           calibration_requested{false};
+    std::atomic<int>                            calibration_progress{-1};
+    std::chrono::steady_clock::time_point       calibration_next;
+    unsigned int                                calibration_step        = 0;
+    unsigned int                                calibration_samples     = 0;
+    std::vector<int>                            calibration_last_rpm;
+    CorsairCapellixXTCalibration                calibration_sweep;
+
+    std::chrono::steady_clock::time_point CalibrationStep(std::chrono::steady_clock::time_point now);
+    void                        CalibrationRecord(const std::vector<int>& rpm);
+    void                        CalibrationFinish();
+    void                        CalibrationAbort(const char* reason);
+    void                        ApplyCalibration();
+    bool                        WriteSpeeds(uint8_t pump_duty, uint8_t fan_duty);
 
     uint8_t                     EvalCurve(const std::vector<CurvePoint>& curve, float tempC);
     void                        UpdatePumpFromCurve();
     void                        LoadPumpMode();
     void                        SavePumpMode();
+    void                        LoadCurves();
+    void                        LoadProfiles();
+    bool                        UseProfile(const std::string& name);
+    void                        ProfileBurst();
+    void                        LeaveProfile();
+    std::vector<uint8_t>        BuildProfileFrame(const CCProfile& profile);
+    void                        LoadTargets();
+    void                        SaveTargets();
 
     /*-----------------------------------------------------------------*\
     | Core transfer: every packet has 0x08 at byte[1]                   |
@@ -238,14 +864,39 @@ private:
     |   bufferW[1] = 0x08  (fixed protocol header)                     |
     |   bufferW[2..] = endpoint bytes + buffer bytes                    |
     \*-----------------------------------------------------------------*/
-    std::vector<uint8_t>        Transfer(const std::vector<uint8_t>& endpoint,
-                                         const std::vector<uint8_t>& buf = {});
+    TransferResult              Transfer(const CCCommand& cmd,
+                                         CCBytes buf = CCBytes());
+    TransferResult              TransferOnce(const CCCommand& cmd,
+                                             CCBytes buf,
+                                             int timeout_ms);
+    bool                        ProbeBreaker();
 
     /*-----------------------------------------------------------------*\
     | Read endpoint: close-open-read-close sequence                     |
+    | Write endpoint: close-open-write-close sequence                   |
     \*-----------------------------------------------------------------*/
-    std::vector<uint8_t>        ReadEndpoint(uint8_t mode);
+    TransferResult              ReadEndpoint(uint8_t mode);
+    TransferResult              WriteEndpoint(uint8_t mode,
+                                              uint8_t data_type_0,
+                                              uint8_t data_type_1,
+                                              CCBytes data);
 
     void                        ReadFirmware();
+    std::string                 QueryFirmwareVersion();
     void                        InitLedPorts();
+    void                        StartLedPortPolling();
+    bool                        WaitLedPortsReady(std::vector<ChannelInfo>& out, unsigned int& out_total);
+    bool                        ReadLEDConfig(std::vector<ChannelInfo>& out, unsigned int& out_total);
+    static bool                 SameLayout(const std::vector<ChannelInfo>& a, const std::vector<ChannelInfo>& b);
+
+    /*-----------------------------------------------------------------*\
+    | Per-serial topology cache (firmware + LED layout) for fast start  |
+    \*-----------------------------------------------------------------*/
+    bool                        topology_verify_pending = false;
+    bool                        LoadTopologyCache();
+    void                        SaveTopologyCache(const std::string& fw,
+                                                  const std::vector<ChannelInfo>& layout);
+    void                        VerifyTopologyCache(const std::vector<ChannelInfo>& found, unsigned int found_total);
+    void                        OpenColorEndpoint();
+    void                        ReplayState();
 };
@@ -1,22 +1,23 @@
 #include "CorsairCapellixXTDetect.h"
 #include "CorsairCapellixXTController.h"
-#include "RGBController_CorsairCapellixXT.h"
+#include "CorsairCapellixXTHidraw.h"
+#include "CorsairCapellixXTTrace.h"
 
 #include <hidapi.h>
 
 /**------------------------------------------------------------------*\
-| Scan for Corsair Commander Core devices and create an               |
-| RGBController for each one found.                                   |
+| Scan for Corsair Commander Core devices and open + initialize a     |
+| controller for each one found.                                      |
 |                                                                     |
 | Supported PIDs:                                                     |
 |   0x0C1C  Commander Core (original, 96-byte buffer)                 |
 |   0x0C32  Commander ST   (newer revision, 64-byte buffer)           |
 \*------------------------------------------------------------------*/
 
-std::vector<RGBController*> DetectCorsairCapellixXT(
-    std::vector<CorsairCapellixXTController*>* raw_out)
+std::vector<CorsairCapellixXTController*> DetectCorsairCapellixXTControllers(
+    bool with_lighting)
 {
-    std::vector<RGBController*> controllers;
+    std::vector<CorsairCapellixXTController*> found;
 
     for(size_t p = 0; p < COMMANDER_CORE_PID_COUNT; p++)
     {
@@ -32,26 +33,16 @@ std::vector<RGBController*> DetectCorsairCapellixXT(
             \*---------------------------------------------------------*/
             if(cur->interface_number == 0)
             {
-                hid_device* dev = hid_open_path(cur->path);
+                CorsairCapellixXTTransport* transport = CCOpenTransport(cur->path);
 
-                if(dev)
+                if(transport)
                 {
-                    hid_set_nonblocking(dev, 0);
-
                     CorsairCapellixXTController* controller =
-                        new CorsairCapellixXTController(dev, cur->path, pid);
-
-                    controller->Initialize();
-
-                    RGBController_CorsairCapellixXT* rgb =
-                        new RGBController_CorsairCapellixXT(controller);
+                        new CorsairCapellixXTController(CCTraceWrapTransport(transport, pid), cur->path, pid);
 
-                    controllers.push_back(rgb);
+                    controller->Initialize(with_lighting);
 
-                    if(raw_out != nullptr)
-                    {
-                        raw_out->push_back(controller);
-                    }
+                    found.push_back(controller);
                 }
             }
 
@@ -61,5 +52,5 @@ std::vector<RGBController*> DetectCorsairCapellixXT(
         hid_free_enumeration(devs);
     }
 
-    return controllers;
+    return found;
 }
@@ -5,8 +5,15 @@
 class RGBController;
 class CorsairCapellixXTController;
 
+// Opens and initializes every Commander Core found on the bus. Shared by the
+// plugin and the headless daemon; has no RGBController / Qt dependency.
+// with_lighting = false skips LED port setup (cooling-only daemon).
+std::vector<CorsairCapellixXTController*> DetectCorsairCapellixXTControllers(
+    bool with_lighting = true);
+
 // Detects Commander Core devices and returns an RGBController for each.
 // If raw_out is provided, the underlying hardware controllers are also
 // appended to it (so the plugin UI can drive pump speed/modes).
+// Defined with the RGBController (plugin build only).
 std::vector<RGBController*> DetectCorsairCapellixXT(
     std::vector<CorsairCapellixXTController*>* raw_out = nullptr);
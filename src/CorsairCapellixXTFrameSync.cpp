@@ -0,0 +1,228 @@
+#include "CorsairCapellixXTFrameSync.h"
+#include "CorsairCapellixXTController.h"
+
+#include <algorithm>
+
+CorsairCapellixXTFrameSync::CorsairCapellixXTFrameSync(const std::vector<CorsairCapellixXTController*>& controllers)
+{
+    for(CorsairCapellixXTController* c : controllers)
+    {
+        Member member;
+
+        member.controller   = c;
+        member.commit_us    = 0.0;
+        member.round        = 0;
+        member.complete     = false;
+        member.commit_round = 0;
+
+        members.push_back(member);
+    }
+
+    for(CorsairCapellixXTController* c : controllers)
+    {
+        c->SetFrameSync(this);
+    }
+}
+
+CorsairCapellixXTFrameSync::~CorsairCapellixXTFrameSync()
+{
+    for(Member& member : members)
+    {
+        member.controller->SetFrameSync(nullptr);
+    }
+}
+
+CorsairCapellixXTFrameSync::Member* CorsairCapellixXTFrameSync::Find(CorsairCapellixXTController* controller)
+{
+    for(Member& member : members)
+    {
+        if(member.controller == controller)
+        {
+            return &member;
+        }
+    }
+    return nullptr;
+}
+
+/*---------------------------------------------------------------------*\
+| Let the forming round go. Each member gets its own start time: the    |
+| common deadline plus how much faster its last chunk usually is than   |
+| the slowest member's, so the completions coincide. The head start is  |
+| capped at CC_FRAME_SYNC_WAIT_MS: a member whose average is swollen by |
+| retries must not hold the others' device locks for longer.            |
+\*---------------------------------------------------------------------*/
+
+void CorsairCapellixXTFrameSync::Release(std::chrono::steady_clock::time_point now, bool complete)
+{
+    std::chrono::steady_clock::time_point deadline = now + std::chrono::microseconds(CC_FRAME_SYNC_LEAD_US);
+    double                                slowest  = 0.0;
+
+    for(const Member& member : members)
+    {
+        if(member.round == forming)
+        {
+            slowest = std::max(slowest, member.commit_us);
+        }
+    }
+
+    for(Member& member : members)
+    {
+        if(member.round == forming)
+        {
+            double behind = member.commit_us > 0.0 ? slowest - member.commit_us : 0.0;
+
+            behind = std::min(behind, CC_FRAME_SYNC_WAIT_MS * 1000.0);
+
+            member.start    = deadline + std::chrono::microseconds((int64_t)behind);
+            member.complete = complete;
+        }
+    }
+
+    released = forming;
+    forming++;
+    arrived  = 0;
+
+    cv.notify_all();
+}
+
+CCFrameSlot CorsairCapellixXTFrameSync::Arrive(CorsairCapellixXTController* controller, bool can_yield)
+{
+    std::unique_lock<std::mutex>          lock(mutex);
+    std::chrono::steady_clock::time_point now  = std::chrono::steady_clock::now();
+    CCFrameSlot                           slot = { 0, now, false };
+    Member*                               self = Find(controller);
+
+    if(self == nullptr)
+    {
+        return slot;
+    }
+
+    self->last_arrival = now;
+
+    /*-----------------------------------------------------------------*\
+    | Only wait for members that are sending frames at all              |
+    \*-----------------------------------------------------------------*/
+    unsigned int active = 0;
+
+    for(const Member& member : members)
+    {
+        if(now - member.last_arrival < std::chrono::milliseconds(CC_FRAME_SYNC_ACTIVE_MS))
+        {
+            active++;
+        }
+    }
+
+    if(active < 2)
+    {
+        return slot;
+    }
+
+    uint64_t round = forming;
+
+    self->round = round;
+    arrived++;
+
+    if(arrived >= active)
+    {
+        Release(now, true);
+    }
+    else
+    {
+        std::chrono::steady_clock::time_point give_up = now + std::chrono::milliseconds(CC_FRAME_SYNC_WAIT_MS);
+
+        while(released < round)
+        {
+            /*---------------------------------------------------------*\
+            | A cooling step on this device outranks the sync: leave    |
+            | the round and let the frame yield, or, when it can no     |
+            | longer restart, send its last chunk unsynchronized now    |
+            \*---------------------------------------------------------*/
+            if(controller->CoolingWaiting())
+            {
+                self->round = 0;
+                arrived--;
+                slot.yield  = can_yield;
+                return slot;
+            }
+
+            std::chrono::steady_clock::time_point t = std::chrono::steady_clock::now();
+
+            if(t >= give_up)
+            {
+                Release(t, false);
+                break;
+            }
+
+            cv.wait_until(lock, std::min(give_up, t + std::chrono::milliseconds(CC_FRAME_SYNC_SLICE_MS)));
+        }
+    }
+
+    slot.round = round;
+    slot.start = self->start;
+    return slot;
+}
+
+void CorsairCapellixXTFrameSync::Committed(CorsairCapellixXTController* controller, uint64_t round, bool ok,
+                                           std::chrono::steady_clock::time_point sent,
+                                           std::chrono::steady_clock::time_point done)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Member*                     self = Find(controller);
+
+    if(self == nullptr || self->round != round)
+    {
+        return;
+    }
+
+    self->round = 0;
+
+    if(ok)
+    {
+        double us = std::chrono::duration<double, std::micro>(done - sent).count();
+
+        /*-------------------------------------------------------------*\
+        | A chunk that needed a retry says nothing about the usual time |
+        \*-------------------------------------------------------------*/
+        us = std::min(us, CC_FRAME_SYNC_WAIT_MS * 1000.0);
+
+        self->commit_us    = self->commit_us > 0.0 ? 0.8 * self->commit_us + 0.2 * us : us;
+        self->commit_round = round;
+        self->done         = done;
+    }
+
+    /*-----------------------------------------------------------------*\
+    | The last member of the round to finish works out the skew         |
+    \*-----------------------------------------------------------------*/
+    std::chrono::steady_clock::time_point first;
+    std::chrono::steady_clock::time_point last;
+    unsigned int                          count = 0;
+
+    for(const Member& member : members)
+    {
+        if(member.round == round)
+        {
+            return;
+        }
+        if(member.commit_round == round)
+        {
+            first = count == 0 ? member.done : std::min(first, member.done);
+            last  = count == 0 ? member.done : std::max(last,  member.done);
+            count++;
+        }
+    }
+
+    if(count < 2)
+    {
+        return;
+    }
+
+    double skew = std::chrono::duration<double>(last - first).count();
+
+    for(Member& member : members)
+    {
+        if(member.commit_round == round)
+        {
+            member.controller->RecordFrameSync(skew, member.complete);
+        }
+    }
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+
+class CorsairCapellixXTController;
+
+/*---------------------------------------------------------------------*\
+| Frame sync group. OpenRGB updates each device from its own thread,    |
+| so with two or more coolers every frame lands on each device at a     |
+| different time and moving effects tear between them. Grouped devices  |
+| still build and send their frames in parallel, but each one stops     |
+| before the last chunk (the one that completes the frame) and waits    |
+| for the others. When every device that sent a frame recently          |
+| (CC_FRAME_SYNC_ACTIVE_MS) is ready, all of them are released to a     |
+| common deadline. A device whose last chunk usually takes less time    |
+| than the slowest member's starts later by the difference, so the      |
+| acknowledgements line up and not just the writes.                     |
+|                                                                       |
+| The wait is bounded by CC_FRAME_SYNC_WAIT_MS, and so is a member's    |
+| head start. After that, the devices that are ready go on without the  |
+| missing ones. A device also leaves the round, in the wait or before   |
+| its start time, when one of its own cooling steps is waiting. The     |
+| skew (spread of the last-chunk completions) of every round is kept    |
+| in each member's stats.                                               |
+\*---------------------------------------------------------------------*/
+
+#define CC_FRAME_SYNC_WAIT_MS       50      // longest wait for the other members
+#define CC_FRAME_SYNC_ACTIVE_MS     1000    // a member without a frame this long is not waited for
+#define CC_FRAME_SYNC_LEAD_US       500     // release deadline ahead of the last arrival
+#define CC_FRAME_SYNC_SLICE_MS      2       // re-check for waiting cooling steps this often
+
+/*---------------------------------------------------------------------*\
+| Arrive() result: round 0 = send now, unsynchronized; yield = a        |
+| cooling step is waiting, give it the device first                     |
+\*---------------------------------------------------------------------*/
+
+struct CCFrameSlot
+{
+    uint64_t                                round;
+    std::chrono::steady_clock::time_point   start;
+    bool                                    yield;
+};
+
+class CorsairCapellixXTFrameSync
+{
+public:
+    /*-----------------------------------------------------------------*\
+    | Joins every controller to the group; the destructor detaches      |
+    | them and waits for frames in flight                               |
+    \*-----------------------------------------------------------------*/
+    CorsairCapellixXTFrameSync(const std::vector<CorsairCapellixXTController*>& controllers);
+    ~CorsairCapellixXTFrameSync();
+
+    /*-----------------------------------------------------------------*\
+    | Called with the member's last chunk ready and its device lock     |
+    | held. can_yield: the frame may still be restarted for cooling;    |
+    | if not, a waiting cooling step gets round 0 (send now) instead.   |
+    \*-----------------------------------------------------------------*/
+    CCFrameSlot                                 Arrive(CorsairCapellixXTController* controller, bool can_yield);
+
+    /*-----------------------------------------------------------------*\
+    | The last chunk of a synced frame went out (ok), failed, or was    |
+    | held back for a cooling step before its start time                |
+    \*-----------------------------------------------------------------*/
+    void                                        Committed(CorsairCapellixXTController* controller, uint64_t round, bool ok,
+                                                          std::chrono::steady_clock::time_point sent,
+                                                          std::chrono::steady_clock::time_point done);
+
+private:
+    struct Member
+    {
+        CorsairCapellixXTController*            controller;
+        std::chrono::steady_clock::time_point   last_arrival;
+        double                                  commit_us;      // average last-chunk time, 0 = none yet
+        uint64_t                                round;          // round it is sending in, 0 = none
+        std::chrono::steady_clock::time_point   start;          // its deadline in that round
+        bool                                    complete;       // that round had every active member
+        uint64_t                                commit_round;   // last round it completed
+        std::chrono::steady_clock::time_point   done;           // and when
+    };
+
+    std::mutex                                  mutex;
+    std::condition_variable                     cv;
+    std::vector<Member>                         members;
+    uint64_t                                    forming  = 1;   // round now gathering
+    uint64_t                                    released = 0;   // last round let go
+    unsigned int                                arrived  = 0;   // members in the forming round
+
+    Member*                                     Find(CorsairCapellixXTController* controller);
+    void                                        Release(std::chrono::steady_clock::time_point now, bool complete);
+};
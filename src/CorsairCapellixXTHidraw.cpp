@@ -0,0 +1,312 @@
+#include "CorsairCapellixXTHidraw.h"
+#include "CorsairCapellixXTLog.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef __linux__
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+
+/*---------------------------------------------------------------------*\
+| One line of a sysfs attribute, trailing newline removed               |
+\*---------------------------------------------------------------------*/
+
+static std::string ReadSysfsLine(const std::string& path)
+{
+    char  line[256];
+    FILE* f = fopen(path.c_str(), "r");
+
+    if(f == nullptr)
+    {
+        return "";
+    }
+
+    if(fgets(line, sizeof(line), f) == nullptr)
+    {
+        line[0] = '\0';
+    }
+    fclose(f);
+
+    line[strcspn(line, "\n")] = '\0';
+    return line;
+}
+
+CorsairCapellixXTHidrawTransport* CorsairCapellixXTHidrawTransport::Open(const char* path)
+{
+    int fd = open(path, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if(fd < 0)
+    {
+        return nullptr;
+    }
+
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    int timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+
+    struct epoll_event node_event  = {};
+    struct epoll_event timer_event = {};
+
+    node_event.events   = EPOLLIN;
+    node_event.data.fd  = fd;
+    timer_event.events  = EPOLLIN;
+    timer_event.data.fd = timer_fd;
+
+    if(epoll_fd < 0 || timer_fd < 0
+    || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd,       &node_event)  != 0
+    || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, timer_fd, &timer_event) != 0)
+    {
+        int error = errno;
+
+        if(timer_fd >= 0) close(timer_fd);
+        if(epoll_fd >= 0) close(epoll_fd);
+        close(fd);
+
+        errno = error;
+        return nullptr;
+    }
+
+    CorsairCapellixXTHidrawTransport* transport = new CorsairCapellixXTHidrawTransport(fd, epoll_fd, timer_fd);
+
+    /*-----------------------------------------------------------------*\
+    | /sys/class/hidraw/hidrawN/device is the HID device; the USB       |
+    | device with the descriptor strings is two levels up (interface,   |
+    | then device). HID_UNIQ / HID_NAME in the uevent are the fallback. |
+    \*-----------------------------------------------------------------*/
+    std::string node   = std::string(path).substr(strlen("/dev/"));
+    std::string device = "/sys/class/hidraw/" + node + "/device";
+
+    transport->serial  = ReadSysfsLine(device + "/../../serial");
+    transport->product = ReadSysfsLine(device + "/../../product");
+
+    FILE* uevent = fopen((device + "/uevent").c_str(), "r");
+    if(uevent != nullptr)
+    {
+        char line[256];
+
+        while(fgets(line, sizeof(line), uevent) != nullptr)
+        {
+            line[strcspn(line, "\n")] = '\0';
+
+            if(transport->serial.empty() && strncmp(line, "HID_UNIQ=", 9) == 0)
+            {
+                transport->serial = line + 9;
+            }
+            else if(transport->product.empty() && strncmp(line, "HID_NAME=", 9) == 0)
+            {
+                transport->product = line + 9;
+            }
+        }
+        fclose(uevent);
+    }
+
+    return transport;
+}
+
+CorsairCapellixXTHidrawTransport::CorsairCapellixXTHidrawTransport(int fd, int epoll_fd, int timer_fd)
+    : fd(fd)
+    , epoll_fd(epoll_fd)
+    , timer_fd(timer_fd)
+{
+}
+
+CorsairCapellixXTHidrawTransport::~CorsairCapellixXTHidrawTransport()
+{
+    close(timer_fd);
+    close(epoll_fd);
+    close(fd);
+}
+
+int CorsairCapellixXTHidrawTransport::Wait(uint32_t events, int timeout_ms)
+{
+    struct epoll_event node_event = {};
+
+    node_event.events  = events;
+    node_event.data.fd = fd;
+
+    if(epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &node_event) != 0)
+    {
+        return -1;
+    }
+
+    /*-----------------------------------------------------------------*\
+    | Arm the deadline; an all-zero value disarms it (no timeout)       |
+    \*-----------------------------------------------------------------*/
+    struct itimerspec deadline = {};
+
+    if(timeout_ms > 0)
+    {
+        deadline.it_value.tv_sec  = timeout_ms / 1000;
+        deadline.it_value.tv_nsec = (long)(timeout_ms % 1000) * 1000000L;
+    }
+    timerfd_settime(timer_fd, 0, &deadline, nullptr);
+
+    int result = 0;
+
+    while(true)
+    {
+        struct epoll_event ready[2];
+        int                count = epoll_wait(epoll_fd, ready, 2, timeout_ms == 0 ? 0 : -1);
+
+        if(count < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if(count <= 0)
+        {
+            result = count < 0 ? -1 : 0;
+            break;
+        }
+
+        bool node_ready = false;
+        bool expired    = false;
+
+        for(int i = 0; i < count; i++)
+        {
+            if(ready[i].data.fd == fd)
+            {
+                if(ready[i].events & (EPOLLERR | EPOLLHUP))
+                {
+                    result = -1;
+                }
+                node_ready = true;
+            }
+            else
+            {
+                uint64_t expirations;
+                ssize_t  ignored = read(timer_fd, &expirations, sizeof(expirations));
+                (void)ignored;
+                expired = true;
+            }
+        }
+
+        if(node_ready)
+        {
+            result = result < 0 ? -1 : 1;
+            break;
+        }
+        if(expired)
+        {
+            result = 0;
+            break;
+        }
+    }
+
+    struct itimerspec disarm = {};
+    timerfd_settime(timer_fd, 0, &disarm, nullptr);
+
+    return result;
+}
+
+int CorsairCapellixXTHidrawTransport::Write(const uint8_t* data, size_t length)
+{
+    while(true)
+    {
+        ssize_t written = write(fd, data, length);
+
+        if(written >= 0)
+        {
+            return (int)written;
+        }
+        if(errno == EINTR)
+        {
+            continue;
+        }
+        if(errno != EAGAIN || Wait(EPOLLOUT, CC_HIDRAW_WRITE_TIMEOUT_MS) != 1)
+        {
+            return -1;
+        }
+    }
+}
+
+int CorsairCapellixXTHidrawTransport::Read(uint8_t* data, size_t length, int timeout_ms)
+{
+    bool waited = false;
+
+    while(true)
+    {
+        ssize_t got = read(fd, data, length);
+
+        if(got >= 0)
+        {
+            return (int)got;
+        }
+        if(errno == EINTR)
+        {
+            continue;
+        }
+        if(errno != EAGAIN)
+        {
+            return -1;
+        }
+
+        /*-------------------------------------------------------------*\
+        | Nothing queued: one wait for the reply or the deadline. A     |
+        | wakeup that still finds nothing is a timeout, as in hidapi.   |
+        \*-------------------------------------------------------------*/
+        if(waited)
+        {
+            return 0;
+        }
+
+        int ready = Wait(EPOLLIN, timeout_ms);
+        if(ready <= 0)
+        {
+            return ready;
+        }
+        waited = true;
+    }
+}
+
+std::string CorsairCapellixXTHidrawTransport::GetSerialString()
+{
+    return serial;
+}
+
+std::string CorsairCapellixXTHidrawTransport::GetProductString()
+{
+    return product;
+}
+
+#endif
+
+/*---------------------------------------------------------------------*\
+| CCOpenTransport                                                       |
+\*---------------------------------------------------------------------*/
+
+CorsairCapellixXTTransport* CCOpenTransport(const char* path)
+{
+#ifdef __linux__
+    const char* env = getenv(CC_HIDRAW_ENV);
+
+    if(env != nullptr && strcmp(env, "1") == 0 && strncmp(path, CC_HIDRAW_PREFIX, strlen(CC_HIDRAW_PREFIX)) == 0)
+    {
+        CorsairCapellixXTHidrawTransport* transport = CorsairCapellixXTHidrawTransport::Open(path);
+
+        if(transport != nullptr)
+        {
+            CCLog(CC_LOG_INFO, "%s: using the native hidraw transport", path);
+            return transport;
+        }
+
+        CCLog(CC_LOG_WARN, "%s: cannot open natively (%s), using hidapi", path, strerror(errno));
+    }
+#endif
+
+    hid_device* dev = hid_open_path(path);
+
+    if(dev == nullptr)
+    {
+        return nullptr;
+    }
+
+    hid_set_nonblocking(dev, 0);
+
+    return new CorsairCapellixXTHidapiTransport(dev);
+}
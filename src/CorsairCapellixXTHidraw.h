@@ -0,0 +1,70 @@
+#pragma once
+
+#include "CorsairCapellixXTTransport.h"
+
+#include <string>
+
+/*---------------------------------------------------------------------*\
+| Native hidraw transport (Linux, opt-in)                               |
+|                                                                       |
+| With CC_HIDRAW=1 in the environment a device enumerated at a          |
+| /dev/hidrawN path is opened directly instead of through hidapi. The   |
+| node is opened non-blocking; reads and writes are tried first and     |
+| only wait, in epoll_wait(), when the kernel has nothing to give or no |
+| room. The deadline is a timerfd in the same epoll set, so a Read()    |
+| with a timeout wakes on the reply or on the timer, whichever comes    |
+| first, with no polling loop and no extra thread. Semantics match the  |
+| hidapi transport (report ID first, 0 on timeout, -1 on error).        |
+|                                                                       |
+| Serial and product strings come from the USB device in sysfs, as      |
+| hidapi's hidraw backend reads them. Anything else (other platforms,   |
+| libusb paths, a node that cannot be opened) uses hidapi.              |
+\*---------------------------------------------------------------------*/
+
+#define CC_HIDRAW_ENV               "CC_HIDRAW"
+#define CC_HIDRAW_PREFIX            "/dev/hidraw"
+#define CC_HIDRAW_WRITE_TIMEOUT_MS  1000    // a full output queue this long is an error
+
+#ifdef __linux__
+
+class CorsairCapellixXTHidrawTransport : public CorsairCapellixXTTransport
+{
+public:
+    /*-----------------------------------------------------------------*\
+    | nullptr if the node, the epoll set or the timer cannot be opened  |
+    \*-----------------------------------------------------------------*/
+    static CorsairCapellixXTHidrawTransport* Open(const char* path);
+
+    ~CorsairCapellixXTHidrawTransport();
+
+    int                         Write(const uint8_t* data, size_t length) override;
+    int                         Read(uint8_t* data, size_t length, int timeout_ms) override;
+
+    std::string                 GetSerialString() override;
+    std::string                 GetProductString() override;
+
+private:
+    CorsairCapellixXTHidrawTransport(int fd, int epoll_fd, int timer_fd);
+
+    /*-----------------------------------------------------------------*\
+    | Wait for events on the node: 1 ready, 0 deadline, -1 error        |
+    | (device gone). timeout_ms < 0 waits without a deadline.           |
+    \*-----------------------------------------------------------------*/
+    int                         Wait(uint32_t events, int timeout_ms);
+
+    int                         fd;
+    int                         epoll_fd;
+    int                         timer_fd;
+    std::string                 serial;
+    std::string                 product;
+};
+
+#endif
+
+/*---------------------------------------------------------------------*\
+| Open the device at an enumerated path: the hidraw transport when      |
+| CC_HIDRAW is set and the path is a hidraw node, hidapi otherwise.     |
+| nullptr if neither can open it.                                       |
+\*---------------------------------------------------------------------*/
+
+CorsairCapellixXTTransport* CCOpenTransport(const char* path);
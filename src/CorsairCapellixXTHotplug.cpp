@@ -0,0 +1,254 @@
+#include "CorsairCapellixXTHotplug.h"
+#include "CorsairCapellixXTController.h"
+#include "CorsairCapellixXTLog.h"
+
+#include <cstring>
+#include <chrono>
+
+#ifdef __linux__
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#endif
+
+/*---------------------------------------------------------------------*\
+| Netlink multicast groups for NETLINK_KOBJECT_UEVENT. Group 2 carries  |
+| udev's re-broadcast of each event, sent only after udev has applied   |
+| its rules, so the hidraw node already has the permissions from our    |
+| udev rule by the time we try to open it.                              |
+\*---------------------------------------------------------------------*/
+#define UEVENT_GROUP_UDEV           2
+#define UEVENT_BUFFER_SIZE          8192
+#define UEVENT_POLL_MS              250
+
+// Growth of BOOTTIME - MONOTONIC between two polls that counts as a resume
+#define HOTPLUG_RESUME_MIN_MS       1000
+
+// How often / how long to retry opening after an add event
+#define HOTPLUG_OPEN_ATTEMPTS       8
+#define HOTPLUG_OPEN_RETRY_MS       50
+
+CorsairCapellixXTHotplug::CorsairCapellixXTHotplug(const std::vector<CorsairCapellixXTController*>& ctrls)
+    : controllers(ctrls)
+{
+}
+
+CorsairCapellixXTHotplug::~CorsairCapellixXTHotplug()
+{
+    Stop();
+}
+
+void CorsairCapellixXTHotplug::Start()
+{
+#ifdef __linux__
+    if(monitor_thread != nullptr || controllers.empty())
+    {
+        return;
+    }
+
+    sock = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_KOBJECT_UEVENT);
+    if(sock < 0)
+    {
+        return;
+    }
+
+    struct sockaddr_nl addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = UEVENT_GROUP_UDEV;
+
+    if(bind(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0)
+    {
+        close(sock);
+        sock = -1;
+        return;
+    }
+
+    monitor_thread_run = true;
+    monitor_thread     = new std::thread(&CorsairCapellixXTHotplug::MonitorThread, this);
+#endif
+}
+
+void CorsairCapellixXTHotplug::Stop()
+{
+    if(monitor_thread)
+    {
+        monitor_thread_run = false;
+        monitor_thread->join();
+        delete monitor_thread;
+        monitor_thread = nullptr;
+    }
+
+#ifdef __linux__
+    if(sock >= 0)
+    {
+        close(sock);
+        sock = -1;
+    }
+#endif
+}
+
+/*---------------------------------------------------------------------*\
+| Uevent parsing                                                        |
+|                                                                       |
+| Kernel messages:  "add@/devices/...\0ACTION=add\0SUBSYSTEM=...\0..."  |
+| udev messages:    "libudev\0" header, then the same KEY=VALUE list    |
+|                   at header.properties_off                            |
+\*---------------------------------------------------------------------*/
+
+void CorsairCapellixXTHotplug::MonitorThread()
+{
+#ifdef __linux__
+    char buf[UEVENT_BUFFER_SIZE];
+
+    while(monitor_thread_run.load())
+    {
+        CheckResume();
+
+        struct pollfd pfd;
+        pfd.fd      = sock;
+        pfd.events  = POLLIN;
+        pfd.revents = 0;
+
+        if(poll(&pfd, 1, UEVENT_POLL_MS) <= 0)
+        {
+            continue;
+        }
+
+        ssize_t len = recv(sock, buf, sizeof(buf) - 1, 0);
+        if(len <= 0)
+        {
+            continue;
+        }
+        buf[len] = '\0';
+
+        size_t off = 0;
+
+        if(len >= 40 && memcmp(buf, "libudev", 8) == 0)
+        {
+            uint32_t props_off;
+            memcpy(&props_off, buf + 16, sizeof(props_off));   // host byte order
+            off = props_off;
+        }
+        else
+        {
+            off = strlen(buf) + 1;                              // skip "action@devpath"
+        }
+
+        std::string action;
+        std::string subsystem;
+        std::string devname;
+
+        while(off < (size_t)len)
+        {
+            const char* kv = buf + off;
+            size_t      kl = strlen(kv);
+
+            if(strncmp(kv, "ACTION=", 7) == 0)
+            {
+                action = kv + 7;
+            }
+            else if(strncmp(kv, "SUBSYSTEM=", 10) == 0)
+            {
+                subsystem = kv + 10;
+            }
+            else if(strncmp(kv, "DEVNAME=", 8) == 0)
+            {
+                devname = kv + 8;
+            }
+
+            off += kl + 1;
+        }
+
+        HandleEvent(action, subsystem, devname);
+    }
+#endif
+}
+
+void CorsairCapellixXTHotplug::CheckResume()
+{
+#ifdef __linux__
+    struct timespec boot;
+    struct timespec mono;
+
+    if(clock_gettime(CLOCK_BOOTTIME, &boot) != 0 || clock_gettime(CLOCK_MONOTONIC, &mono) != 0)
+    {
+        return;
+    }
+
+    int64_t now_ms = (int64_t)(boot.tv_sec - mono.tv_sec) * 1000
+                   + (boot.tv_nsec - mono.tv_nsec) / 1000000;
+    int64_t slept  = now_ms - asleep_ms;
+
+    bool first = asleep_ms < 0;
+    asleep_ms  = now_ms;
+
+    if(first || slept < HOTPLUG_RESUME_MIN_MS)
+    {
+        return;
+    }
+
+    CCLog(CC_LOG_INFO, "system resumed after %.1f s asleep, restoring device state", slept / 1000.0);
+
+    for(CorsairCapellixXTController* c : controllers)
+    {
+        c->NotifyResume();
+    }
+#endif
+}
+
+void CorsairCapellixXTHotplug::HandleEvent(const std::string& action,
+                                           const std::string& subsystem,
+                                           const std::string& devname)
+{
+    if(subsystem != "hidraw" || devname.empty())
+    {
+        return;
+    }
+
+    std::string node = devname[0] == '/' ? devname : "/dev/" + devname;
+
+    if(action == "remove")
+    {
+        /*-------------------------------------------------------------*\
+        | Close the dead handle right away instead of waiting for the   |
+        | next write to fail                                            |
+        \*-------------------------------------------------------------*/
+        for(CorsairCapellixXTController* c : controllers)
+        {
+            if(c->IsConnected() && c->GetDevicePath() == node)
+            {
+                c->MarkDisconnected();
+            }
+        }
+    }
+    else if(action == "add")
+    {
+        /*-------------------------------------------------------------*\
+        | Any new hidraw node may be ours (interface 0 and 1 arrive as  |
+        | separate events). Reconnect enumerates by serial, so trying   |
+        | every disconnected controller is cheap and safe.              |
+        \*-------------------------------------------------------------*/
+        for(int attempt = 0; attempt < HOTPLUG_OPEN_ATTEMPTS; attempt++)
+        {
+            bool pending = false;
+
+            for(CorsairCapellixXTController* c : controllers)
+            {
+                if(!c->IsConnected() && !c->Reconnect())
+                {
+                    pending = true;
+                }
+            }
+
+            if(!pending)
+            {
+                break;
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(HOTPLUG_OPEN_RETRY_MS));
+        }
+    }
+}
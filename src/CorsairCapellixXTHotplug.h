@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+class CorsairCapellixXTController;
+
+/*---------------------------------------------------------------------*\
+| Hotplug monitor (Linux): listens for hidraw add/remove uevents on a   |
+| netlink socket so a controller that lost its hidraw node is closed   |
+| as soon as the node goes away and reopened as soon as it returns.    |
+| On other platforms Start() is a no-op and the reconnect poll on the  |
+| service thread handles reconnects on its own.                        |
+|                                                                       |
+| The same thread watches for system resume: CLOCK_BOOTTIME keeps       |
+| counting during suspend and CLOCK_MONOTONIC does not, so a jump in    |
+| their difference between two polls means the machine slept. The      |
+| controllers are told at once, since the device may stay enumerated   |
+| but wake up in its hardware default.                                 |
+\*---------------------------------------------------------------------*/
+
+class CorsairCapellixXTHotplug
+{
+public:
+    CorsairCapellixXTHotplug(const std::vector<CorsairCapellixXTController*>& controllers);
+    ~CorsairCapellixXTHotplug();
+
+    void                                        Start();
+    void                                        Stop();
+
+private:
+    std::vector<CorsairCapellixXTController*>   controllers;
+
+    std::thread*                                monitor_thread = nullptr;
+    std::atomic<bool>                           monitor_thread_run{false};
+    int                                         sock           = -1;
+    int64_t                                     asleep_ms      = -1;    // BOOTTIME - MONOTONIC at the last poll
+
+    void                                        MonitorThread();
+    void                                        CheckResume();
+    void                                        HandleEvent(const std::string& action,
+                                                            const std::string& subsystem,
+                                                            const std::string& devname);
+};
@@ -0,0 +1,250 @@
+#include "CorsairCapellixXTHwmon.h"
+#include "CorsairCapellixXTLog.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+CCHwmonSensors::CCHwmonSensors()
+{
+}
+
+CCHwmonSensors::~CCHwmonSensors()
+{
+    Close();
+}
+
+void CCHwmonSensors::Open(const std::vector<CCHwmonSelector>& selectors)
+{
+    Close();
+
+    for(const CCHwmonSelector& selector : selectors)
+    {
+        Source source;
+
+        source.selector     = selector;
+        source.fd           = -1;
+        source.valid        = false;
+        source.tempC        = 0.0f;
+        source.warned       = false;
+        source.next_resolve = std::chrono::steady_clock::time_point();
+
+        sources.push_back(source);
+    }
+}
+
+void CCHwmonSensors::Close()
+{
+    for(Source& source : sources)
+    {
+        CloseSource(source);
+    }
+    sources.clear();
+}
+
+void CCHwmonSensors::CloseSource(Source& source)
+{
+#ifdef __linux__
+    if(source.fd >= 0)
+    {
+        close(source.fd);
+    }
+#endif
+    source.fd    = -1;
+    source.valid = false;
+}
+
+/*---------------------------------------------------------------------*\
+| Small sysfs attribute into buf, trailing newline removed              |
+\*---------------------------------------------------------------------*/
+
+#ifdef __linux__
+static bool ReadAttribute(const std::string& path, char* buf, size_t size)
+{
+    FILE* f = fopen(path.c_str(), "r");
+    if(f == nullptr)
+    {
+        return false;
+    }
+
+    bool ok = fgets(buf, (int)size, f) != nullptr;
+    fclose(f);
+
+    if(ok)
+    {
+        buf[strcspn(buf, "\n")] = '\0';
+    }
+    return ok;
+}
+#endif
+
+void CCHwmonSensors::Resolve(Source& source)
+{
+    source.next_resolve = std::chrono::steady_clock::now() + std::chrono::seconds(CC_HWMON_RESOLVE_SEC);
+
+#ifdef __linux__
+    DIR*           root = opendir(CC_HWMON_ROOT);
+    struct dirent* chip_entry;
+
+    while(root != nullptr && source.fd < 0 && (chip_entry = readdir(root)) != nullptr)
+    {
+        if(strncmp(chip_entry->d_name, "hwmon", 5) != 0)
+        {
+            continue;
+        }
+
+        std::string chip_dir = std::string(CC_HWMON_ROOT) + "/" + chip_entry->d_name;
+        char        name[64];
+
+        if(!ReadAttribute(chip_dir + "/name", name, sizeof(name)) || source.selector.chip != name)
+        {
+            continue;
+        }
+
+        DIR* chip = opendir(chip_dir.c_str());
+        if(chip == nullptr)
+        {
+            continue;
+        }
+
+        struct dirent* sensor_entry;
+
+        while((sensor_entry = readdir(chip)) != nullptr)
+        {
+            unsigned int index;
+            char         suffix[8];
+
+            if(sscanf(sensor_entry->d_name, "temp%u_%7s", &index, suffix) != 2 || strcmp(suffix, "input") != 0)
+            {
+                continue;
+            }
+
+            std::string sensor = "temp" + std::to_string(index);
+            char        label[64];
+
+            if(!ReadAttribute(chip_dir + "/" + sensor + "_label", label, sizeof(label)))
+            {
+                snprintf(label, sizeof(label), "%s", sensor.c_str());
+            }
+
+            if(source.selector.label != label && source.selector.label != sensor)
+            {
+                continue;
+            }
+
+            std::string path = chip_dir + "/" + sensor_entry->d_name;
+
+            source.fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if(source.fd >= 0)
+            {
+                source.path   = path;
+                source.warned = false;
+                CCLog(CC_LOG_INFO, "fan source %s/%s is %s",
+                      source.selector.chip.c_str(), source.selector.label.c_str(), path.c_str());
+                break;
+            }
+        }
+        closedir(chip);
+    }
+
+    if(root != nullptr)
+    {
+        closedir(root);
+    }
+#endif
+
+    if(source.fd < 0 && !source.warned)
+    {
+        CCLog(CC_LOG_WARN, "fan source %s/%s not found, retrying every %d s",
+              source.selector.chip.c_str(), source.selector.label.c_str(), CC_HWMON_RESOLVE_SEC);
+        source.warned = true;
+    }
+}
+
+void CCHwmonSensors::ReadAll()
+{
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+    for(Source& source : sources)
+    {
+        if(source.fd < 0)
+        {
+            if(now < source.next_resolve)
+            {
+                continue;
+            }
+            Resolve(source);
+            if(source.fd < 0)
+            {
+                continue;
+            }
+        }
+
+#ifdef __linux__
+        char    buf[24];
+        ssize_t len = pread(source.fd, buf, sizeof(buf) - 1, 0);
+
+        if(len <= 0)
+        {
+            /*---------------------------------------------------------*\
+            | The chip went away (driver unloaded) or the sensor is in  |
+            | a state it cannot report; look the source up again later  |
+            \*---------------------------------------------------------*/
+            CCLog(CC_LOG_WARN, "fan source %s/%s stopped reading", source.selector.chip.c_str(), source.selector.label.c_str());
+            CloseSource(source);
+            source.next_resolve = now + std::chrono::seconds(CC_HWMON_RESOLVE_SEC);
+            continue;
+        }
+        buf[len] = '\0';
+
+        char* end;
+        long  millidegrees = strtol(buf, &end, 10);
+        float tempC        = millidegrees / 1000.0f;
+
+        source.valid = end != buf && tempC >= CC_HWMON_MIN_C && tempC <= CC_HWMON_MAX_C;
+        source.tempC = tempC;
+#endif
+    }
+}
+
+size_t CCHwmonSensors::Count()
+{
+    return sources.size();
+}
+
+std::string CCHwmonSensors::Name(size_t index)
+{
+    return sources[index].selector.chip + "/" + sources[index].selector.label;
+}
+
+bool CCHwmonSensors::Valid(size_t index)
+{
+    return sources[index].valid;
+}
+
+float CCHwmonSensors::Temp(size_t index)
+{
+    return sources[index].tempC;
+}
+
+bool CCHwmonSensors::Hottest(float& tempC)
+{
+    bool found = false;
+
+    for(const Source& source : sources)
+    {
+        if(source.valid && (!found || source.tempC > tempC))
+        {
+            tempC = source.tempC;
+            found = true;
+        }
+    }
+
+    return found;
+}
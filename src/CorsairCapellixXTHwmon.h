@@ -0,0 +1,75 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+/*---------------------------------------------------------------------*\
+| hwmon temperature sources for the fan curve (Linux).                  |
+|                                                                       |
+| A source is picked by chip name and sensor label rather than by path, |
+| because the hwmonN numbering changes between boots:                   |
+|   /sys/class/hwmon/hwmonN/name          chip,  e.g. "amdgpu"          |
+|   /sys/class/hwmon/hwmonN/tempM_label   label, e.g. "edge"            |
+| A sensor without a label file matches its own name ("temp1").         |
+|                                                                       |
+| Each resolved tempM_input stays open and is re-read with pread() from |
+| offset 0, so a tick costs one syscall per source and nothing is       |
+| parsed beyond one integer. ReadAll() runs once per cooling tick and   |
+| caches the result. Sources that cannot be found or stop reading (a    |
+| GPU driver reload) are looked up again every CC_HWMON_RESOLVE_SEC.    |
+| Elsewhere there is no sysfs and no source ever resolves.              |
+\*---------------------------------------------------------------------*/
+
+#define CC_HWMON_ROOT               "/sys/class/hwmon"
+#define CC_HWMON_RESOLVE_SEC        30
+#define CC_HWMON_MIN_C              -20.0f  // readings outside are ignored
+#define CC_HWMON_MAX_C              150.0f
+
+struct CCHwmonSelector
+{
+    std::string                 chip;
+    std::string                 label;
+};
+
+class CCHwmonSensors
+{
+public:
+    CCHwmonSensors();
+    ~CCHwmonSensors();
+
+    /*-----------------------------------------------------------------*\
+    | Replace the source set; closes the previous descriptors           |
+    \*-----------------------------------------------------------------*/
+    void                        Open(const std::vector<CCHwmonSelector>& selectors);
+    void                        Close();
+
+    void                        ReadAll();
+
+    size_t                      Count();
+    std::string                 Name(size_t index);         // "chip/label"
+    bool                        Valid(size_t index);        // last ReadAll() got a reading
+    float                       Temp(size_t index);
+
+    /*-----------------------------------------------------------------*\
+    | Hottest valid reading of the last ReadAll(); false if none        |
+    \*-----------------------------------------------------------------*/
+    bool                        Hottest(float& tempC);
+
+private:
+    struct Source
+    {
+        CCHwmonSelector                         selector;
+        int                                     fd;
+        std::string                             path;
+        bool                                    valid;
+        float                                   tempC;
+        bool                                    warned;
+        std::chrono::steady_clock::time_point   next_resolve;
+    };
+
+    void                        Resolve(Source& source);
+    void                        CloseSource(Source& source);
+
+    std::vector<Source>         sources;
+};
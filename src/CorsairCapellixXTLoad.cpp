@@ -0,0 +1,88 @@
+#include "CorsairCapellixXTLoad.h"
+
+#include <cstdio>
+#include <cstring>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+CCCpuLoad::CCCpuLoad()
+    : fd(-1)
+    , primed(false)
+    , last_busy(0)
+    , last_total(0)
+{
+}
+
+CCCpuLoad::~CCCpuLoad()
+{
+#ifdef __linux__
+    if(fd >= 0)
+    {
+        close(fd);
+    }
+#endif
+}
+
+int CCCpuLoad::Sample()
+{
+#ifdef __linux__
+    if(fd < 0)
+    {
+        fd = open(CC_PROC_STAT_PATH, O_RDONLY | O_CLOEXEC);
+
+        if(fd < 0)
+        {
+            return -1;
+        }
+    }
+
+    /*-----------------------------------------------------------------*\
+    | The aggregate line comes first and is well under 256 bytes        |
+    \*-----------------------------------------------------------------*/
+    char    buf[256];
+    ssize_t len = pread(fd, buf, sizeof(buf) - 1, 0);
+
+    if(len <= 0)
+    {
+        return -1;
+    }
+    buf[len] = '\0';
+
+    unsigned long long v[8] = {};
+
+    if(sscanf(buf, "cpu %llu %llu %llu %llu %llu %llu %llu %llu",
+              &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6], &v[7]) < 4)
+    {
+        return -1;
+    }
+
+    uint64_t total = 0;
+
+    for(unsigned long long field : v)
+    {
+        total += field;
+    }
+
+    uint64_t busy = total - v[3] - v[4];   // minus idle and iowait
+
+    uint64_t d_total = total - last_total;
+    uint64_t d_busy  = busy  - last_busy;
+    bool     first   = !primed;
+
+    primed     = true;
+    last_total = total;
+    last_busy  = busy;
+
+    if(first || d_total == 0 || d_busy > d_total)
+    {
+        return -1;
+    }
+
+    return (int)(d_busy * 100 / d_total);
+#else
+    return -1;
+#endif
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+
+/*---------------------------------------------------------------------*\
+| System CPU load for the cooling feed-forward (Linux).                 |
+|                                                                       |
+| /proc/stat is opened once and re-read with pread() from offset 0 on   |
+| every sample, so a sample is one syscall and no allocation. Only the  |
+| aggregate "cpu" line is parsed:                                       |
+|   cpu user nice system idle iowait irq softirq steal ...              |
+| Busy is everything except idle and iowait. Elsewhere there is no      |
+| source and Sample() always returns -1.                                |
+\*---------------------------------------------------------------------*/
+
+#define CC_PROC_STAT_PATH           "/proc/stat"
+
+class CCCpuLoad
+{
+public:
+    CCCpuLoad();
+    ~CCCpuLoad();
+
+    /*-----------------------------------------------------------------*\
+    | Percent of CPU time busy since the previous call, 0..100; -1 on   |
+    | the first call or when /proc/stat cannot be read                  |
+    \*-----------------------------------------------------------------*/
+    int                         Sample();
+
+private:
+    int                         fd;
+    bool                        primed;
+    uint64_t                    last_busy;
+    uint64_t                    last_total;
+};
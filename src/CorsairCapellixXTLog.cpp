@@ -0,0 +1,267 @@
+#include "CorsairCapellixXTLog.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static_assert((CC_LOG_QUEUE_SLOTS & (CC_LOG_QUEUE_SLOTS - 1)) == 0, "CC_LOG_QUEUE_SLOTS must be a power of two");
+
+static const char* const cc_log_level_names[] = { "error", "warn", "info", "debug" };
+
+/*---------------------------------------------------------------------*\
+| Set once the logger is destroyed at exit; anything logged later (from |
+| other static destructors) goes straight to stdout                     |
+\*---------------------------------------------------------------------*/
+static std::atomic<bool> cc_log_closed{false};
+
+static int64_t NowMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+CorsairCapellixXTLog* CorsairCapellixXTLog::Get()
+{
+    static CorsairCapellixXTLog log;
+    return &log;
+}
+
+CorsairCapellixXTLog::CorsairCapellixXTLog()
+{
+    for(size_t i = 0; i < CC_LOG_QUEUE_SLOTS; i++)
+    {
+        slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    const char* env = getenv(CC_LOG_ENV);
+
+    for(int level = CC_LOG_ERROR; env != nullptr && level <= CC_LOG_DEBUG; level++)
+    {
+        if(strcmp(env, cc_log_level_names[level]) == 0)
+        {
+            threshold.store(level);
+        }
+    }
+
+    writer_thread = new std::thread(&CorsairCapellixXTLog::WriterThread, this);
+}
+
+CorsairCapellixXTLog::~CorsairCapellixXTLog()
+{
+    writer_run.store(false);
+    writer_cv.notify_all();
+
+    writer_thread->join();
+    delete writer_thread;
+    writer_thread = nullptr;
+
+    cc_log_closed.store(true);
+}
+
+bool CorsairCapellixXTLog::Enabled(CCLogLevel level)
+{
+    return (int)level <= threshold.load(std::memory_order_relaxed);
+}
+
+/*---------------------------------------------------------------------*\
+| Producer side: never blocks. A full queue counts the line as dropped. |
+\*---------------------------------------------------------------------*/
+
+void CorsairCapellixXTLog::Push(CCLogLevel level, const char* text, size_t length)
+{
+    size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+    Slot*  slot;
+
+    for(;;)
+    {
+        slot = &slots[pos & (CC_LOG_QUEUE_SLOTS - 1)];
+
+        size_t    seq  = slot->sequence.load(std::memory_order_acquire);
+        ptrdiff_t diff = (ptrdiff_t)seq - (ptrdiff_t)pos;
+
+        if(diff == 0)
+        {
+            if(enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if(diff < 0)
+        {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        else
+        {
+            pos = enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+
+    if(length >= CC_LOG_LINE_MAX)
+    {
+        length = CC_LOG_LINE_MAX - 1;
+    }
+
+    memcpy(slot->text, text, length);
+    slot->level  = level;
+    slot->length = (uint16_t)length;
+    slot->sequence.store(pos + 1, std::memory_order_release);
+
+    writer_cv.notify_one();
+}
+
+/*---------------------------------------------------------------------*\
+| Writer side: print everything queued, one fflush per batch            |
+\*---------------------------------------------------------------------*/
+
+size_t CorsairCapellixXTLog::Drain()
+{
+    size_t count = 0;
+    size_t pos   = dequeue_pos.load(std::memory_order_relaxed);
+
+    for(;;)
+    {
+        Slot*  slot = &slots[pos & (CC_LOG_QUEUE_SLOTS - 1)];
+        size_t seq  = slot->sequence.load(std::memory_order_acquire);
+
+        if(seq != pos + 1)
+        {
+            break;
+        }
+
+        printf("[CommanderCore] %s %.*s\n", cc_log_level_names[slot->level], (int)slot->length, slot->text);
+
+        slot->sequence.store(pos + CC_LOG_QUEUE_SLOTS, std::memory_order_release);
+        pos++;
+        count++;
+    }
+
+    dequeue_pos.store(pos, std::memory_order_relaxed);
+
+    uint64_t lost = dropped.exchange(0, std::memory_order_relaxed);
+
+    if(lost > 0)
+    {
+        printf("[CommanderCore] warn %llu log lines dropped (queue full)\n", (unsigned long long)lost);
+    }
+
+    if(count > 0 || lost > 0)
+    {
+        fflush(stdout);
+    }
+
+    written_pos.store(pos, std::memory_order_release);
+    return count;
+}
+
+void CorsairCapellixXTLog::WriterThread()
+{
+    while(writer_run.load())
+    {
+        if(Drain() > 0)
+        {
+            continue;
+        }
+
+        /*-------------------------------------------------------------*\
+        | Producers notify without the mutex, so a wakeup can slip in   |
+        | between the check and the wait; the timeout bounds that       |
+        \*-------------------------------------------------------------*/
+        std::unique_lock<std::mutex> lock(writer_mutex);
+        writer_cv.wait_for(lock, std::chrono::seconds(1));
+    }
+
+    Drain();
+}
+
+void CorsairCapellixXTLog::Flush()
+{
+    size_t target = enqueue_pos.load(std::memory_order_acquire);
+
+    while(written_pos.load(std::memory_order_acquire) < target && writer_run.load())
+    {
+        writer_cv.notify_one();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+/*---------------------------------------------------------------------*\
+| Public helpers                                                        |
+\*---------------------------------------------------------------------*/
+
+bool CCLogEnabled(CCLogLevel level)
+{
+    return !cc_log_closed.load() && CorsairCapellixXTLog::Get()->Enabled(level);
+}
+
+void CCLog(CCLogLevel level, const char* fmt, ...)
+{
+    if(cc_log_closed.load())
+    {
+        va_list args;
+        va_start(args, fmt);
+        printf("[CommanderCore] %s ", cc_log_level_names[level]);
+        vprintf(fmt, args);
+        printf("\n");
+        va_end(args);
+        return;
+    }
+
+    CorsairCapellixXTLog* log = CorsairCapellixXTLog::Get();
+
+    if(!log->Enabled(level))
+    {
+        return;
+    }
+
+    char    line[CC_LOG_LINE_MAX];
+    va_list args;
+
+    va_start(args, fmt);
+    int length = vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+
+    if(length < 0)
+    {
+        return;
+    }
+
+    log->Push(level, line, std::min<size_t>((size_t)length, sizeof(line) - 1));
+}
+
+void CCLogFlush()
+{
+    if(!cc_log_closed.load())
+    {
+        CorsairCapellixXTLog::Get()->Flush();
+    }
+}
+
+CCLogLimiter::CCLogLimiter(unsigned int interval_ms)
+    : interval_ms(interval_ms)
+    , next_ms(0)
+    , suppressed(0)
+{
+}
+
+bool CCLogLimiter::Allow()
+{
+    int64_t now  = NowMs();
+    int64_t next = next_ms.load(std::memory_order_relaxed);
+
+    if(now >= next && next_ms.compare_exchange_strong(next, now + interval_ms, std::memory_order_relaxed))
+    {
+        return true;
+    }
+
+    suppressed.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+unsigned int CCLogLimiter::TakeSuppressed()
+{
+    return suppressed.exchange(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+/*---------------------------------------------------------------------*\
+| Logging                                                               |
+|                                                                       |
+| CCLog() formats the line on the calling thread into a slot of a       |
+| bounded lock-free queue and returns; a background writer prints the   |
+| queue to stdout. The service thread therefore never blocks on stdio   |
+| (a stalled journald pipe or terminal), and a full queue drops lines   |
+| instead of waiting — the writer reports how many.                      |
+|                                                                       |
+| Lines look like                                                       |
+|   [CommanderCore] info 1234ABCD reconnected path=/dev/hidraw3         |
+| Levels: error, warn, info (default), debug. CC_LOG_LEVEL=<level> in   |
+| the environment changes the threshold. Periodic status goes out at    |
+| info only when it changes and at debug every time.                    |
+\*---------------------------------------------------------------------*/
+
+#define CC_LOG_ENV                  "CC_LOG_LEVEL"
+#define CC_LOG_QUEUE_SLOTS          256     // power of two
+#define CC_LOG_LINE_MAX             256     // longer lines are cut
+
+enum CCLogLevel
+{
+    CC_LOG_ERROR                = 0,
+    CC_LOG_WARN                 = 1,
+    CC_LOG_INFO                 = 2,
+    CC_LOG_DEBUG                = 3,
+};
+
+#if defined(__GNUC__)
+#define CC_LOG_PRINTF(fmt, args)    __attribute__((format(printf, fmt, args)))
+#else
+#define CC_LOG_PRINTF(fmt, args)
+#endif
+
+void CCLog(CCLogLevel level, const char* fmt, ...) CC_LOG_PRINTF(2, 3);
+bool CCLogEnabled(CCLogLevel level);
+
+/*---------------------------------------------------------------------*\
+| Wait until every line logged so far is written (before a process     |
+| prints its own output or exits)                                       |
+\*---------------------------------------------------------------------*/
+void CCLogFlush();
+
+/*---------------------------------------------------------------------*\
+| Per call site rate limit for messages that can repeat quickly:        |
+|   static CCLogLimiter limiter(5000);                                  |
+|   if(limiter.Allow()) CCLog(...);                                     |
+| The next line that gets through reports how many were held back.      |
+\*---------------------------------------------------------------------*/
+
+class CCLogLimiter
+{
+public:
+    CCLogLimiter(unsigned int interval_ms);
+
+    bool                        Allow();
+    unsigned int                TakeSuppressed();
+
+private:
+    unsigned int                interval_ms;
+    std::atomic<int64_t>        next_ms;
+    std::atomic<unsigned int>   suppressed;
+};
+
+class CorsairCapellixXTLog
+{
+public:
+    static CorsairCapellixXTLog*                Get();
+
+    bool                                        Enabled(CCLogLevel level);
+    void                                        Push(CCLogLevel level, const char* text, size_t length);
+    void                                        Flush();
+
+private:
+    CorsairCapellixXTLog();
+    ~CorsairCapellixXTLog();
+
+    /*-----------------------------------------------------------------*\
+    | Bounded MPMC queue (sequence number per slot). Producers claim a   |
+    | slot with one CAS; the writer is the only consumer.                |
+    \*-----------------------------------------------------------------*/
+    struct Slot
+    {
+        std::atomic<size_t>                     sequence;
+        CCLogLevel                              level;
+        uint16_t                                length;
+        char                                    text[CC_LOG_LINE_MAX];
+    };
+
+    Slot                                        slots[CC_LOG_QUEUE_SLOTS];
+    std::atomic<size_t>                         enqueue_pos{0};
+    std::atomic<size_t>                         dequeue_pos{0};
+    std::atomic<size_t>                         written_pos{0};     // dequeued and flushed
+    std::atomic<uint64_t>                       dropped{0};
+    std::atomic<int>                            threshold{CC_LOG_INFO};
+
+    std::mutex                                  writer_mutex;   // only for the writer's sleep
+    std::condition_variable                     writer_cv;
+    std::atomic<bool>                           writer_run{true};
+    std::thread*                                writer_thread = nullptr;
+
+    void                                        WriterThread();
+    size_t                                      Drain();
+};
@@ -0,0 +1,614 @@
+#include "CorsairCapellixXTMetrics.h"
+#include "CorsairCapellixXTController.h"
+#include "CorsairCapellixXTLog.h"
+#include "CorsairCapellixXTSettings.h"
+
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <strings.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#endif
+
+CorsairCapellixXTMetrics::CorsairCapellixXTMetrics(const std::vector<CorsairCapellixXTController*>& ctrls)
+    : controllers(ctrls)
+{
+}
+
+CorsairCapellixXTMetrics::~CorsairCapellixXTMetrics()
+{
+    Stop();
+}
+
+void CorsairCapellixXTMetrics::Start()
+{
+#ifndef _WIN32
+    if(server_thread != nullptr || controllers.empty())
+    {
+        return;
+    }
+
+    std::string   path = CCSettingsPath(CC_METRICS_FILE);
+    std::ifstream in(path);
+    std::string   line;
+
+    while(in.is_open() && std::getline(in, line))
+    {
+        std::istringstream ls(line);
+        std::string        key, kind, where;
+
+        if(!(ls >> key >> kind >> where) || key != "listen")
+        {
+            continue;
+        }
+
+        if(OpenListener(kind, where))
+        {
+            server_thread_run = true;
+            server_thread     = new std::thread(&CorsairCapellixXTMetrics::ServerThread, this);
+
+            CCLog(CC_LOG_INFO, "metrics on %s %s", kind.c_str(), where.c_str());
+        }
+        return;
+    }
+#endif
+}
+
+void CorsairCapellixXTMetrics::Stop()
+{
+    if(server_thread)
+    {
+        server_thread_run = false;
+        server_thread->join();
+        delete server_thread;
+        server_thread = nullptr;
+    }
+
+#ifndef _WIN32
+    if(sock >= 0)
+    {
+        close(sock);
+        sock = -1;
+    }
+
+    if(!unix_path.empty())
+    {
+        unlink(unix_path.c_str());
+        unix_path.clear();
+    }
+#endif
+}
+
+/*---------------------------------------------------------------------*\
+| Listener: "unix <path>" or "tcp <port>". TCP is bound to 127.0.0.1    |
+| only; put a reverse proxy in front to scrape from another host.       |
+\*---------------------------------------------------------------------*/
+
+bool CorsairCapellixXTMetrics::OpenListener(const std::string& kind, const std::string& where)
+{
+#ifdef _WIN32
+    (void)kind; (void)where;
+    return false;
+#else
+    if(kind == "unix")
+    {
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+
+        if(where.size() >= sizeof(addr.sun_path))
+        {
+            CCLog(CC_LOG_ERROR, "metrics socket path too long: %s", where.c_str());
+            return false;
+        }
+
+        strncpy(addr.sun_path, where.c_str(), sizeof(addr.sun_path) - 1);
+
+        sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if(sock < 0)
+        {
+            return false;
+        }
+
+        unlink(where.c_str());
+
+        if(bind(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(sock, 4) < 0)
+        {
+            CCLog(CC_LOG_ERROR, "cannot listen on %s", where.c_str());
+            close(sock);
+            sock = -1;
+            return false;
+        }
+
+        unix_path = where;
+        return true;
+    }
+
+    if(kind == "tcp")
+    {
+        int port = atoi(where.c_str());
+
+        if(port <= 0 || port > 65535)
+        {
+            CCLog(CC_LOG_ERROR, "bad metrics port: %s", where.c_str());
+            return false;
+        }
+
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family      = AF_INET;
+        addr.sin_port        = htons((uint16_t)port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        sock = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if(sock < 0)
+        {
+            return false;
+        }
+
+        int one = 1;
+        setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+        if(bind(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(sock, 4) < 0)
+        {
+            CCLog(CC_LOG_ERROR, "cannot listen on 127.0.0.1:%d", port);
+            close(sock);
+            sock = -1;
+            return false;
+        }
+
+        tcp_port = port;
+        return true;
+    }
+
+    CCLog(CC_LOG_ERROR, "unknown metrics listener '%s'", kind.c_str());
+    return false;
+#endif
+}
+
+void CorsairCapellixXTMetrics::ServerThread()
+{
+#ifndef _WIN32
+    while(server_thread_run)
+    {
+        struct pollfd pfd;
+        pfd.fd      = sock;
+        pfd.events  = POLLIN;
+        pfd.revents = 0;
+
+        if(poll(&pfd, 1, CC_METRICS_POLL_MS) <= 0)
+        {
+            continue;
+        }
+
+        int client = accept(sock, nullptr, nullptr);
+
+        if(client >= 0)
+        {
+            HandleClient(client);
+            close(client);
+        }
+    }
+#endif
+}
+
+/*---------------------------------------------------------------------*\
+| One request per connection (HTTP/1.0 style). The request line picks   |
+| the page: GET /metrics (or /) gets the exposition, anything else 404. |
+| Nothing here changes device state (profiles switch over the control   |
+| socket, CorsairCapellixXTControl). Of the headers only two are looked |
+| at, to keep web pages out: a request with an Origin header (which     |
+| browsers add to cross-site requests) is refused, and so is one on the |
+| TCP port whose Host is not the loopback address (DNS rebinding).      |
+\*---------------------------------------------------------------------*/
+
+#ifndef _WIN32
+static bool HeaderValue(const std::string& request, const char* name, std::string& value)
+{
+    size_t name_len = strlen(name);
+    size_t line     = request.find("\r\n");
+
+    while(line != std::string::npos && line + 2 < request.size())
+    {
+        size_t start = line + 2;
+        size_t end   = request.find("\r\n", start);
+
+        if(end == std::string::npos || end == start)
+        {
+            break;
+        }
+
+        if(end - start > name_len && request[start + name_len] == ':'
+        && strncasecmp(request.c_str() + start, name, name_len) == 0)
+        {
+            size_t from = request.find_first_not_of(" \t", start + name_len + 1);
+
+            value = from < end ? request.substr(from, end - from) : "";
+            return true;
+        }
+
+        line = end;
+    }
+
+    return false;
+}
+#endif
+
+void CorsairCapellixXTMetrics::HandleClient(int client)
+{
+#ifdef _WIN32
+    (void)client;
+#else
+    std::string request;
+    char        buf[512];
+
+    while(request.size() < CC_METRICS_REQUEST_MAX && request.find("\r\n\r\n") == std::string::npos)
+    {
+        struct pollfd pfd;
+        pfd.fd      = client;
+        pfd.events  = POLLIN;
+        pfd.revents = 0;
+
+        if(poll(&pfd, 1, CC_METRICS_READ_TIMEOUT_MS) <= 0)
+        {
+            return;
+        }
+
+        ssize_t n = recv(client, buf, sizeof(buf), 0);
+        if(n <= 0)
+        {
+            break;
+        }
+
+        request.append(buf, (size_t)n);
+    }
+
+    std::string status = "404 Not Found";
+    std::string type   = "text/plain; charset=utf-8";
+    std::string body   = "not found\n";
+    std::string host;
+    std::string origin;
+
+    bool local_host = unix_path.empty()
+                   && HeaderValue(request, "Host", host)
+                   && (host == "127.0.0.1:" + std::to_string(tcp_port)
+                    || host == "localhost:" + std::to_string(tcp_port));
+
+    if(HeaderValue(request, "Origin", origin) || (unix_path.empty() && !local_host))
+    {
+        status = "403 Forbidden";
+        body   = "forbidden\n";
+    }
+    else if(request.compare(0, 13, "GET /metrics ") == 0 || request.compare(0, 6, "GET / ") == 0)
+    {
+        status = "200 OK";
+        type   = "application/openmetrics-text; version=1.0.0; charset=utf-8";
+        body   = Render();
+    }
+
+    std::string response = "HTTP/1.0 " + status + "\r\n"
+                           "Content-Type: " + type + "\r\n"
+                           "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                           "Connection: close\r\n\r\n" + body;
+
+    size_t sent = 0;
+
+    while(sent < response.size())
+    {
+        ssize_t n = send(client, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+        if(n <= 0)
+        {
+            break;
+        }
+        sent += (size_t)n;
+    }
+#endif
+}
+
+/*---------------------------------------------------------------------*\
+| Exposition                                                            |
+\*---------------------------------------------------------------------*/
+
+static std::string Label(const std::string& value)
+{
+    std::string out;
+
+    for(char c : value)
+    {
+        if(c == '\\' || c == '"')
+        {
+            out += '\\';
+            out += c;
+        }
+        else if(c == '\n')
+        {
+            out += "\\n";
+        }
+        else
+        {
+            out += c;
+        }
+    }
+
+    return out;
+}
+
+static void Family(std::ostringstream& out, const char* name, const char* type,
+                   const char* unit, const char* help)
+{
+    out << "# TYPE " << name << " " << type << "\n";
+    if(unit[0] != '\0')
+    {
+        out << "# UNIT " << name << " " << unit << "\n";
+    }
+    out << "# HELP " << name << " " << help << "\n";
+}
+
+std::string CorsairCapellixXTMetrics::Render()
+{
+    std::vector<std::string>            serials;
+    std::vector<CorsairCapellixXTStats> stats;
+
+    for(CorsairCapellixXTController* c : controllers)
+    {
+        serials.push_back(Label(c->GetSerialString()));
+        stats.push_back(c->GetStats());
+    }
+
+    std::ostringstream out;
+    out.precision(6);
+
+    Family(out, "commander_core_up", "gauge", "", "Device is open (1) or waiting to reconnect (0).");
+    for(size_t i = 0; i < stats.size(); i++)
+    {
+        out << "commander_core_up{serial=\"" << serials[i] << "\"} " << (stats[i].connected ? 1 : 0) << "\n";
+    }
+
+    Family(out, "commander_core_breaker_open", "gauge", "", "Circuit breaker is holding back I/O.");
+    for(size_t i = 0; i < stats.size(); i++)
+    {
+        out << "commander_core_breaker_open{serial=\"" << serials[i] << "\"} " << (stats[i].breaker_open ? 1 : 0) << "\n";
+    }
+
+    Family(out, "commander_core_watchdog_alarm", "gauge", "", "Cooling control loop missed its write or read SLO.");
+    for(size_t i = 0; i < stats.size(); i++)
+    {
+        out << "commander_core_watchdog_alarm{serial=\"" << serials[i] << "\"} " << (stats[i].watchdog_alarm ? 1 : 0) << "\n";
+    }
+
+    Family(out, "commander_core_control_age_seconds", "gauge", "seconds", "Time since the control loop last succeeded.");
+    for(size_t i = 0; i < stats.size(); i++)
+    {
+        if(stats[i].speed_write_age_s >= 0.0)
+        {
+            out << "commander_core_control_age_seconds{serial=\"" << serials[i] << "\",operation=\"speed_write\"} "
+                << stats[i].speed_write_age_s << "\n";
+        }
+        if(stats[i].sensor_read_age_s >= 0.0)
+        {
+            out << "commander_core_control_age_seconds{serial=\"" << serials[i] << "\",operation=\"sensor_read\"} "
+                << stats[i].sensor_read_age_s << "\n";
+        }
+    }
+
+    Family(out, "commander_core_profile", "info", "", "Active profile, if any.");
+    for(size_t i = 0; i < stats.size(); i++)
+    {
+        if(!stats[i].profile.empty())
+        {
+            out << "commander_core_profile_info{serial=\"" << serials[i] << "\",profile=\"" << Label(stats[i].profile) << "\"} 1\n";
+        }
+    }
+
+    Family(out, "commander_core_profile_burst_seconds", "gauge", "seconds", "Device I/O of the last profile switch.");
+    for(size_t i = 0; i < stats.size(); i++)
+    {
+        if(stats[i].profile_burst_s >= 0.0)
+        {
+            out << "commander_core_profile_burst_seconds{serial=\"" << serials[i] << "\"} " << stats[i].profile_burst_s << "\n";
+        }
+    }
+
+    Family(out, "commander_core_pump_mode", "stateset", "", "Selected cooling mode.");
+    for(size_t i = 0; i < stats.size(); i++)
+    {
+        for(int mode = PUMP_MODE_AUTO; mode <= PUMP_MODE_TARGET; mode++)
+        {
+            out << "commander_core_pump_mode{serial=\"" << serials[i] << "\",commander_core_pump_mode=\""
+                << CorsairCapellixXTController::PumpModeName(mode) << "\"} "
+                << (stats[i].pump_mode == mode ? 1 : 0) << "\n";
+        }
+    }
+
+    Family(out, "commander_core_liquid_temperature_celsius", "gauge", "celsius", "Last accepted liquid temperature.");
+    for(size_t i = 0; i < stats.size(); i++)
+    {
+        if(stats[i].liquid_temp >= 0.0f)
+        {
+            out << "commander_core_liquid_temperature_celsius{serial=\"" << serials[i] << "\"} "
+                << stats[i].liquid_temp << "\n";
+        }
+    }
+
+    Family(out, "commander_core_fan_source_celsius", "gauge", "celsius", "hwmon temperatures the fan curve follows.");
+    for(size_t i = 0; i < stats.size(); i++)
+    {
+        for(const std::pair<std::string, float>& source : stats[i].fan_sources)
+        {
+            out << "commander_core_fan_source_celsius{serial=\"" << serials[i] << "\",source=\""
+                << Label(source.first) << "\"} " << source.second << "\n";
+        }
+    }
+
+    Family(out, "commander_core_duty_percent", "gauge", "percent", "Last duty written (pump: channel 0, fan: channels 1-6).");
+    for(size_t i = 0; i < stats.size(); i++)
+    {
+        out << "commander_core_duty_percent{serial=\"" << serials[i] << "\",target=\"pump\"} " << (unsigned)stats[i].pump_duty << "\n";
+        out << "commander_core_duty_percent{serial=\"" << serials[i] << "\",target=\"fan\"} "  << (unsigned)stats[i].fan_duty  << "\n";
+    }
+
+    Family(out, "commander_core_speed_rpm", "gauge", "rpm", "Last speed reading per channel (0 = pump).");
+    for(size_t i = 0; i < stats.size(); i++)
+    {
+        for(size_t ch = 0; ch < stats[i].rpm.size(); ch++)
+        {
+            if(stats[i].rpm[ch] >= 0)
+            {
+                out << "commander_core_speed_rpm{serial=\"" << serials[i] << "\",channel=\"" << ch << "\"} "
+                    << stats[i].rpm[ch] << "\n";
+            }
+        }
+    }
+
+    Family(out, "commander_core_init_phase_seconds", "gauge", "seconds", "Duration of each phase of the last device bring-up.");
+    for(size_t i = 0; i < stats.size(); i++)
+    {
+        for(unsigned int phase = 0; phase < CC_INIT_PHASE_COUNT; phase++)
+        {
+            if(stats[i].init_phase_s[phase] >= 0.0)
+            {
+                out << "commander_core_init_phase_seconds{serial=\"" << serials[i] << "\",phase=\""
+                    << CC_INIT_PHASE_NAMES[phase] << "\"} " << stats[i].init_phase_s[phase] << "\n";
+            }
+        }
+    }
+
+    Family(out, "commander_core_transfer_seconds", "histogram", "seconds", "Command round trip including retries.");
+    for(size_t i = 0; i < stats.size(); i++)
+    {
+        uint64_t cumulative = 0;
+
+        for(unsigned int b = 0; b < CC_LATENCY_BUCKET_COUNT; b++)
+        {
+            cumulative += stats[i].latency_buckets[b];
+            out << "commander_core_transfer_seconds_bucket{serial=\"" << serials[i] << "\",le=\""
+                << CC_LATENCY_BUCKETS_S[b] << "\"} " << cumulative << "\n";
+        }
+
+        out << "commander_core_transfer_seconds_bucket{serial=\"" << serials[i] << "\",le=\"+Inf\"} " << stats[i].latency_count << "\n";
+        out << "commander_core_transfer_seconds_count{serial=\"" << serials[i] << "\"} " << stats[i].latency_count << "\n";
+        out << "commander_core_transfer_seconds_sum{serial=\""   << serials[i] << "\"} " << stats[i].latency_sum_s << "\n";
+    }
+
+    Family(out, "commander_core_cooling_wait_seconds", "histogram", "seconds", "Wait for the device lock before each cooling step.");
+    for(size_t i = 0; i < stats.size(); i++)
+    {
+        uint64_t cumulative = 0;
+
+        for(unsigned int b = 0; b < CC_LATENCY_BUCKET_COUNT; b++)
+        {
+            cumulative += stats[i].cooling_wait_buckets[b];
+            out << "commander_core_cooling_wait_seconds_bucket{serial=\"" << serials[i] << "\",le=\""
+                << CC_LATENCY_BUCKETS_S[b] << "\"} " << cumulative << "\n";
+        }
+
+        out << "commander_core_cooling_wait_seconds_bucket{serial=\"" << serials[i] << "\",le=\"+Inf\"} " << stats[i].cooling_wait_count << "\n";
+        out << "commander_core_cooling_wait_seconds_count{serial=\"" << serials[i] << "\"} " << stats[i].cooling_wait_count << "\n";
+        out << "commander_core_cooling_wait_seconds_sum{serial=\""   << serials[i] << "\"} " << stats[i].cooling_wait_sum_s << "\n";
+    }
+
+    Family(out, "commander_core_cooling_wait_max_seconds", "gauge", "seconds", "Worst wait for the device lock before a cooling step.");
+    for(size_t i = 0; i < stats.size(); i++)
+    {
+        out << "commander_core_cooling_wait_max_seconds{serial=\"" << serials[i] << "\"} " << stats[i].cooling_wait_max_s << "\n";
+    }
+
+    Family(out, "commander_core_frame_sync_skew_seconds", "histogram", "seconds", "Spread of last-chunk completions across the frame sync group.");
+    for(size_t i = 0; i < stats.size(); i++)
+    {
+        uint64_t cumulative = 0;
+
+        for(unsigned int b = 0; b < CC_SKEW_BUCKET_COUNT; b++)
+        {
+            cumulative += stats[i].sync_skew_buckets[b];
+            out << "commander_core_frame_sync_skew_seconds_bucket{serial=\"" << serials[i] << "\",le=\""
+                << CC_SKEW_BUCKETS_S[b] << "\"} " << cumulative << "\n";
+        }
+
+        out << "commander_core_frame_sync_skew_seconds_bucket{serial=\"" << serials[i] << "\",le=\"+Inf\"} " << stats[i].sync_skew_count << "\n";
+        out << "commander_core_frame_sync_skew_seconds_count{serial=\"" << serials[i] << "\"} " << stats[i].sync_skew_count << "\n";
+        out << "commander_core_frame_sync_skew_seconds_sum{serial=\""   << serials[i] << "\"} " << stats[i].sync_skew_sum_s << "\n";
+    }
+
+    Family(out, "commander_core_frame_sync_skew_max_seconds", "gauge", "seconds", "Worst frame sync skew seen.");
+    for(size_t i = 0; i < stats.size(); i++)
+    {
+        out << "commander_core_frame_sync_skew_max_seconds{serial=\"" << serials[i] << "\"} " << stats[i].sync_skew_max_s << "\n";
+    }
+
+    struct Counter
+    {
+        const char*     name;
+        const char*     help;
+        uint64_t        CorsairCapellixXTStats::*field;
+    };
+
+    static const Counter counters[] =
+    {
+        { "commander_core_transfer_timeouts",  "Commands that got no reply within their deadline.", &CorsairCapellixXTStats::timeouts          },
+        { "commander_core_transfer_io_errors", "Failed HID writes or reads (device gone).",         &CorsairCapellixXTStats::io_errors         },
+        { "commander_core_bad_replies",        "Replies rejected for status or data type.",         &CorsairCapellixXTStats::bad_replies       },
+        { "commander_core_stale_replies",      "Late or foreign replies discarded.",                &CorsairCapellixXTStats::stale_replies     },
+        { "commander_core_rejected_readings",  "Implausible sensor values dropped.",                &CorsairCapellixXTStats::rejected_readings },
+        { "commander_core_breaker_trips",      "Times the circuit breaker opened.",                 &CorsairCapellixXTStats::breaker_trips     },
+        { "commander_core_reconnects",         "Times the device was reopened.",                    &CorsairCapellixXTStats::reconnects        },
+        { "commander_core_keepalives",         "Idle keepalives sent.",                             &CorsairCapellixXTStats::keepalives        },
+        { "commander_core_keepalive_bytes",    "Report bytes written by idle keepalives.",          &CorsairCapellixXTStats::keepalive_bytes   },
+        { "commander_core_color_frame_yields", "Color frames restarted to let cooling through.",    &CorsairCapellixXTStats::frame_yields      },
+        { "commander_core_frame_sync_partial", "Synced frames sent without every group member.",    &CorsairCapellixXTStats::sync_partial      },
+        { "commander_core_watchdog_alarms",    "Times the watchdog raised an alarm.",               &CorsairCapellixXTStats::watchdog_alarms   },
+        { "commander_core_profile_switches",   "Profiles applied.",                                 &CorsairCapellixXTStats::profile_switches  },
+    };
+
+    for(const Counter& counter : counters)
+    {
+        Family(out, counter.name, "counter", "", counter.help);
+        for(size_t i = 0; i < stats.size(); i++)
+        {
+            out << counter.name << "_total{serial=\"" << serials[i] << "\"} " << stats[i].*counter.field << "\n";
+        }
+    }
+
+    Family(out, "commander_core_keepalive_lock_seconds", "counter", "seconds", "Time idle keepalives held the device lock.");
+    for(size_t i = 0; i < stats.size(); i++)
+    {
+        out << "commander_core_keepalive_lock_seconds_total{serial=\"" << serials[i] << "\"} " << stats[i].keepalive_lock_s << "\n";
+    }
+
+    Family(out, "commander_core_keepalive_strategy", "stateset", "", "How idle keepalives are sent.");
+    for(size_t i = 0; i < stats.size(); i++)
+    {
+        out << "commander_core_keepalive_strategy{serial=\"" << serials[i] << "\",commander_core_keepalive_strategy=\"ping\"} "
+            << (stats[i].keepalive_strategy == CC_KEEPALIVE_PING ? 1 : 0) << "\n";
+        out << "commander_core_keepalive_strategy{serial=\"" << serials[i] << "\",commander_core_keepalive_strategy=\"frame\"} "
+            << (stats[i].keepalive_strategy == CC_KEEPALIVE_FRAME ? 1 : 0) << "\n";
+    }
+
+    Family(out, "commander_core_frame_layout", "stateset", "", "Color frame layout in use.");
+    for(size_t i = 0; i < stats.size(); i++)
+    {
+        out << "commander_core_frame_layout{serial=\"" << serials[i] << "\",commander_core_frame_layout=\"trimmed\"} "
+            << (stats[i].frame_layout == CC_FRAME_LAYOUT_TRIMMED ? 1 : 0) << "\n";
+        out << "commander_core_frame_layout{serial=\"" << serials[i] << "\",commander_core_frame_layout=\"padded\"} "
+            << (stats[i].frame_layout == CC_FRAME_LAYOUT_PADDED ? 1 : 0) << "\n";
+    }
+
+    Family(out, "commander_core_color_frames", "counter", "", "Color frames sent, or skipped after a failed chunk.");
+    for(size_t i = 0; i < stats.size(); i++)
+    {
+        out << "commander_core_color_frames_total{serial=\"" << serials[i] << "\",result=\"sent\"} "    << stats[i].frames_sent    << "\n";
+        out << "commander_core_color_frames_total{serial=\"" << serials[i] << "\",result=\"skipped\"} " << stats[i].frames_skipped << "\n";
+    }
+
+    out << "# EOF\n";
+    return out.str();
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <atomic>
+#include <thread>
+
+class CorsairCapellixXTController;
+
+/*---------------------------------------------------------------------*\
+| OpenMetrics exporter (opt-in, Unix only). Serves the text exposition  |
+| format over plain HTTP on a Unix socket or a loopback TCP port, as    |
+| configured in CommanderCoreMetrics.conf next to the other settings:   |
+|   listen unix /run/user/1000/commander-core.sock                      |
+|   listen tcp 9464                                                     |
+| Without that file Start() does nothing. Every scrape is rendered from |
+| the controllers' cached GetStats() snapshots and never does HID I/O.  |
+|                                                                       |
+| Read-only: profiles switch over the control socket instead            |
+| (CorsairCapellixXTControl). Requests carrying an Origin header, and   |
+| TCP requests whose Host is not 127.0.0.1:<port> or localhost:<port>,  |
+| are refused, so a web page cannot read the exporter through the       |
+| browser.                                                              |
+\*---------------------------------------------------------------------*/
+
+#define CC_METRICS_POLL_MS          250
+#define CC_METRICS_REQUEST_MAX      4096
+#define CC_METRICS_READ_TIMEOUT_MS  1000
+
+class CorsairCapellixXTMetrics
+{
+public:
+    CorsairCapellixXTMetrics(const std::vector<CorsairCapellixXTController*>& controllers);
+    ~CorsairCapellixXTMetrics();
+
+    void                                        Start();
+    void                                        Stop();
+
+    std::string                                 Render();
+
+private:
+    std::vector<CorsairCapellixXTController*>   controllers;
+
+    std::thread*                                server_thread = nullptr;
+    std::atomic<bool>                           server_thread_run{false};
+    int                                         sock          = -1;
+    std::string                                 unix_path;      // empty: listening on TCP
+    int                                         tcp_port      = 0;
+
+    bool                                        OpenListener(const std::string& kind,
+                                                             const std::string& where);
+    void                                        ServerThread();
+    void                                        HandleClient(int client);
+};
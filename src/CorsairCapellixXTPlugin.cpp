@@ -1,6 +1,12 @@
 #include "CorsairCapellixXTPlugin.h"
 #include "CorsairCapellixXTDetect.h"
+#include "CorsairCapellixXTControl.h"
 #include "CorsairCapellixXTController.h"
+#include "CorsairCapellixXTFrameSync.h"
+#include "CorsairCapellixXTHotplug.h"
+#include "CorsairCapellixXTMetrics.h"
+#include "CorsairCapellixXTSettingsWatch.h"
+#include "CorsairCapellixXTWatchdog.h"
 
 #include <QWidget>
 #include <QVBoxLayout>
@@ -11,8 +17,12 @@
 #include <QFont>
 #include <QLineEdit>
 #include <QPushButton>
+#include <QSpinBox>
+#include <QComboBox>
 #include <QApplication>
 #include <QClipboard>
+#include <QTimer>
+#include <algorithm>
 #include <cstdlib>
 
 OpenRGBPluginInfo CorsairCapellixXTPlugin::GetPluginInfo()
@@ -52,12 +62,54 @@ void CorsairCapellixXTPlugin::Load(ResourceManagerInterface* rm)
     \*-------------------------------------------------------------*/
     std::vector<RGBController*> detected = DetectCorsairCapellixXT(&pump_controllers);
 
+    /*-------------------------------------------------------------*\
+    | With more than one device, finish their frames together so     |
+    | effects do not tear between them                               |
+    \*-------------------------------------------------------------*/
+    if(pump_controllers.size() > 1)
+    {
+        frame_sync = new CorsairCapellixXTFrameSync(pump_controllers);
+    }
+
     for(RGBController* ctrl : detected)
     {
         controllers.push_back(ctrl);
         resource_manager->RegisterRGBController(ctrl);
     }
 
+    /*-------------------------------------------------------------*\
+    | Watch for the cooler dropping off the bus and coming back so   |
+    | it is reopened without restarting OpenRGB                      |
+    \*-------------------------------------------------------------*/
+    hotplug = new CorsairCapellixXTHotplug(pump_controllers);
+    hotplug->Start();
+
+    /*-------------------------------------------------------------*\
+    | Optional OpenMetrics endpoint (CommanderCoreMetrics.conf)      |
+    \*-------------------------------------------------------------*/
+    metrics = new CorsairCapellixXTMetrics(pump_controllers);
+    metrics->Start();
+
+    /*-------------------------------------------------------------*\
+    | Owner-only socket for switching profiles from scripts          |
+    \*-------------------------------------------------------------*/
+    control = new CorsairCapellixXTControl(pump_controllers);
+    control->Start();
+
+    /*-------------------------------------------------------------*\
+    | Reload the settings files when they are edited outside the     |
+    | pane (mode file, profiles, curves, targets)                    |
+    \*-------------------------------------------------------------*/
+    settings_watch = new CorsairCapellixXTSettingsWatch(pump_controllers);
+    settings_watch->Start();
+
+    /*-------------------------------------------------------------*\
+    | Alarm if the cooling loop stops writing speeds or reading      |
+    | sensors (CommanderCoreWatchdog.conf)                           |
+    \*-------------------------------------------------------------*/
+    watchdog = new CorsairCapellixXTWatchdog(pump_controllers);
+    watchdog->Start();
+
     loaded = true;
 }
 
@@ -102,7 +154,8 @@ QWidget* CorsairCapellixXTPlugin::GetWidget()
         "fans together. Auto follows the liquid temperature; at idle it runs "
         "at the Silent floor and ramps up only under load. Silent, Quiet, "
         "Balanced and Performance hold "
-        "fixed speeds. Disabled stops managing them so they run on their own or "
+        "fixed speeds. Target RPM adjusts the pump and fans until they run at "
+        "the speeds set below. Disabled stops managing them so they run on their own or "
         "under another tool. Fans never drop below their stall floor. The "
         "selected mode is saved to the config file shown below, so other tools "
         "can read it and stay in sync.");
@@ -118,6 +171,7 @@ QWidget* CorsairCapellixXTPlugin::GetWidget()
         { "Quiet (~2150 rpm)",                                        PUMP_MODE_QUIET       },
         { "Balanced (~2500 rpm)",                                     PUMP_MODE_BALANCED    },
         { "Performance (~2800 rpm)",                                  PUMP_MODE_PERFORMANCE },
+        { "Target RPM (holds the speeds below)",                      PUMP_MODE_TARGET      },
     };
 
     int current = pump_controllers.empty()
@@ -133,6 +187,59 @@ QWidget* CorsairCapellixXTPlugin::GetWidget()
         layout->addWidget(rb);
     }
 
+    /*-----------------------------------------------------------------*\
+    | Profiles from CommanderCoreProfiles.conf, if there are any: mode, |
+    | speeds and colors switched together                               |
+    \*-----------------------------------------------------------------*/
+    std::vector<std::string> profileNames = pump_controllers[0]->GetProfileNames();
+
+    if(!profileNames.empty())
+    {
+        QHBoxLayout* profileRow   = new QHBoxLayout();
+        QComboBox*   profileCombo = new QComboBox();
+        QPushButton* profileBtn   = new QPushButton("Apply profile");
+        std::string  active       = pump_controllers[0]->GetActiveProfile();
+
+        for(const std::string& name : profileNames)
+        {
+            profileCombo->addItem(QString::fromStdString(name));
+        }
+        if(!active.empty())
+        {
+            profileCombo->setCurrentText(QString::fromStdString(active));
+        }
+
+        profileRow->addWidget(profileCombo, 1);
+        profileRow->addWidget(profileBtn);
+        layout->addLayout(profileRow);
+
+        QObject::connect(profileBtn, &QPushButton::clicked,
+            [this, profileCombo, group]()
+            {
+                std::string name = profileCombo->currentText().toStdString();
+
+                for(CorsairCapellixXTController* c : pump_controllers)
+                {
+                    c->ApplyProfile(name);
+                }
+
+                QAbstractButton* rb = group->button(pump_controllers[0]->GetPumpMode());
+                if(rb != nullptr)
+                {
+                    rb->setChecked(true);
+                }
+            });
+    }
+
+    /*-----------------------------------------------------------------*\
+    | Watchdog alarm: hidden while the cooling loop is within its SLOs  |
+    \*-----------------------------------------------------------------*/
+    QLabel* alarmLabel = new QLabel();
+    alarmLabel->setWordWrap(true);
+    alarmLabel->setStyleSheet("QLabel { color: #c0392b; font-weight: bold; }");
+    alarmLabel->hide();
+    layout->addWidget(alarmLabel);
+
     QObject::connect(group, &QButtonGroup::idClicked,
         [this](int mode)
         {
@@ -142,6 +249,128 @@ QWidget* CorsairCapellixXTPlugin::GetWidget()
             }
         });
 
+    /*-----------------------------------------------------------------*\
+    | Target RPM mode speeds, applied when editing finishes             |
+    \*-----------------------------------------------------------------*/
+    int pumpTarget = CC_TARGET_DEFAULT_PUMP_RPM;
+    int fanTarget  = CC_TARGET_DEFAULT_FAN_RPM;
+    pump_controllers[0]->GetSpeedTargets(pumpTarget, fanTarget);
+
+    QHBoxLayout* targetRow  = new QHBoxLayout();
+    QSpinBox*    pumpSpin   = new QSpinBox();
+    QSpinBox*    fanSpin    = new QSpinBox();
+    pumpSpin->setRange(0, CC_RPM_MAX);
+    pumpSpin->setSingleStep(50);
+    pumpSpin->setSuffix(" rpm");
+    pumpSpin->setValue(pumpTarget);
+    fanSpin->setRange(0, CC_RPM_MAX);
+    fanSpin->setSingleStep(50);
+    fanSpin->setSuffix(" rpm");
+    fanSpin->setValue(fanTarget);
+    targetRow->addWidget(new QLabel("Target pump"));
+    targetRow->addWidget(pumpSpin);
+    targetRow->addWidget(new QLabel("fans"));
+    targetRow->addWidget(fanSpin);
+    targetRow->addStretch();
+    layout->addLayout(targetRow);
+
+    auto applyTargets = [this, pumpSpin, fanSpin]()
+    {
+        for(CorsairCapellixXTController* c : pump_controllers)
+        {
+            c->SetSpeedTargets(pumpSpin->value(), fanSpin->value());
+        }
+    };
+    QObject::connect(pumpSpin, &QSpinBox::editingFinished, applyTargets);
+    QObject::connect(fanSpin,  &QSpinBox::editingFinished, applyTargets);
+
+    /*-----------------------------------------------------------------*\
+    | Calibration: measures what this pump and these fans actually do   |
+    | at each duty so the modes above hit their speeds on every unit.   |
+    | Runs in the background for a couple of minutes; the label polls   |
+    | the progress.                                                     |
+    \*-----------------------------------------------------------------*/
+    QHBoxLayout* calRow   = new QHBoxLayout();
+    QPushButton* calBtn   = new QPushButton("Calibrate speeds");
+    QLabel*      calLabel = new QLabel();
+    calRow->addWidget(calBtn);
+    calRow->addWidget(calLabel, 1);
+    layout->addLayout(calRow);
+
+    auto updateCalibration = [this, calBtn, calLabel]()
+    {
+        int  progress   = -1;
+        bool calibrated = true;
+
+        for(CorsairCapellixXTController* c : pump_controllers)
+        {
+            progress   = std::max(progress, c->GetCalibrationProgress());
+            calibrated = calibrated && c->IsCalibrated();
+        }
+
+        calBtn->setEnabled(progress < 0);
+
+        if(progress >= 0)
+        {
+            calLabel->setText(QString("Calibrating... %1%").arg(progress));
+        }
+        else
+        {
+            calLabel->setText(calibrated ? "Calibrated for this unit"
+                                         : "Not calibrated (using built-in duties)");
+        }
+    };
+
+    QObject::connect(calBtn, &QPushButton::clicked,
+        [this, updateCalibration]()
+        {
+            for(CorsairCapellixXTController* c : pump_controllers)
+            {
+                c->StartCalibration();
+            }
+            updateCalibration();
+        });
+
+    auto updateAlarm = [this, alarmLabel]()
+    {
+        QString text;
+
+        for(CorsairCapellixXTController* c : pump_controllers)
+        {
+            std::string reason = c->GetWatchdogAlarm();
+
+            if(!reason.empty())
+            {
+                text += QString("Cooling control stalled on %1: %2\n")
+                            .arg(QString::fromStdString(c->GetSerialString()), QString::fromStdString(reason));
+            }
+        }
+
+        alarmLabel->setText(text.trimmed());
+        alarmLabel->setVisible(!text.isEmpty());
+    };
+
+    /*-----------------------------------------------------------------*\
+    | The mode can change behind the pane (mode file, control socket)   |
+    \*-----------------------------------------------------------------*/
+    auto updateMode = [this, group]()
+    {
+        QAbstractButton* rb = group->button(pump_controllers[0]->GetPumpMode());
+
+        if(rb != nullptr && !rb->isChecked())
+        {
+            rb->setChecked(true);
+        }
+    };
+
+    QTimer* calTimer = new QTimer(widget);
+    QObject::connect(calTimer, &QTimer::timeout, updateCalibration);
+    QObject::connect(calTimer, &QTimer::timeout, updateAlarm);
+    QObject::connect(calTimer, &QTimer::timeout, updateMode);
+    calTimer->start(1000);
+    updateCalibration();
+    updateAlarm();
+
     /*-----------------------------------------------------------------*\
     | Config path: the selected mode is persisted here so other tools  |
     | read it and stay in sync. Shown + copyable in the pane so it is    |
@@ -180,10 +409,28 @@ QMenu* CorsairCapellixXTPlugin::GetTrayMenu()
 
 void CorsairCapellixXTPlugin::Unload()
 {
+    delete watchdog;
+    watchdog = nullptr;
+
+    delete settings_watch;
+    settings_watch = nullptr;
+
+    delete control;
+    control = nullptr;
+
+    delete metrics;
+    metrics = nullptr;
+
+    delete hotplug;
+    hotplug = nullptr;
+
     for(RGBController* ctrl : controllers)
     {
         resource_manager->UnregisterRGBController(ctrl);
     }
     controllers.clear();
+
+    delete frame_sync;
+    frame_sync = nullptr;
     loaded = false;
 }
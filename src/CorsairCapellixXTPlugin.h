@@ -7,7 +7,13 @@
 #include <vector>
 
 class RGBController;
+class CorsairCapellixXTControl;
 class CorsairCapellixXTController;
+class CorsairCapellixXTFrameSync;
+class CorsairCapellixXTHotplug;
+class CorsairCapellixXTMetrics;
+class CorsairCapellixXTSettingsWatch;
+class CorsairCapellixXTWatchdog;
 
 class CorsairCapellixXTPlugin : public QObject, public OpenRGBPluginInterface
 {
@@ -32,5 +38,11 @@ private:
     ResourceManagerInterface*                   resource_manager = nullptr;
     std::vector<RGBController*>                  controllers;
     std::vector<CorsairCapellixXTController*>    pump_controllers;
+    CorsairCapellixXTHotplug*                   hotplug          = nullptr;
+    CorsairCapellixXTMetrics*                   metrics          = nullptr;
+    CorsairCapellixXTControl*                   control          = nullptr;
+    CorsairCapellixXTSettingsWatch*             settings_watch   = nullptr;
+    CorsairCapellixXTWatchdog*                  watchdog         = nullptr;
+    CorsairCapellixXTFrameSync*                 frame_sync       = nullptr;
     bool                                        loaded           = false;
 };
@@ -0,0 +1,197 @@
+#pragma once
+
+#include "CorsairCapellixXTController.h"
+
+#include <algorithm>
+#include <cstring>
+
+/*---------------------------------------------------------------------*\
+| Per-PID protocol traits                                               |
+|                                                                       |
+| Each supported product ID gets a traits type fixing its report size,  |
+| speed channel count and capabilities at compile time. The packet and  |
+| speed encoders are templates instantiated once per variant, so their  |
+| sizes are constants and a speed encoder for a PID without a pump does |
+| not compile. The controller picks its variant's table once, in the    |
+| constructor, and calls through it from then on.                       |
+\*---------------------------------------------------------------------*/
+
+template<uint16_t PID, unsigned int READ_SIZE, unsigned int SPEED_CHANNELS, bool HAS_PUMP>
+struct CorsairCapellixXTTraitsBase
+{
+    static constexpr uint16_t       pid            = PID;
+    static constexpr unsigned int   read_size      = READ_SIZE;
+    static constexpr unsigned int   write_size     = READ_SIZE + 1;                  // + report ID
+    static constexpr unsigned int   max_payload    = write_size - CC_HEADER_SIZE - 2; // after a 2-byte command
+    static constexpr unsigned int   speed_channels = SPEED_CHANNELS;
+    static constexpr bool           has_pump       = HAS_PUMP;
+};
+
+template<uint16_t PID>
+struct CorsairCapellixXTTraits;
+
+//                                                                      PID                    report  speed  pump
+template<> struct CorsairCapellixXTTraits<COMMANDER_CORE_PID>    : CorsairCapellixXTTraitsBase<COMMANDER_CORE_PID,     96,    7,  true>  {};
+template<> struct CorsairCapellixXTTraits<COMMANDER_CORE2_PID>   : CorsairCapellixXTTraitsBase<COMMANDER_CORE2_PID,    64,    7,  true>  {};
+template<> struct CorsairCapellixXTTraits<COMMANDER_CORE_XT_PID> : CorsairCapellixXTTraitsBase<COMMANDER_CORE_XT_PID, 384,    6,  false> {};
+
+// Largest buffers any variant needs, for stack-resident packets
+static constexpr unsigned int CC_MAX_READ_SIZE      = CorsairCapellixXTTraits<COMMANDER_CORE_XT_PID>::read_size;
+static constexpr unsigned int CC_MAX_WRITE_SIZE     = CorsairCapellixXTTraits<COMMANDER_CORE_XT_PID>::write_size;
+static constexpr unsigned int CC_SPEED_ENTRY_SIZE   = 4;   // { channel, mode, duty, 0x00 }
+static constexpr unsigned int CC_MAX_SPEED_PAYLOAD  = 1 + CC_SPEED_ENTRY_SIZE * CorsairCapellixXTTraits<COMMANDER_CORE_PID>::speed_channels;
+
+static_assert(CorsairCapellixXTTraits<COMMANDER_CORE_PID>::read_size  <= CC_MAX_READ_SIZE, "CC_MAX_READ_SIZE too small");
+static_assert(CorsairCapellixXTTraits<COMMANDER_CORE2_PID>::read_size <= CC_MAX_READ_SIZE, "CC_MAX_READ_SIZE too small");
+static_assert(CorsairCapellixXTTraits<COMMANDER_CORE_PID>::max_payload  == 93,  "Commander Core chunk payload");
+static_assert(CorsairCapellixXTTraits<COMMANDER_CORE2_PID>::max_payload == 61,  "Commander Core 2 chunk payload");
+static_assert(CorsairCapellixXTTraits<COMMANDER_CORE_XT_PID>::max_payload == 381, "Commander Core XT chunk payload");
+
+// A wrapped speed write (size, padding, data type, speeds) fits one packet on every variant
+static_assert(CC_HEADER_WRITE_SIZE + 2 + CC_MAX_SPEED_PAYLOAD <= CorsairCapellixXTTraits<COMMANDER_CORE2_PID>::max_payload,
+              "speed write does not fit the smallest report");
+
+// Every write starts with the HID report ID and the fixed protocol byte
+static constexpr uint8_t CC_PACKET_HEADER[CC_HEADER_SIZE] = { 0x00, CC_PROTOCOL_HEADER };
+
+/*---------------------------------------------------------------------*\
+| Packet: header, command bytes, payload, zero padding to the variant's |
+| write size. out must hold T::write_size bytes. Payload that does not  |
+| fit is cut off; callers chunk at T::max_payload.                      |
+\*---------------------------------------------------------------------*/
+
+template<class T>
+unsigned int CCEncodePacket(uint8_t* out, const CCCommand& cmd, CCBytes payload)
+{
+    static_assert(CC_HEADER_SIZE + sizeof(CCCommand::bytes) < T::write_size, "report too small for a command");
+
+    size_t room = T::write_size - CC_HEADER_SIZE - cmd.length;
+
+    memset(out, 0, T::write_size);
+    memcpy(out, CC_PACKET_HEADER, CC_HEADER_SIZE);
+    memcpy(out + CC_HEADER_SIZE, cmd.bytes, cmd.length);
+
+    if(payload.size > 0)
+    {
+        memcpy(out + CC_HEADER_SIZE + cmd.length, payload.data, std::min(payload.size, room));
+    }
+
+    return T::write_size;
+}
+
+/*---------------------------------------------------------------------*\
+| Speed payloads (before the endpoint write wrapping):                  |
+|   [0]    = channel count                                              |
+|   [1..4] = { channel, mode (0 = percent), duty, 0x00 } per channel    |
+| Only variants with a pump have these; channel 0 is the pump.          |
+\*---------------------------------------------------------------------*/
+
+template<class T>
+unsigned int CCEncodeSpeeds(uint8_t* out, uint8_t pump_duty, uint8_t fan_duty)
+{
+    static_assert(T::has_pump, "speed layout assumes a pump on channel 0");
+    static_assert(1 + CC_SPEED_ENTRY_SIZE * T::speed_channels <= CC_MAX_SPEED_PAYLOAD, "speed payload too large");
+
+    out[0] = (uint8_t)T::speed_channels;
+
+    for(unsigned int ch = 0; ch < T::speed_channels; ch++)
+    {
+        uint8_t* entry = out + 1 + ch * CC_SPEED_ENTRY_SIZE;
+
+        entry[0] = (uint8_t)ch;
+        entry[1] = SPEED_MODE_PERCENT;
+        entry[2] = (ch == PUMP_CHANNEL) ? pump_duty : fan_duty;
+        entry[3] = 0x00;
+    }
+
+    return 1 + CC_SPEED_ENTRY_SIZE * T::speed_channels;
+}
+
+template<class T>
+unsigned int CCEncodePumpSpeed(uint8_t* out, uint8_t duty)
+{
+    static_assert(T::has_pump, "no pump channel on this PID");
+
+    out[0] = 0x01;
+    out[1] = (uint8_t)PUMP_CHANNEL;
+    out[2] = SPEED_MODE_PERCENT;
+    out[3] = duty;
+    out[4] = 0x00;
+
+    return 1 + CC_SPEED_ENTRY_SIZE;
+}
+
+/*---------------------------------------------------------------------*\
+| Runtime view of one variant. Speed encoders are nullptr for variants  |
+| without a pump; they are never instantiated for those.                |
+\*---------------------------------------------------------------------*/
+
+struct CorsairCapellixXTProtocol
+{
+    uint16_t        pid;
+    unsigned int    read_size;
+    unsigned int    write_size;
+    unsigned int    max_payload;
+    unsigned int    speed_channels;
+    bool            has_pump;
+
+    unsigned int  (*encode_packet)(uint8_t* out, const CCCommand& cmd, CCBytes payload);
+    unsigned int  (*encode_speeds)(uint8_t* out, uint8_t pump_duty, uint8_t fan_duty);
+    unsigned int  (*encode_pump_speed)(uint8_t* out, uint8_t duty);
+};
+
+template<class T, bool HAS_PUMP = T::has_pump>
+struct CorsairCapellixXTSpeedEncoders
+{
+    static constexpr unsigned int (*speeds)(uint8_t*, uint8_t, uint8_t) = &CCEncodeSpeeds<T>;
+    static constexpr unsigned int (*pump)(uint8_t*, uint8_t)            = &CCEncodePumpSpeed<T>;
+};
+
+template<class T>
+struct CorsairCapellixXTSpeedEncoders<T, false>
+{
+    static constexpr unsigned int (*speeds)(uint8_t*, uint8_t, uint8_t) = nullptr;
+    static constexpr unsigned int (*pump)(uint8_t*, uint8_t)            = nullptr;
+};
+
+template<class T>
+constexpr CorsairCapellixXTProtocol CCMakeProtocol()
+{
+    return
+    {
+        T::pid,
+        T::read_size,
+        T::write_size,
+        T::max_payload,
+        T::speed_channels,
+        T::has_pump,
+        &CCEncodePacket<T>,
+        CorsairCapellixXTSpeedEncoders<T>::speeds,
+        CorsairCapellixXTSpeedEncoders<T>::pump,
+    };
+}
+
+/*---------------------------------------------------------------------*\
+| Variant for a PID. Unknown PIDs get the original Commander Core       |
+| layout, as before the traits existed.                                 |
+\*---------------------------------------------------------------------*/
+
+inline const CorsairCapellixXTProtocol* CCProtocolForPID(uint16_t pid)
+{
+    static constexpr CorsairCapellixXTProtocol variants[] =
+    {
+        CCMakeProtocol<CorsairCapellixXTTraits<COMMANDER_CORE_PID>>(),
+        CCMakeProtocol<CorsairCapellixXTTraits<COMMANDER_CORE2_PID>>(),
+        CCMakeProtocol<CorsairCapellixXTTraits<COMMANDER_CORE_XT_PID>>(),
+    };
+
+    for(const CorsairCapellixXTProtocol& variant : variants)
+    {
+        if(variant.pid == pid)
+        {
+            return &variant;
+        }
+    }
+
+    return &variants[0];
+}
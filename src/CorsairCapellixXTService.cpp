@@ -0,0 +1,188 @@
+#include "CorsairCapellixXTService.h"
+#include "CorsairCapellixXTController.h"
+
+CorsairCapellixXTService* CorsairCapellixXTService::Get()
+{
+    static CorsairCapellixXTService service;
+    return &service;
+}
+
+CorsairCapellixXTService::~CorsairCapellixXTService()
+{
+    std::thread* t = nullptr;
+
+    {
+        std::lock_guard<std::mutex> lock(service_mutex);
+        service_run = false;
+        t           = service_thread;
+        service_thread = nullptr;
+    }
+
+    service_cv.notify_all();
+
+    if(t)
+    {
+        t->join();
+        delete t;
+    }
+}
+
+void CorsairCapellixXTService::Register(CorsairCapellixXTController* controller)
+{
+    std::lock_guard<std::mutex> lock(service_mutex);
+
+    for(const ServiceEntry& e : entries)
+    {
+        if(e.controller == controller)
+        {
+            return;
+        }
+    }
+
+    entries.push_back({controller, std::chrono::steady_clock::now()});
+
+    if(service_thread == nullptr)
+    {
+        service_run    = true;
+        service_thread = new std::thread(&CorsairCapellixXTService::ServiceThread, this);
+    }
+
+    service_cv.notify_all();
+}
+
+void CorsairCapellixXTService::Unregister(CorsairCapellixXTController* controller)
+{
+    std::thread* stop = nullptr;
+
+    {
+        std::unique_lock<std::mutex> lock(service_mutex);
+
+        for(size_t i = 0; i < entries.size(); i++)
+        {
+            if(entries[i].controller == controller)
+            {
+                entries.erase(entries.begin() + i);
+                break;
+            }
+        }
+
+        /*-------------------------------------------------------------*\
+        | Don't return while the service thread is still inside this    |
+        | controller's step — the caller is about to delete it          |
+        \*-------------------------------------------------------------*/
+        service_cv.wait(lock, [&]{ return active != controller; });
+
+        if(entries.empty() && service_thread != nullptr)
+        {
+            service_run    = false;
+            stop           = service_thread;
+            service_thread = nullptr;
+        }
+    }
+
+    service_cv.notify_all();
+
+    if(stop)
+    {
+        stop->join();
+        delete stop;
+    }
+}
+
+void CorsairCapellixXTService::Wake(CorsairCapellixXTController* controller)
+{
+    {
+        std::lock_guard<std::mutex> lock(service_mutex);
+
+        for(ServiceEntry& e : entries)
+        {
+            if(e.controller == controller)
+            {
+                e.next_due = std::chrono::steady_clock::now();
+            }
+        }
+    }
+
+    service_cv.notify_all();
+}
+
+bool CorsairCapellixXTService::IsPathOwned(const std::string& path, CorsairCapellixXTController* except)
+{
+    std::lock_guard<std::mutex> lock(service_mutex);
+
+    for(const ServiceEntry& e : entries)
+    {
+        if(e.controller != except && e.controller->IsConnected() && e.controller->GetDevicePath() == path)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void CorsairCapellixXTService::ServiceThread()
+{
+    std::unique_lock<std::mutex> lock(service_mutex);
+
+    while(service_run)
+    {
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+        /*-------------------------------------------------------------*\
+        | Round-robin from the cursor: take the first device that is    |
+        | due, so every due device gets a step before any gets a second |
+        \*-------------------------------------------------------------*/
+        size_t pick = entries.size();
+
+        for(size_t n = 0; n < entries.size(); n++)
+        {
+            size_t i = (cursor + n) % entries.size();
+
+            if(entries[i].next_due <= now)
+            {
+                pick = i;
+                break;
+            }
+        }
+
+        if(pick == entries.size())
+        {
+            std::chrono::steady_clock::time_point wake = now + std::chrono::seconds(1);
+
+            for(const ServiceEntry& e : entries)
+            {
+                if(e.next_due < wake)
+                {
+                    wake = e.next_due;
+                }
+            }
+
+            service_cv.wait_until(lock, wake);
+            continue;
+        }
+
+        CorsairCapellixXTController* c = entries[pick].controller;
+        cursor = (pick + 1) % entries.size();
+        active = c;
+
+        lock.unlock();
+        std::chrono::steady_clock::time_point next = c->ServiceStep(now);
+        lock.lock();
+
+        active = nullptr;
+
+        for(ServiceEntry& e : entries)
+        {
+            /*---------------------------------------------------------*\
+            | Keep an earlier due time if Wake() ran during the step    |
+            \*---------------------------------------------------------*/
+            if(e.controller == c && e.next_due <= now)
+            {
+                e.next_due = next;
+            }
+        }
+
+        service_cv.notify_all();
+    }
+}
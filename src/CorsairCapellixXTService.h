@@ -0,0 +1,63 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+class CorsairCapellixXTController;
+
+/*---------------------------------------------------------------------*\
+| Shared service thread. One thread drives keepalives, sensor polls,    |
+| speed writes and reconnects for every registered controller, so the  |
+| thread count stays at one no matter how many coolers are attached.   |
+|                                                                       |
+| Each controller is a small state machine: ServiceStep() does at most |
+| one unit of work (one endpoint read or write) and returns when it     |
+| next wants to run. Devices that are due are served round-robin, one   |
+| step each per pass, so a slow or failing device costs the others at  |
+| most one bounded command (CC_COMMAND_DEADLINE_MS) per pass.          |
+\*---------------------------------------------------------------------*/
+
+class CorsairCapellixXTService
+{
+public:
+    static CorsairCapellixXTService*            Get();
+
+    void                                        Register(CorsairCapellixXTController* controller);
+    void                                        Unregister(CorsairCapellixXTController* controller);
+
+    /*-----------------------------------------------------------------*\
+    | Run the given controller's next step as soon as possible          |
+    \*-----------------------------------------------------------------*/
+    void                                        Wake(CorsairCapellixXTController* controller);
+
+    /*-----------------------------------------------------------------*\
+    | A registered controller other than except is connected at path   |
+    \*-----------------------------------------------------------------*/
+    bool                                        IsPathOwned(const std::string& path,
+                                                            CorsairCapellixXTController* except);
+
+private:
+    CorsairCapellixXTService() = default;
+    ~CorsairCapellixXTService();
+
+    struct ServiceEntry
+    {
+        CorsairCapellixXTController*            controller;
+        std::chrono::steady_clock::time_point   next_due;
+    };
+
+    std::mutex                                  service_mutex;
+    std::condition_variable                     service_cv;
+    std::vector<ServiceEntry>                   entries;
+    size_t                                      cursor          = 0;
+    CorsairCapellixXTController*                active          = nullptr;
+
+    std::thread*                                service_thread  = nullptr;
+    bool                                        service_run     = false;
+
+    void                                        ServiceThread();
+};
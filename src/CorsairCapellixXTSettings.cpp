@@ -0,0 +1,63 @@
+#include "CorsairCapellixXTSettings.h"
+
+#include <cctype>
+#include <cstdlib>
+#include <sys/stat.h>
+
+std::string CCSettingsDir()
+{
+    const char* home = getenv("HOME");
+    if(home == nullptr)
+    {
+        return "";
+    }
+    return std::string(home) + "/.config/OpenRGB/plugins/settings/";
+}
+
+std::string CCSettingsPath(const std::string& file)
+{
+    std::string dir = CCSettingsDir();
+    if(dir.empty())
+    {
+        return "";
+    }
+    return dir + file;
+}
+
+std::string CCDeviceSettingsPath(const std::string& prefix, const std::string& serial)
+{
+    std::string clean;
+
+    for(char c : serial)
+    {
+        if(isalnum((unsigned char)c))
+        {
+            clean += c;
+        }
+    }
+
+    if(clean.empty())
+    {
+        return "";
+    }
+
+    return CCSettingsPath(prefix + clean + ".conf");
+}
+
+CCSettingsStamp CCSettingsFileStamp(const std::string& file)
+{
+    CCSettingsStamp stamp;
+    std::string     path = CCSettingsPath(file);
+    struct stat     st;
+
+    if(path.empty() || stat(path.c_str(), &st) != 0)
+    {
+        return stamp;
+    }
+
+    stamp.mtime_sec  = (long long)st.st_mtim.tv_sec;
+    stamp.mtime_nsec = (long)st.st_mtim.tv_nsec;
+    stamp.size       = (long long)st.st_size;
+    stamp.inode      = (unsigned long long)st.st_ino;
+    return stamp;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <string>
+
+/*---------------------------------------------------------------------*\
+| Settings file locations. Everything lives next to the pump mode file  |
+| in ~/.config/OpenRGB/plugins/settings/. Both helpers return an empty  |
+| string when HOME is not set, in which case nothing is persisted.      |
+\*---------------------------------------------------------------------*/
+
+#define CC_PUMP_MODE_FILE           "CommanderCorePump.conf"
+#define CC_CURVES_FILE              "CommanderCoreCurves.conf"
+#define CC_TARGETS_FILE             "CommanderCoreTargets.conf"
+#define CC_PROFILES_FILE            "CommanderCoreProfiles.conf"
+#define CC_TOPOLOGY_FILE_PREFIX     "CommanderCoreTopology-"
+#define CC_METRICS_FILE             "CommanderCoreMetrics.conf"
+#define CC_COLOR_FILE_PREFIX        "CommanderCoreColor-"
+#define CC_CALIBRATION_FILE_PREFIX  "CommanderCoreCalibration-"
+
+std::string CCSettingsDir();
+std::string CCSettingsPath(const std::string& file);
+
+// Per-device file: prefix + serial (non-alphanumerics dropped) + ".conf"
+std::string CCDeviceSettingsPath(const std::string& prefix, const std::string& serial);
+
+/*---------------------------------------------------------------------*\
+| Change stamp of a settings file, all zero when it does not exist.     |
+| The mtime is compared to the nanosecond, together with size and       |
+| inode, so a second write within the same second or a replace by       |
+| rename is still seen.                                                 |
+\*---------------------------------------------------------------------*/
+
+struct CCSettingsStamp
+{
+    long long               mtime_sec   = 0;
+    long                    mtime_nsec  = 0;
+    long long               size        = 0;
+    unsigned long long      inode       = 0;
+
+    bool operator==(const CCSettingsStamp& o) const
+    {
+        return mtime_sec == o.mtime_sec && mtime_nsec == o.mtime_nsec && size == o.size && inode == o.inode;
+    }
+    bool operator!=(const CCSettingsStamp& o) const { return !(*this == o); }
+};
+
+CCSettingsStamp CCSettingsFileStamp(const std::string& file);
@@ -0,0 +1,92 @@
+#include "CorsairCapellixXTSettingsWatch.h"
+#include "CorsairCapellixXTController.h"
+
+#include <chrono>
+
+static const char* const CC_WATCHED_FILES[] =
+{
+    CC_PUMP_MODE_FILE,
+    CC_CURVES_FILE,
+    CC_TARGETS_FILE,
+    CC_PROFILES_FILE,
+};
+
+CorsairCapellixXTSettingsWatch::CorsairCapellixXTSettingsWatch(const std::vector<CorsairCapellixXTController*>& ctrls)
+    : controllers(ctrls)
+{
+}
+
+CorsairCapellixXTSettingsWatch::~CorsairCapellixXTSettingsWatch()
+{
+    Stop();
+}
+
+void CorsairCapellixXTSettingsWatch::Start()
+{
+    if(watch_thread != nullptr || controllers.empty())
+    {
+        return;
+    }
+
+    stamps = ReadStamps();
+
+    watch_thread_run = true;
+    watch_thread     = new std::thread(&CorsairCapellixXTSettingsWatch::WatchThread, this);
+}
+
+void CorsairCapellixXTSettingsWatch::Stop()
+{
+    if(watch_thread)
+    {
+        watch_thread_run = false;
+        watch_thread->join();
+        delete watch_thread;
+        watch_thread = nullptr;
+    }
+}
+
+std::vector<CCSettingsStamp> CorsairCapellixXTSettingsWatch::ReadStamps()
+{
+    std::vector<CCSettingsStamp> now;
+
+    for(const char* file : CC_WATCHED_FILES)
+    {
+        now.push_back(CCSettingsFileStamp(file));
+    }
+
+    return now;
+}
+
+/*---------------------------------------------------------------------*\
+| One check: reload everything if any watched file changed since the    |
+| last one. Returns whether it did.                                     |
+\*---------------------------------------------------------------------*/
+
+bool CorsairCapellixXTSettingsWatch::Poll()
+{
+    std::vector<CCSettingsStamp> now = ReadStamps();
+
+    if(now == stamps)
+    {
+        return false;
+    }
+
+    stamps = now;
+
+    for(CorsairCapellixXTController* c : controllers)
+    {
+        c->ReloadSettings();
+    }
+
+    return true;
+}
+
+void CorsairCapellixXTSettingsWatch::WatchThread()
+{
+    while(watch_thread_run.load())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(CC_SETTINGS_WATCH_POLL_MS));
+
+        Poll();
+    }
+}
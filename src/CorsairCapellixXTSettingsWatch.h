@@ -0,0 +1,42 @@
+#pragma once
+
+#include "CorsairCapellixXTSettings.h"
+
+#include <vector>
+#include <atomic>
+#include <thread>
+
+class CorsairCapellixXTController;
+
+/*---------------------------------------------------------------------*\
+| Settings watch. Polls the mode, curves, targets and profiles files    |
+| every CC_SETTINGS_WATCH_POLL_MS and has every controller reload them  |
+| (ReloadSettings) when one changed, so an edit by hand, a companion    |
+| tool or a "profile <name>" line in the mode file takes effect in the  |
+| plugin and the daemon alike. Only the files are looked at here; the   |
+| device work is left to the service thread.                            |
+\*---------------------------------------------------------------------*/
+
+#define CC_SETTINGS_WATCH_POLL_MS   500
+
+class CorsairCapellixXTSettingsWatch
+{
+public:
+    CorsairCapellixXTSettingsWatch(const std::vector<CorsairCapellixXTController*>& controllers);
+    ~CorsairCapellixXTSettingsWatch();
+
+    void                                        Start();
+    void                                        Stop();
+
+    bool                                        Poll();
+
+private:
+    std::vector<CorsairCapellixXTController*>   controllers;
+    std::vector<CCSettingsStamp>                stamps;
+
+    std::thread*                                watch_thread = nullptr;
+    std::atomic<bool>                           watch_thread_run{false};
+
+    std::vector<CCSettingsStamp>                ReadStamps();
+    void                                        WatchThread();
+};
@@ -0,0 +1,290 @@
+#include "CorsairCapellixXTTelemetry.h"
+#include "CorsairCapellixXTLog.h"
+#include "CorsairCapellixXTSettings.h"
+
+#include <cctype>
+#include <chrono>
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const size_t CC_TELEMETRY_SEGMENT_BYTES =
+    sizeof(CCTelemetryHeader) + (size_t)CC_TELEMETRY_SEGMENT_RECORDS * sizeof(CCTelemetryRecord);
+
+CCTelemetryWriter::CCTelemetryWriter()
+    : fd(-1)
+    , map(nullptr)
+    , map_size(0)
+    , segment(0)
+    , used(0)
+    , sequence(0)
+{
+}
+
+CCTelemetryWriter::~CCTelemetryWriter()
+{
+    Close();
+}
+
+bool CCTelemetryWriter::IsOpen() const
+{
+    return map != nullptr;
+}
+
+std::string CCTelemetryWriter::SegmentPath(unsigned int index) const
+{
+    return CCSettingsDir() + CC_TELEMETRY_DIR "/CommanderCore-" + clean_serial
+         + "." + std::to_string(index) + ".cctelem";
+}
+
+#ifndef _WIN32
+/*---------------------------------------------------------------------*\
+| Records in an existing segment: slots fill from the front, so the     |
+| first unused one (unix_ms == 0) is found by bisection. Returns 0 for  |
+| a missing or foreign file; last gets the newest record.               |
+\*---------------------------------------------------------------------*/
+
+static uint32_t SegmentUsed(const std::string& path, CCTelemetryRecord& last)
+{
+    int seg_fd = open(path.c_str(), O_RDONLY);
+
+    if(seg_fd < 0)
+    {
+        return 0;
+    }
+
+    CCTelemetryHeader header;
+    uint32_t          lo = 0;
+
+    if(pread(seg_fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header)
+    && memcmp(header.magic, CC_TELEMETRY_MAGIC, sizeof(header.magic)) == 0
+    && header.version     == CC_TELEMETRY_VERSION
+    && header.header_size == sizeof(CCTelemetryHeader)
+    && header.record_size == sizeof(CCTelemetryRecord)
+    && header.capacity    == CC_TELEMETRY_SEGMENT_RECORDS)
+    {
+        uint32_t hi = header.capacity;
+
+        while(lo < hi)
+        {
+            uint32_t          mid = lo + (hi - lo) / 2;
+            CCTelemetryRecord record;
+            off_t             pos = (off_t)(sizeof(header) + (size_t)mid * sizeof(record));
+
+            if(pread(seg_fd, &record, sizeof(record), pos) == (ssize_t)sizeof(record) && record.unix_ms != 0)
+            {
+                lo = mid + 1;
+            }
+            else
+            {
+                hi = mid;
+            }
+        }
+
+        if(lo > 0)
+        {
+            off_t pos = (off_t)(sizeof(header) + (size_t)(lo - 1) * sizeof(last));
+
+            if(pread(seg_fd, &last, sizeof(last), pos) != (ssize_t)sizeof(last))
+            {
+                lo = 0;
+            }
+        }
+    }
+
+    close(seg_fd);
+    return lo;
+}
+#endif
+
+bool CCTelemetryWriter::Open(const std::string& device_serial)
+{
+#ifdef _WIN32
+    (void)device_serial;
+    return false;
+#else
+    Close();
+
+    serial   = device_serial;
+    sequence = 0;
+    clean_serial.clear();
+
+    for(char c : serial)
+    {
+        if(isalnum((unsigned char)c))
+        {
+            clean_serial += c;
+        }
+    }
+
+    if(clean_serial.empty() || CCSettingsDir().empty())
+    {
+        return false;
+    }
+
+    mkdir((CCSettingsDir() + CC_TELEMETRY_DIR).c_str(), 0755);
+
+    /*-----------------------------------------------------------------*\
+    | Continue in the segment holding the newest record. Records that   |
+    | share a millisecond (a segment change right before a restart) are |
+    | ordered by sequence.                                              |
+    \*-----------------------------------------------------------------*/
+    unsigned int newest      = 0;
+    uint32_t     newest_used = 0;
+    uint64_t     newest_ms   = 0;
+    uint32_t     newest_seq  = 0;
+
+    for(unsigned int index = 0; index < CC_TELEMETRY_SEGMENTS; index++)
+    {
+        CCTelemetryRecord last;
+        uint32_t          count = SegmentUsed(SegmentPath(index), last);
+
+        if(count > 0 && (last.unix_ms > newest_ms
+                      || (last.unix_ms == newest_ms && last.sequence >= newest_seq)))
+        {
+            newest      = index;
+            newest_used = count;
+            newest_ms   = last.unix_ms;
+            newest_seq  = last.sequence;
+            sequence    = last.sequence + 1;
+        }
+    }
+
+    if(newest_used == 0)
+    {
+        return MapSegment(0, true);
+    }
+
+    if(newest_used >= CC_TELEMETRY_SEGMENT_RECORDS)
+    {
+        return MapSegment((newest + 1) % CC_TELEMETRY_SEGMENTS, true);
+    }
+
+    if(!MapSegment(newest, false))
+    {
+        return false;
+    }
+
+    used = newest_used;
+    return true;
+#endif
+}
+
+/*---------------------------------------------------------------------*\
+| Map a segment at its full size. reset starts it over: the file is    |
+| cut to nothing and regrown, so every slot reads as unused, and the    |
+| blocks are allocated up front so a full disk fails here instead of    |
+| with SIGBUS on a later store into the mapping.                        |
+\*---------------------------------------------------------------------*/
+
+bool CCTelemetryWriter::MapSegment(unsigned int index, bool reset)
+{
+#ifdef _WIN32
+    (void)index; (void)reset;
+    return false;
+#else
+    Unmap();
+
+    std::string path = SegmentPath(index);
+
+    fd = open(path.c_str(), O_RDWR | O_CREAT | (reset ? O_TRUNC : 0), 0644);
+
+    if(fd < 0)
+    {
+        CCLog(CC_LOG_ERROR, "cannot open telemetry segment %s", path.c_str());
+        return false;
+    }
+
+#ifdef __linux__
+    bool sized = posix_fallocate(fd, 0, (off_t)CC_TELEMETRY_SEGMENT_BYTES) == 0;
+#else
+    bool sized = ftruncate(fd, (off_t)CC_TELEMETRY_SEGMENT_BYTES) == 0;
+#endif
+
+    void* new_map = sized ? mmap(nullptr, CC_TELEMETRY_SEGMENT_BYTES, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+                          : MAP_FAILED;
+
+    if(new_map == MAP_FAILED)
+    {
+        CCLog(CC_LOG_ERROR, "cannot map telemetry segment %s, history stopped", path.c_str());
+        close(fd);
+        fd = -1;
+        return false;
+    }
+
+    map      = (uint8_t*)new_map;
+    map_size = CC_TELEMETRY_SEGMENT_BYTES;
+    segment  = index;
+    used     = 0;
+
+    if(reset)
+    {
+        CCTelemetryHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, CC_TELEMETRY_MAGIC, sizeof(header.magic));
+        header.version     = CC_TELEMETRY_VERSION;
+        header.header_size = sizeof(CCTelemetryHeader);
+        header.record_size = sizeof(CCTelemetryRecord);
+        header.capacity    = CC_TELEMETRY_SEGMENT_RECORDS;
+        strncpy(header.serial, serial.c_str(), sizeof(header.serial) - 1);
+
+        memcpy(map, &header, sizeof(header));
+    }
+
+    return true;
+#endif
+}
+
+void CCTelemetryWriter::Append(CCTelemetryRecord& record)
+{
+    if(map == nullptr)
+    {
+        return;
+    }
+
+    /*-----------------------------------------------------------------*\
+    | Segment full: move on, overwriting the oldest                     |
+    \*-----------------------------------------------------------------*/
+    if(used >= CC_TELEMETRY_SEGMENT_RECORDS
+    && !MapSegment((segment + 1) % CC_TELEMETRY_SEGMENTS, true))
+    {
+        return;
+    }
+
+    record.unix_ms  = (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+                          std::chrono::system_clock::now().time_since_epoch()).count();
+    record.sequence = sequence++;
+
+    memcpy(map + sizeof(CCTelemetryHeader) + (size_t)used * sizeof(CCTelemetryRecord),
+           &record, sizeof(record));
+    used++;
+}
+
+void CCTelemetryWriter::Unmap()
+{
+#ifndef _WIN32
+    if(map)
+    {
+        munmap(map, map_size);
+        map      = nullptr;
+        map_size = 0;
+    }
+
+    if(fd >= 0)
+    {
+        close(fd);
+        fd = -1;
+    }
+#endif
+}
+
+void CCTelemetryWriter::Close()
+{
+    Unmap();
+    used = 0;
+}
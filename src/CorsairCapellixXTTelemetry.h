@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/*---------------------------------------------------------------------*\
+| Telemetry history                                                     |
+|                                                                       |
+| Every cooling tick appends one fixed-size record per device to a      |
+| ring of memory-mapped segment files in                                |
+|   <settings dir>/telemetry/CommanderCore-<serial>.<n>.cctelem         |
+| n = 0 .. CC_TELEMETRY_SEGMENTS - 1. A segment is created at its full  |
+| size, so appending is a memcpy into the mapping; only moving on to   |
+| the next segment (once a day at the default tick rate) makes system   |
+| calls. The oldest segment is overwritten when the ring wraps.         |
+|                                                                       |
+| Segment layout (host byte order):                                     |
+|   CCTelemetryHeader                                                   |
+|   CCTelemetryRecord[capacity], unused records all zero                |
+|                                                                       |
+| tools/cc_telemetry.py exports a time range from all segments as CSV.  |
+\*---------------------------------------------------------------------*/
+
+#define CC_TELEMETRY_DIR            "telemetry"
+#define CC_TELEMETRY_MAGIC          "CCTELEM1"
+#define CC_TELEMETRY_VERSION        1
+#define CC_TELEMETRY_SEGMENTS       7       // ring of segment files per device
+#define CC_TELEMETRY_SEGMENT_RECORDS 28800  // one day at PUMP_UPDATE_INTERVAL_SEC = 3
+#define CC_TELEMETRY_CHANNELS       7
+
+#define CC_TELEMETRY_NO_TEMP        INT16_MIN
+#define CC_TELEMETRY_NO_RPM         0xFFFF
+
+// Record flags
+#define CC_TELEMETRY_TEMP_INVALID   0x01    // no plausible liquid reading this tick
+#define CC_TELEMETRY_SPEED_FAILED   0x02    // speed read failed
+#define CC_TELEMETRY_WRITE_FAILED   0x04    // speed write failed
+#define CC_TELEMETRY_BREAKER_OPEN   0x08    // circuit breaker holding back I/O
+#define CC_TELEMETRY_REJECTED       0x10    // readings rejected since the last record
+
+#pragma pack(push, 1)
+struct CCTelemetryHeader
+{
+    char            magic[8];               // CC_TELEMETRY_MAGIC, not terminated
+    uint32_t        version;
+    uint16_t        header_size;            // sizeof(CCTelemetryHeader)
+    uint16_t        record_size;            // sizeof(CCTelemetryRecord)
+    uint32_t        capacity;               // records in this segment
+    uint32_t        reserved;
+    char            serial[32];
+};
+
+struct CCTelemetryRecord
+{
+    uint64_t        unix_ms;                // wall clock; 0 = unused slot
+    uint32_t        sequence;               // per device, continues across segments
+    int16_t         liquid_decidegrees;     // 0.1 C, CC_TELEMETRY_NO_TEMP if unknown
+    uint8_t         mode;                   // CorsairPumpMode
+    uint8_t         flags;                  // CC_TELEMETRY_*
+    uint8_t         duty[CC_TELEMETRY_CHANNELS];
+    uint8_t         channel_count;
+    uint16_t        rpm[CC_TELEMETRY_CHANNELS]; // CC_TELEMETRY_NO_RPM if unknown
+    uint16_t        reserved;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(CCTelemetryHeader) == 56, "telemetry header layout");
+static_assert(sizeof(CCTelemetryRecord) == 40, "telemetry record layout");
+
+class CCTelemetryWriter
+{
+public:
+    CCTelemetryWriter();
+    ~CCTelemetryWriter();
+
+    /*-----------------------------------------------------------------*\
+    | Find the newest segment for serial and continue after its last    |
+    | record (or start the next one when it is full)                    |
+    \*-----------------------------------------------------------------*/
+    bool                        Open(const std::string& serial);
+    void                        Close();
+    bool                        IsOpen() const;
+
+    /*-----------------------------------------------------------------*\
+    | Fills in unix_ms and sequence. Single writer (the service thread). |
+    \*-----------------------------------------------------------------*/
+    void                        Append(CCTelemetryRecord& record);
+
+private:
+    std::string                 serial;
+    std::string                 clean_serial;
+    int                         fd;
+    uint8_t*                    map;
+    size_t                      map_size;
+    unsigned int                segment;
+    uint32_t                    used;
+    uint32_t                    sequence;
+
+    std::string                 SegmentPath(unsigned int index) const;
+    bool                        MapSegment(unsigned int index, bool reset);
+    void                        Unmap();
+};
@@ -0,0 +1,582 @@
+#include "CorsairCapellixXTTrace.h"
+#include "CorsairCapellixXTLog.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cctype>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <thread>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+/*---------------------------------------------------------------------*\
+| Kernel thread id on Linux so records line up with perf / strace;      |
+| a hash of std::thread::id elsewhere                                   |
+\*---------------------------------------------------------------------*/
+
+static uint32_t TraceThreadId()
+{
+#ifdef __linux__
+    return (uint32_t)syscall(SYS_gettid);
+#else
+    return (uint32_t)std::hash<std::thread::id>()(std::this_thread::get_id());
+#endif
+}
+
+static size_t TrimmedLength(const uint8_t* data, size_t length)
+{
+    while(length > 0 && data[length - 1] == 0x00)
+    {
+        length--;
+    }
+
+    return length;
+}
+
+/*---------------------------------------------------------------------*\
+| CCTraceWriter                                                         |
+\*---------------------------------------------------------------------*/
+
+CCTraceWriter::CCTraceWriter()
+    : fd(-1)
+    , map(nullptr)
+    , map_size(0)
+    , used(0)
+    , start_ns(0)
+{
+}
+
+CCTraceWriter::~CCTraceWriter()
+{
+    Close();
+}
+
+uint64_t CCTraceWriter::Now()
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count() - start_ns;
+}
+
+bool CCTraceWriter::Open(const std::string& path, uint16_t pid,
+                         const std::string& serial, const std::string& product)
+{
+#ifdef _WIN32
+    (void)path; (void)pid; (void)serial; (void)product;
+    CCLog(CC_LOG_WARN, "HID trace recording is not supported on this platform");
+    return false;
+#else
+    std::lock_guard<std::mutex> lock(mutex);
+
+    fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+
+    if(fd < 0)
+    {
+        CCLog(CC_LOG_ERROR, "cannot create trace %s", path.c_str());
+        return false;
+    }
+
+    if(!Reserve(sizeof(CCTraceHeader)))
+    {
+        CCLog(CC_LOG_ERROR, "cannot allocate trace %s, not recording", path.c_str());
+        close(fd);
+        fd = -1;
+        return false;
+    }
+
+    CCTraceHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CC_TRACE_MAGIC, sizeof(header.magic));
+    header.version       = CC_TRACE_VERSION;
+    header.product_id    = pid;
+    header.header_size   = sizeof(CCTraceHeader);
+    strncpy(header.serial,  serial.c_str(),  sizeof(header.serial)  - 1);
+    strncpy(header.product, product.c_str(), sizeof(header.product) - 1);
+    header.start_unix_ns = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                               std::chrono::system_clock::now().time_since_epoch()).count();
+
+    memcpy(map, &header, sizeof(header));
+    used = sizeof(header);
+
+    start_ns = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch()).count();
+
+    CCLog(CC_LOG_INFO, "recording HID trace to %s", path.c_str());
+    return true;
+#endif
+}
+
+/*---------------------------------------------------------------------*\
+| Make room for bytes more at the end of the mapping. Called with the   |
+| mutex held. Remaps rather than mremap()s to stay portable to macOS.   |
+| The new blocks are allocated before they are mapped: a store into a   |
+| sparse hole on a full disk would be a SIGBUS, not an error here.      |
+\*---------------------------------------------------------------------*/
+
+bool CCTraceWriter::Reserve(size_t bytes)
+{
+#ifdef _WIN32
+    (void)bytes;
+    return false;
+#else
+    if(used + bytes <= map_size)
+    {
+        return true;
+    }
+
+    size_t new_size = std::max(map_size * 2, (size_t)CC_TRACE_GROW_BYTES);
+
+    while(new_size < used + bytes)
+    {
+        new_size *= 2;
+    }
+
+#ifdef __linux__
+    bool sized = posix_fallocate(fd, (off_t)map_size, (off_t)(new_size - map_size)) == 0;
+#else
+    bool sized = ftruncate(fd, (off_t)new_size) == 0;
+#endif
+
+    if(!sized)
+    {
+        return false;
+    }
+
+    void* new_map = mmap(nullptr, new_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    if(new_map == MAP_FAILED)
+    {
+        return false;
+    }
+
+    if(map)
+    {
+        munmap(map, map_size);
+    }
+
+    map      = (uint8_t*)new_map;
+    map_size = new_size;
+    return true;
+#endif
+}
+
+void CCTraceWriter::Append(uint8_t direction, uint64_t record_start_ns, uint64_t duration_ns,
+                           int result, int timeout_ms,
+                           const uint8_t* data, size_t length)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if(fd < 0)
+    {
+        return;
+    }
+
+    length = std::min(TrimmedLength(data, length), (size_t)UINT16_MAX);
+
+    if(!Reserve(sizeof(CCTraceRecord) + length))
+    {
+        /*-------------------------------------------------------------*\
+        | Disk full or similar: stop recording, keep what we have       |
+        \*-------------------------------------------------------------*/
+        CCLog(CC_LOG_ERROR, "trace file cannot grow, recording stopped");
+
+        CloseLocked();
+        return;
+    }
+
+    CCTraceRecord record;
+    record.start_ns    = record_start_ns;
+    record.duration_ns = (uint32_t)std::min(duration_ns, (uint64_t)UINT32_MAX);
+    record.thread_id   = TraceThreadId();
+    record.result      = result;
+    record.timeout_ms  = timeout_ms;
+    record.length      = (uint16_t)length;
+    record.direction   = direction;
+    record.reserved    = 0;
+
+    memcpy(map + used, &record, sizeof(record));
+    used += sizeof(record);
+
+    if(length > 0)
+    {
+        memcpy(map + used, data, length);
+        used += length;
+    }
+}
+
+void CCTraceWriter::Close()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    CloseLocked();
+}
+
+void CCTraceWriter::CloseLocked()
+{
+#ifndef _WIN32
+    if(fd < 0)
+    {
+        return;
+    }
+
+    if(map)
+    {
+        munmap(map, map_size);
+        map      = nullptr;
+        map_size = 0;
+    }
+
+    if(ftruncate(fd, (off_t)used) != 0)
+    {
+        CCLog(CC_LOG_WARN, "could not trim trace file");
+    }
+
+    close(fd);
+    fd = -1;
+#endif
+}
+
+/*---------------------------------------------------------------------*\
+| CCTraceRecordingTransport                                             |
+\*---------------------------------------------------------------------*/
+
+CCTraceRecordingTransport::CCTraceRecordingTransport(CorsairCapellixXTTransport* inner, CCTraceWriter* writer)
+    : inner(inner)
+    , writer(writer)
+{
+}
+
+CCTraceRecordingTransport::~CCTraceRecordingTransport()
+{
+    delete inner;
+    delete writer;
+}
+
+int CCTraceRecordingTransport::Write(const uint8_t* data, size_t length)
+{
+    uint64_t start  = writer->Now();
+    int      result = inner->Write(data, length);
+    uint64_t end    = writer->Now();
+
+    writer->Append(CC_TRACE_DIR_WRITE, start, end - start, result, 0, data, length);
+    return result;
+}
+
+int CCTraceRecordingTransport::Read(uint8_t* data, size_t length, int timeout_ms)
+{
+    uint64_t start  = writer->Now();
+    int      result = inner->Read(data, length, timeout_ms);
+    uint64_t end    = writer->Now();
+
+    writer->Append(CC_TRACE_DIR_READ, start, end - start, result, timeout_ms,
+                   data, result > 0 ? (size_t)result : 0);
+    return result;
+}
+
+std::string CCTraceRecordingTransport::GetSerialString()
+{
+    return inner->GetSerialString();
+}
+
+std::string CCTraceRecordingTransport::GetProductString()
+{
+    return inner->GetProductString();
+}
+
+/*---------------------------------------------------------------------*\
+| CCTraceReplay                                                         |
+|                                                                       |
+| Records are served strictly in order. A Write() consumes the next     |
+| recorded write (skipping recorded reads the controller did not make,  |
+| e.g. a drain that found a different number of stale replies) and      |
+| counts a mismatch when the payload differs. A Read() consumes the     |
+| next recorded read; if the next record is a write instead, the        |
+| device had nothing to say at that point and Read() times out.         |
+| Running off the end of the trace fails like an unplugged device.      |
+\*---------------------------------------------------------------------*/
+
+CCTraceReplay::CCTraceReplay()
+    : cursor(0)
+    , realtime(false)
+{
+    memset(&header, 0, sizeof(header));
+    memset(&stats,  0, sizeof(stats));
+}
+
+bool CCTraceReplay::Load(const std::string& path)
+{
+    FILE* f = fopen(path.c_str(), "rb");
+
+    if(!f)
+    {
+        CCLog(CC_LOG_ERROR, "cannot open trace %s", path.c_str());
+        return false;
+    }
+
+    uint8_t chunk[65536];
+    size_t  n;
+
+    while((n = fread(chunk, 1, sizeof(chunk), f)) > 0)
+    {
+        data.insert(data.end(), chunk, chunk + n);
+    }
+
+    fclose(f);
+
+    if(data.size() < sizeof(CCTraceHeader))
+    {
+        CCLog(CC_LOG_ERROR, "%s is not a trace", path.c_str());
+        return false;
+    }
+
+    memcpy(&header, data.data(), sizeof(header));
+
+    if(memcmp(header.magic, CC_TRACE_MAGIC, sizeof(header.magic)) != 0
+    || header.version != CC_TRACE_VERSION)
+    {
+        CCLog(CC_LOG_ERROR, "%s is not a version %d trace", path.c_str(), CC_TRACE_VERSION);
+        return false;
+    }
+
+    size_t offset = header.header_size;
+
+    while(offset + sizeof(CCTraceRecord) <= data.size())
+    {
+        Entry entry;
+        memcpy(&entry.record, &data[offset], sizeof(CCTraceRecord));
+
+        if(entry.record.direction != CC_TRACE_DIR_WRITE
+        && entry.record.direction != CC_TRACE_DIR_READ)
+        {
+            break;
+        }
+
+        entry.offset = offset + sizeof(CCTraceRecord);
+
+        if(entry.offset + entry.record.length > data.size())
+        {
+            break;
+        }
+
+        entries.push_back(entry);
+        offset = entry.offset + entry.record.length;
+    }
+
+    return true;
+}
+
+void CCTraceReplay::SetRealtime(bool value)
+{
+    realtime = value;
+}
+
+int CCTraceReplay::Write(const uint8_t* buf, size_t length)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    while(cursor < entries.size() && entries[cursor].record.direction != CC_TRACE_DIR_WRITE)
+    {
+        stats.skipped_reads++;
+        cursor++;
+    }
+
+    if(cursor >= entries.size())
+    {
+        return -1;
+    }
+
+    const Entry& entry = entries[cursor++];
+    size_t       len   = TrimmedLength(buf, length);
+
+    if(len != entry.record.length
+    || memcmp(buf, &data[entry.offset], len) != 0)
+    {
+        if(stats.mismatches++ < 8)
+        {
+            CCLog(CC_LOG_WARN, "replay: write %u differs from the trace (command %02X)",
+                  stats.writes, length > 2 ? buf[2] : 0);
+        }
+    }
+
+    stats.writes++;
+    return entry.record.result;
+}
+
+int CCTraceReplay::Read(uint8_t* buf, size_t length, int timeout_ms)
+{
+    CCTraceRecord record;
+    size_t        offset;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if(cursor >= entries.size())
+        {
+            return -1;
+        }
+
+        if(entries[cursor].record.direction != CC_TRACE_DIR_READ)
+        {
+            stats.empty_reads++;
+            return 0;
+        }
+
+        record = entries[cursor].record;
+        offset = entries[cursor].offset;
+        cursor++;
+        stats.reads++;
+    }
+
+    if(realtime)
+    {
+        std::this_thread::sleep_for(std::chrono::nanoseconds(
+            std::min<uint64_t>(record.duration_ns, (uint64_t)std::max(timeout_ms, 0) * 1000000)));
+    }
+
+    if(record.result <= 0)
+    {
+        return record.result;
+    }
+
+    size_t out = std::min((size_t)record.result, length);
+
+    memset(buf, 0, out);
+    memcpy(buf, &data[offset], std::min((size_t)record.length, out));
+    return (int)out;
+}
+
+bool CCTraceReplay::Finished()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return cursor >= entries.size();
+}
+
+CCTraceReplayStats CCTraceReplay::GetStats()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+uint16_t CCTraceReplay::GetProductID()
+{
+    return header.product_id;
+}
+
+std::string CCTraceReplay::GetSerialString()
+{
+    return std::string(header.serial, strnlen(header.serial, sizeof(header.serial)));
+}
+
+std::string CCTraceReplay::GetProductString()
+{
+    return std::string(header.product, strnlen(header.product, sizeof(header.product)));
+}
+
+/*---------------------------------------------------------------------*\
+| CCTraceReplayTransport                                                |
+\*---------------------------------------------------------------------*/
+
+CCTraceReplayTransport::CCTraceReplayTransport(CCTraceReplay* replay)
+    : replay(replay)
+{
+}
+
+int CCTraceReplayTransport::Write(const uint8_t* data, size_t length)
+{
+    return replay->Write(data, length);
+}
+
+int CCTraceReplayTransport::Read(uint8_t* data, size_t length, int timeout_ms)
+{
+    return replay->Read(data, length, timeout_ms);
+}
+
+std::string CCTraceReplayTransport::GetSerialString()
+{
+    return replay->GetSerialString();
+}
+
+std::string CCTraceReplayTransport::GetProductString()
+{
+    return replay->GetProductString();
+}
+
+bool CCTraceReplayTransport::CanReconnect()
+{
+    return false;
+}
+
+/*---------------------------------------------------------------------*\
+| CCTraceWrapTransport                                                  |
+\*---------------------------------------------------------------------*/
+
+CorsairCapellixXTTransport* CCTraceWrapTransport(CorsairCapellixXTTransport* transport, uint16_t pid)
+{
+    const char* dir = getenv(CC_TRACE_ENV);
+
+    if(dir == nullptr || dir[0] == '\0')
+    {
+        return transport;
+    }
+
+    std::string serial = transport->GetSerialString();
+    std::string name;
+
+    for(char c : serial)
+    {
+        if(isalnum((unsigned char)c))
+        {
+            name += c;
+        }
+    }
+
+    char      stamp[32];
+    time_t    now = time(nullptr);
+    struct tm tm_now;
+#ifdef _WIN32
+    localtime_s(&tm_now, &now);
+#else
+    localtime_r(&now, &tm_now);
+#endif
+    strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &tm_now);
+
+    /*-----------------------------------------------------------------*\
+    | A reconnect within the same second gets its own file              |
+    \*-----------------------------------------------------------------*/
+    std::string base = std::string(dir) + "/CommanderCore-" + name + "-" + stamp;
+    std::string path = base + ".cctrace";
+
+    for(int n = 2; n < 100; n++)
+    {
+        FILE* existing = fopen(path.c_str(), "rb");
+
+        if(existing == nullptr)
+        {
+            break;
+        }
+
+        fclose(existing);
+        path = base + "-" + std::to_string(n) + ".cctrace";
+    }
+
+    CCTraceWriter* writer = new CCTraceWriter();
+
+    if(!writer->Open(path, pid, serial, transport->GetProductString()))
+    {
+        delete writer;
+        return transport;
+    }
+
+    return new CCTraceRecordingTransport(transport, writer);
+}
@@ -0,0 +1,196 @@
+#pragma once
+
+#include "CorsairCapellixXTTransport.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*---------------------------------------------------------------------*\
+| HID traffic traces                                                    |
+|                                                                       |
+| With CC_TRACE_RECORD=<directory> in the environment every report      |
+| written to and read from the device is appended to                    |
+|   <directory>/CommanderCore-<serial>-<YYYYmmdd-HHMMSS>.cctrace        |
+| through a memory map. A new file is started each time the device is   |
+| opened (startup and every reconnect).                                 |
+|                                                                       |
+| File layout (host byte order):                                        |
+|   CCTraceHeader                                                       |
+|   CCTraceRecord + payload, repeated                                   |
+|                                                                       |
+| Payloads are stored with trailing zero bytes trimmed; the replayer    |
+| pads them back out to the recorded result length. The file is grown   |
+| in CC_TRACE_GROW_BYTES steps and cut to size on close, so a trace     |
+| from a crashed process ends in zeros — a record with direction 0 is   |
+| the end of the trace.                                                 |
+|                                                                       |
+| tools/cc_trace.py summarizes a trace (latency distribution per        |
+| command, timeouts, stale replies); commander-core-daemon --replay     |
+| feeds one back to the controller.                                     |
+\*---------------------------------------------------------------------*/
+
+#define CC_TRACE_ENV                "CC_TRACE_RECORD"
+#define CC_TRACE_MAGIC              "CCTRACE1"
+#define CC_TRACE_VERSION            1
+#define CC_TRACE_GROW_BYTES         (1024 * 1024)
+
+#define CC_TRACE_DIR_WRITE          1       // host -> device (Write)
+#define CC_TRACE_DIR_READ           2       // device -> host (Read)
+
+#pragma pack(push, 1)
+struct CCTraceHeader
+{
+    char            magic[8];               // CC_TRACE_MAGIC, not terminated
+    uint32_t        version;
+    uint16_t        product_id;
+    uint16_t        header_size;            // sizeof(CCTraceHeader)
+    char            serial[32];
+    char            product[32];
+    uint64_t        start_unix_ns;          // wall clock when the trace was opened
+};
+
+struct CCTraceRecord
+{
+    uint64_t        start_ns;               // steady clock, relative to the trace start
+    uint32_t        duration_ns;            // time spent inside the call (saturates)
+    uint32_t        thread_id;
+    int32_t         result;                 // Write/Read return value
+    int32_t         timeout_ms;             // Read only, 0 for Write
+    uint16_t        length;                 // payload bytes that follow
+    uint8_t         direction;              // CC_TRACE_DIR_*
+    uint8_t         reserved;
+};
+#pragma pack(pop)
+
+/*---------------------------------------------------------------------*\
+| Append-only trace file                                                |
+\*---------------------------------------------------------------------*/
+
+class CCTraceWriter
+{
+public:
+    CCTraceWriter();
+    ~CCTraceWriter();
+
+    bool                        Open(const std::string& path, uint16_t pid,
+                                     const std::string& serial, const std::string& product);
+    void                        Append(uint8_t direction, uint64_t start_ns, uint64_t duration_ns,
+                                       int result, int timeout_ms,
+                                       const uint8_t* data, size_t length);
+    void                        Close();
+
+    uint64_t                    Now();
+
+private:
+    bool                        Reserve(size_t bytes);
+    void                        CloseLocked();
+
+    std::mutex                  mutex;
+    int                         fd;
+    uint8_t*                    map;
+    size_t                      map_size;
+    size_t                      used;
+    uint64_t                    start_ns;
+};
+
+/*---------------------------------------------------------------------*\
+| Recorder: passes every call through to the wrapped transport and      |
+| appends it to the trace                                               |
+\*---------------------------------------------------------------------*/
+
+class CCTraceRecordingTransport : public CorsairCapellixXTTransport
+{
+public:
+    CCTraceRecordingTransport(CorsairCapellixXTTransport* inner, CCTraceWriter* writer);
+    ~CCTraceRecordingTransport();
+
+    int                         Write(const uint8_t* data, size_t length) override;
+    int                         Read(uint8_t* data, size_t length, int timeout_ms) override;
+
+    std::string                 GetSerialString() override;
+    std::string                 GetProductString() override;
+
+private:
+    CorsairCapellixXTTransport* inner;
+    CCTraceWriter*              writer;
+};
+
+/*---------------------------------------------------------------------*\
+| A loaded trace and the replay cursor. Owned by the caller so the      |
+| statistics outlive the transport, which the controller deletes when   |
+| the trace runs out (it looks like an unplug).                         |
+\*---------------------------------------------------------------------*/
+
+struct CCTraceReplayStats
+{
+    unsigned int    writes;                 // Write() calls served
+    unsigned int    reads;                  // Read() calls served from the trace
+    unsigned int    mismatches;             // writes whose payload differs from the trace
+    unsigned int    skipped_reads;          // recorded reads the controller never asked for
+    unsigned int    empty_reads;            // reads with no recorded reply at that point
+};
+
+class CCTraceReplay
+{
+public:
+    CCTraceReplay();
+
+    bool                        Load(const std::string& path);
+
+    /*-----------------------------------------------------------------*\
+    | Realtime: Read() sleeps for the recorded call duration, so timing  |
+    | bugs reproduce; otherwise replies are served immediately           |
+    \*-----------------------------------------------------------------*/
+    void                        SetRealtime(bool realtime);
+
+    int                         Write(const uint8_t* data, size_t length);
+    int                         Read(uint8_t* data, size_t length, int timeout_ms);
+
+    bool                        Finished();
+    CCTraceReplayStats          GetStats();
+
+    uint16_t                    GetProductID();
+    std::string                 GetSerialString();
+    std::string                 GetProductString();
+
+private:
+    struct Entry
+    {
+        CCTraceRecord           record;
+        size_t                  offset;     // payload offset in data
+    };
+
+    std::mutex                  mutex;
+    CCTraceHeader               header;
+    std::vector<uint8_t>        data;
+    std::vector<Entry>          entries;
+    size_t                      cursor;
+    bool                        realtime;
+    CCTraceReplayStats          stats;
+};
+
+class CCTraceReplayTransport : public CorsairCapellixXTTransport
+{
+public:
+    CCTraceReplayTransport(CCTraceReplay* replay);
+
+    int                         Write(const uint8_t* data, size_t length) override;
+    int                         Read(uint8_t* data, size_t length, int timeout_ms) override;
+
+    std::string                 GetSerialString() override;
+    std::string                 GetProductString() override;
+    bool                        CanReconnect() override;
+
+private:
+    CCTraceReplay*              replay;
+};
+
+/*---------------------------------------------------------------------*\
+| Wrap a freshly opened device transport in a recorder when             |
+| CC_TRACE_RECORD is set; returns it unchanged otherwise                |
+\*---------------------------------------------------------------------*/
+
+CorsairCapellixXTTransport* CCTraceWrapTransport(CorsairCapellixXTTransport* transport, uint16_t pid);
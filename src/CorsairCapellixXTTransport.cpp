@@ -0,0 +1,51 @@
+#include "CorsairCapellixXTTransport.h"
+
+CorsairCapellixXTHidapiTransport::CorsairCapellixXTHidapiTransport(hid_device* dev)
+    : dev(dev)
+{
+}
+
+CorsairCapellixXTHidapiTransport::~CorsairCapellixXTHidapiTransport()
+{
+    if(dev)
+    {
+        hid_close(dev);
+        dev = nullptr;
+    }
+}
+
+int CorsairCapellixXTHidapiTransport::Write(const uint8_t* data, size_t length)
+{
+    return hid_write(dev, data, length);
+}
+
+int CorsairCapellixXTHidapiTransport::Read(uint8_t* data, size_t length, int timeout_ms)
+{
+    return hid_read_timeout(dev, data, length, timeout_ms);
+}
+
+std::string CorsairCapellixXTHidapiTransport::GetSerialString()
+{
+    wchar_t buf[256];
+
+    if(hid_get_serial_number_string(dev, buf, 256) != 0)
+    {
+        return "";
+    }
+
+    std::wstring ws(buf);
+    return std::string(ws.begin(), ws.end());
+}
+
+std::string CorsairCapellixXTHidapiTransport::GetProductString()
+{
+    wchar_t buf[256];
+
+    if(hid_get_product_string(dev, buf, 256) != 0)
+    {
+        return "";
+    }
+
+    std::wstring ws(buf);
+    return std::string(ws.begin(), ws.end());
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <hidapi.h>
+
+/*---------------------------------------------------------------------*\
+| Transport — the raw report pipe under Transfer(). Write() and Read()  |
+| keep hidapi's return conventions so the controller logic does not     |
+| change with the transport:                                            |
+|   Write: bytes written, -1 on error                                   |
+|   Read:  bytes read, 0 on timeout, -1 on error                        |
+| A transport is used under the controller's io_mutex only.             |
+\*---------------------------------------------------------------------*/
+
+class CorsairCapellixXTTransport
+{
+public:
+    virtual ~CorsairCapellixXTTransport() {}
+
+    virtual int                 Write(const uint8_t* data, size_t length)                   = 0;
+    virtual int                 Read(uint8_t* data, size_t length, int timeout_ms)          = 0;
+
+    virtual std::string         GetSerialString()                                           = 0;
+    virtual std::string         GetProductString()                                          = 0;
+
+    /*-----------------------------------------------------------------*\
+    | False for transports that are not backed by a device (replay);    |
+    | the controller then never tries to reopen the device by serial    |
+    \*-----------------------------------------------------------------*/
+    virtual bool                CanReconnect()                                              { return true; }
+};
+
+/*---------------------------------------------------------------------*\
+| The normal transport: an open hidapi device, closed on destruction    |
+\*---------------------------------------------------------------------*/
+
+class CorsairCapellixXTHidapiTransport : public CorsairCapellixXTTransport
+{
+public:
+    CorsairCapellixXTHidapiTransport(hid_device* dev);
+    ~CorsairCapellixXTHidapiTransport();
+
+    int                         Write(const uint8_t* data, size_t length) override;
+    int                         Read(uint8_t* data, size_t length, int timeout_ms) override;
+
+    std::string                 GetSerialString() override;
+    std::string                 GetProductString() override;
+
+private:
+    hid_device*                 dev;
+};
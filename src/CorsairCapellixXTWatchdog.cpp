@@ -0,0 +1,196 @@
+#include "CorsairCapellixXTWatchdog.h"
+#include "CorsairCapellixXTController.h"
+#include "CorsairCapellixXTLog.h"
+#include "CorsairCapellixXTSettings.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+CorsairCapellixXTWatchdog::CorsairCapellixXTWatchdog(const std::vector<CorsairCapellixXTController*>& controllers)
+{
+    for(CorsairCapellixXTController* c : controllers)
+    {
+        Watch watch;
+
+        watch.controller      = c;
+        watch.exempt_until    = std::chrono::steady_clock::now();
+        watch.alarm           = false;
+        watch.failsafe_logged = false;
+
+        watches.push_back(watch);
+    }
+}
+
+CorsairCapellixXTWatchdog::~CorsairCapellixXTWatchdog()
+{
+    Stop();
+}
+
+void CorsairCapellixXTWatchdog::Start()
+{
+    if(watchdog_thread != nullptr || watches.empty())
+    {
+        return;
+    }
+
+    LoadSLOs();
+
+    watchdog_thread_run = true;
+    watchdog_thread     = new std::thread(&CorsairCapellixXTWatchdog::WatchdogThread, this);
+}
+
+void CorsairCapellixXTWatchdog::Stop()
+{
+    if(watchdog_thread)
+    {
+        watchdog_thread_run = false;
+        watchdog_thread->join();
+        delete watchdog_thread;
+        watchdog_thread = nullptr;
+    }
+}
+
+/*---------------------------------------------------------------------*\
+| SLO file: "speed_write <seconds>" / "sensor_read <seconds>". Values   |
+| shorter than one cooling tick would alarm on a healthy loop and are   |
+| raised to CC_WATCHDOG_MIN_SLO_SEC.                                    |
+\*---------------------------------------------------------------------*/
+
+void CorsairCapellixXTWatchdog::LoadSLOs()
+{
+    std::string path = CCSettingsPath(CC_WATCHDOG_FILE);
+    if(path.empty())
+    {
+        return;
+    }
+    FILE* f = fopen(path.c_str(), "r");
+    if(f == nullptr)
+    {
+        return;
+    }
+
+    char line[128];
+
+    while(fgets(line, sizeof(line), f) != nullptr)
+    {
+        char which[16];
+        int  seconds;
+
+        if(sscanf(line, "%15s %d", which, &seconds) != 2)
+        {
+            continue;
+        }
+
+        seconds = std::max(seconds, (int)CC_WATCHDOG_MIN_SLO_SEC);
+
+        if(strcmp(which, "speed_write") == 0)
+        {
+            speed_write_slo_sec = seconds;
+        }
+        else if(strcmp(which, "sensor_read") == 0)
+        {
+            sensor_read_slo_sec = seconds;
+        }
+    }
+    fclose(f);
+
+    CCLog(CC_LOG_INFO, "watchdog SLOs: speed_write=%d s sensor_read=%d s", speed_write_slo_sec, sensor_read_slo_sec);
+}
+
+void CorsairCapellixXTWatchdog::WatchdogThread()
+{
+    while(watchdog_thread_run.load())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(CC_WATCHDOG_POLL_MS));
+
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+        for(Watch& watch : watches)
+        {
+            Check(watch, now);
+        }
+    }
+}
+
+void CorsairCapellixXTWatchdog::Check(Watch& watch, std::chrono::steady_clock::time_point now)
+{
+    CorsairCapellixXTController* c = watch.controller;
+
+    if(c->WatchdogExempt())
+    {
+        watch.exempt_until = now;
+
+        if(watch.alarm)
+        {
+            watch.alarm = false;
+            c->SetWatchdogAlarm("");
+        }
+        return;
+    }
+
+    /*-----------------------------------------------------------------*\
+    | Ages count from the later of the last success and the end of the  |
+    | last exemption, so leaving Disabled or reconnecting starts fresh  |
+    \*-----------------------------------------------------------------*/
+    double write_age = std::chrono::duration<double>(now - std::max(c->GetLastSpeedWrite(), watch.exempt_until)).count();
+    double read_age  = std::chrono::duration<double>(now - std::max(c->GetLastSensorRead(), watch.exempt_until)).count();
+
+    bool   write_late = write_age > speed_write_slo_sec;
+    bool   read_late  = read_age  > sensor_read_slo_sec;
+
+    if(!write_late && !read_late)
+    {
+        if(watch.alarm)
+        {
+            CCLog(CC_LOG_INFO, "serial=%s watchdog: cooling control back after %.1f s",
+                  c->GetSerialString().c_str(), std::chrono::duration<double>(now - watch.alarm_since).count());
+            watch.alarm = false;
+            c->SetWatchdogAlarm("");
+        }
+        return;
+    }
+
+    if(!watch.alarm)
+    {
+        char reason[128];
+
+        if(write_late)
+        {
+            snprintf(reason, sizeof(reason), "no speed write for %.0f s (SLO %d s)", write_age, speed_write_slo_sec);
+        }
+        else
+        {
+            snprintf(reason, sizeof(reason), "no sensor read for %.0f s (SLO %d s)", read_age, sensor_read_slo_sec);
+        }
+
+        CCLog(CC_LOG_ERROR, "serial=%s watchdog: %s, replaying device state",
+              c->GetSerialString().c_str(), reason);
+
+        watch.alarm           = true;
+        watch.alarm_since     = now;
+        watch.failsafe_next   = now + std::chrono::seconds(CC_WATCHDOG_FAILSAFE_SEC);
+        watch.failsafe_logged = false;
+
+        c->SetWatchdogAlarm(reason);
+        c->NotifyWatchdog();
+        return;
+    }
+
+    /*-----------------------------------------------------------------*\
+    | The replay did not bring the loop back: the service thread is     |
+    | stuck somewhere. Leave the cooler on fixed high duties.           |
+    \*-----------------------------------------------------------------*/
+    if(now >= watch.failsafe_next)
+    {
+        watch.failsafe_next = now + std::chrono::seconds(CC_WATCHDOG_FAILSAFE_SEC);
+
+        bool written = c->WriteFailsafeSpeeds(CC_WATCHDOG_FAILSAFE_LOCK_MS);
+
+        CCLog(watch.failsafe_logged ? CC_LOG_DEBUG : CC_LOG_ERROR,
+              written ? "serial=%s watchdog: control loop still stalled, wrote Performance duties directly"
+                      : "serial=%s watchdog: control loop still stalled, failsafe write failed (device busy or not responding)",
+              c->GetSerialString().c_str());
+        watch.failsafe_logged = true;
+    }
+}
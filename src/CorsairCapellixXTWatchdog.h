@@ -0,0 +1,69 @@
+#pragma once
+
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+class CorsairCapellixXTController;
+
+/*---------------------------------------------------------------------*\
+| Cooling watchdog. A thread of its own (the service thread is what it  |
+| watches) checks every CC_WATCHDOG_POLL_MS how long ago each device's  |
+| control loop last completed a speed write and a sensor read, against |
+| SLOs from CommanderCoreWatchdog.conf next to the other settings:      |
+|   speed_write 10                                                      |
+|   sensor_read 10                                                      |
+| (seconds; the defaults below apply without the file). Devices that   |
+| are disconnected, Disabled or without a pump are exempt, and the      |
+| clock restarts when they stop being exempt.                           |
+|                                                                       |
+| On a breach the alarm is raised (log, pane, metrics) and the device   |
+| is asked to replay its state on the service thread. If that has not   |
+| brought the loop back after CC_WATCHDOG_FAILSAFE_SEC, the watchdog    |
+| writes the Performance duties itself (and again every period while    |
+| the alarm lasts), waiting up to CC_WATCHDOG_FAILSAFE_LOCK_MS for the  |
+| device lock, so the pump and fans are left fast rather than wherever  |
+| they were.                                                            |
+| The alarm clears once both writes and reads are within SLO again.    |
+\*---------------------------------------------------------------------*/
+
+#define CC_WATCHDOG_FILE                    "CommanderCoreWatchdog.conf"
+#define CC_WATCHDOG_POLL_MS                 250
+#define CC_WATCHDOG_SPEED_WRITE_SLO_SEC     10
+#define CC_WATCHDOG_SENSOR_READ_SLO_SEC     10
+#define CC_WATCHDOG_MIN_SLO_SEC             (PUMP_UPDATE_INTERVAL_SEC + 1)
+#define CC_WATCHDOG_FAILSAFE_SEC            10
+#define CC_WATCHDOG_FAILSAFE_LOCK_MS        1000
+
+class CorsairCapellixXTWatchdog
+{
+public:
+    CorsairCapellixXTWatchdog(const std::vector<CorsairCapellixXTController*>& controllers);
+    ~CorsairCapellixXTWatchdog();
+
+    void                                        Start();
+    void                                        Stop();
+
+private:
+    struct Watch
+    {
+        CorsairCapellixXTController*            controller;
+        std::chrono::steady_clock::time_point   exempt_until;   // last time it was exempt
+        std::chrono::steady_clock::time_point   alarm_since;
+        std::chrono::steady_clock::time_point   failsafe_next;
+        bool                                    alarm;
+        bool                                    failsafe_logged;
+    };
+
+    std::vector<Watch>                          watches;
+    int                                         speed_write_slo_sec = CC_WATCHDOG_SPEED_WRITE_SLO_SEC;
+    int                                         sensor_read_slo_sec = CC_WATCHDOG_SENSOR_READ_SLO_SEC;
+
+    std::thread*                                watchdog_thread = nullptr;
+    std::atomic<bool>                           watchdog_thread_run{false};
+
+    void                                        LoadSLOs();
+    void                                        WatchdogThread();
+    void                                        Check(Watch& watch, std::chrono::steady_clock::time_point now);
+};
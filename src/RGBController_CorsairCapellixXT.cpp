@@ -1,4 +1,5 @@
 #include "RGBController_CorsairCapellixXT.h"
+#include "CorsairCapellixXTDetect.h"
 
 /**------------------------------------------------------------------*\
     @name Corsair H150i Elite CAPELLIX XT
@@ -101,41 +102,53 @@ void RGBController_CorsairCapellixXT::DeviceUpdateLEDs()
 {
     /*-----------------------------------------------------------------*\
     | The Commander Core expects each fan port (zones 1+) to occupy a   |
-    | fixed 34-LED (102-byte) slot in the color buffer, regardless of   |
-    | how many LEDs the fan actually has.  Zone 0 (pump head) is NOT    |
+    | fixed slot in the color buffer, regardless of how many LEDs the   |
+    | fan actually has (GetFrameSlotLeds).  Zone 0 (pump head) is NOT   |
     | padded — its data is exactly led_count * 3 bytes.                 |
     |                                                                   |
     | Layout:                                                           |
-    |   [zone 0: pump LEDs × 3]                                        |
-    |   [zone 1: fan LEDs × 3 + padding to 34 × 3]                    |
-    |   [zone 2: fan LEDs × 3 + padding to 34 × 3]                    |
+    |   [zone 0: pump LEDs × 3]                                         |
+    |   [zone 1: fan LEDs × 3 + padding to the slot]                    |
+    |   [zone 2: fan LEDs × 3 + padding to the slot]                    |
     |   ...                                                             |
     \*-----------------------------------------------------------------*/
-    static const unsigned int LEDS_PER_FAN_SLOT = 34;
 
     std::vector<ChannelInfo>& ch = controller->GetChannels();
 
-    std::vector<uint8_t> color_data;
+    /*-----------------------------------------------------------------*\
+    | Color correction and RGB24 packing happen in one pass per zone,   |
+    | straight into the reused frame buffer                             |
+    \*-----------------------------------------------------------------*/
+    static_assert(sizeof(RGBColor) == sizeof(uint32_t), "RGBColor is packed 0x00BBGGRR");
+
+    const CorsairCapellixXTColorCorrection& color_correction = controller->GetColorCorrection();
+
+    size_t frame_size = 0;
+
+    for(unsigned int zone_idx = 0; zone_idx < ch.size(); zone_idx++)
+    {
+        frame_size += controller->GetFrameSlotLeds(zone_idx) * 3;
+    }
+
+    color_data.assign(frame_size, 0x00);
+
+    size_t       offset    = 0;
     unsigned int color_idx = 0;
 
     for(unsigned int zone_idx = 0; zone_idx < ch.size(); zone_idx++)
     {
         unsigned int led_count = ch[zone_idx].led_count;
+        unsigned int available = color_idx < colors.size() ? (unsigned int)(colors.size() - color_idx) : 0;
+        unsigned int packed    = led_count < available ? led_count : available;
 
-        for(unsigned int i = 0; i < led_count && color_idx < colors.size(); i++, color_idx++)
-        {
-            color_data.push_back(RGBGetRValue(colors[color_idx]));
-            color_data.push_back(RGBGetGValue(colors[color_idx]));
-            color_data.push_back(RGBGetBValue(colors[color_idx]));
-        }
+        color_correction.PackZone(zone_idx, reinterpret_cast<const uint32_t*>(colors.data()) + color_idx,
+                                  packed, color_data.data() + offset);
+        color_idx += packed;
 
         /*-------------------------------------------------------------*\
-        | Pad fan ports (zone > 0) to 34-LED slots                      |
+        | Pad fan ports (zone > 0) to their slots (already zeroed)      |
         \*-------------------------------------------------------------*/
-        if(zone_idx != 0 && led_count < LEDS_PER_FAN_SLOT)
-        {
-            color_data.resize(color_data.size() + (LEDS_PER_FAN_SLOT - led_count) * 3, 0x00);
-        }
+        offset += controller->GetFrameSlotLeds(zone_idx) * 3;
     }
 
     controller->SendColors(color_data);
@@ -155,3 +168,25 @@ void RGBController_CorsairCapellixXT::DeviceUpdateMode()
 {
     /* Only direct mode is supported — nothing to switch */
 }
+
+/*---------------------------------------------------------------------*\
+| Wrap each detected hardware controller in an RGBController            |
+\*---------------------------------------------------------------------*/
+
+std::vector<RGBController*> DetectCorsairCapellixXT(
+    std::vector<CorsairCapellixXTController*>* raw_out)
+{
+    std::vector<RGBController*> controllers;
+
+    for(CorsairCapellixXTController* controller : DetectCorsairCapellixXTControllers())
+    {
+        controllers.push_back(new RGBController_CorsairCapellixXT(controller));
+
+        if(raw_out != nullptr)
+        {
+            raw_out->push_back(controller);
+        }
+    }
+
+    return controllers;
+}
@@ -19,5 +19,6 @@ public:
     void DeviceUpdateMode()                              override;
 
 private:
-    CorsairCapellixXTController* controller;
+    CorsairCapellixXTController*        controller;
+    std::vector<uint8_t>                color_data;
 };
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cmath>
+#include <cstdio>
+
+/*---------------------------------------------------------------------*\
+| Minimal test registry for commander-core-tests                        |
+|                                                                       |
+| Each CC_TEST registers a function at static-init time; the runner in  |
+| CommanderCoreTests.cpp calls them in registration order and exits     |
+| nonzero if any check failed. No hardware is touched and settings go   |
+| to a scratch HOME.                                                    |
+\*---------------------------------------------------------------------*/
+
+typedef void (*CCTestFunc)();
+
+struct CCTestCase
+{
+    const char*     name;
+    CCTestFunc      func;
+    CCTestCase*     next;
+};
+
+struct CCTestRegistrar
+{
+    CCTestRegistrar(CCTestCase* test);
+};
+
+void CCTestFail(const char* file, int line, const char* expr);
+
+// Directory the tests run in (HOME points at it); cleaned by the runner
+const char* CCTestScratchDir();
+
+#define CC_TEST(name)                                                       \
+    static void cc_test_##name();                                           \
+    static CCTestCase      cc_test_case_##name = { #name, cc_test_##name, nullptr }; \
+    static CCTestRegistrar cc_test_reg_##name(&cc_test_case_##name);        \
+    static void cc_test_##name()
+
+#define CC_CHECK(expr)                                                      \
+    do { if(!(expr)) CCTestFail(__FILE__, __LINE__, #expr); } while(0)
+
+#define CC_CHECK_EQ(a, b)                                                   \
+    do { if(!((a) == (b))) CCTestFail(__FILE__, __LINE__, #a " == " #b); } while(0)
+
+#define CC_CHECK_NEAR(a, b, tol)                                            \
+    do { if(!(std::fabs((double)(a) - (double)(b)) <= (tol)))               \
+             CCTestFail(__FILE__, __LINE__, #a " ~= " #b); } while(0)
@@ -0,0 +1,147 @@
+#pragma once
+
+#include "CorsairCapellixXTController.h"
+#include "CorsairCapellixXTSettings.h"
+
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*---------------------------------------------------------------------*\
+| Scriptable fake device for the tests                                  |
+|                                                                       |
+| Every write is answered with an all-zero report echoing the command   |
+| byte. A test that needs more passes a reply hook, which sees each     |
+| written report and may fill in (or clear, to drop) the reply.         |
+\*---------------------------------------------------------------------*/
+
+typedef std::function<void(const uint8_t* data, size_t length, std::vector<uint8_t>& reply)> CCTestReplyHook;
+
+class CCTestTransport : public CorsairCapellixXTTransport
+{
+public:
+    CCTestTransport(const std::string& serial, CCTestReplyHook hook = nullptr)
+        : serial(serial), hook(hook) {}
+
+    int Write(const uint8_t* data, size_t length) override
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::vector<uint8_t>        reply(64, 0x00);
+
+        reply[1] = length > 2 ? data[2] : 0x00;
+
+        if(hook)
+        {
+            hook(data, length, reply);
+        }
+
+        if(!reply.empty())
+        {
+            replies.push_back(reply);
+        }
+        return (int)length;
+    }
+
+    int Read(uint8_t* data, size_t length, int /*timeout_ms*/) override
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if(replies.empty())
+        {
+            return 0;
+        }
+
+        size_t n = std::min(length, replies.front().size());
+
+        memcpy(data, replies.front().data(), n);
+        replies.pop_front();
+        return (int)n;
+    }
+
+    std::string GetSerialString() override  { return serial; }
+    std::string GetProductString() override { return "test"; }
+    bool        CanReconnect() override     { return false; }
+
+private:
+    std::mutex                          mutex;
+    std::string                         serial;
+    CCTestReplyHook                     hook;
+    std::deque<std::vector<uint8_t>>    replies;
+};
+
+/*---------------------------------------------------------------------*\
+| Reply hook for a Commander Core that answers what Initialize() sends. |
+| The LED config reads return the scripted layouts (LEDs per port) in   |
+| turn, the last one from then on.                                      |
+\*---------------------------------------------------------------------*/
+
+inline CCTestReplyHook CCTestDeviceHook(const std::vector<std::vector<int>>& layouts)
+{
+    uint8_t mode      = 0;
+    size_t  led_reads = 0;
+
+    return [layouts, mode, led_reads](const uint8_t* data, size_t /*length*/, std::vector<uint8_t>& reply) mutable
+    {
+        uint8_t c0 = data[2];
+        uint8_t c1 = data[3];
+
+        if(c0 == 0x02 && c1 == 0x13)
+        {
+            reply[3] = 2;
+            reply[4] = 10;
+            reply[5] = 219;
+        }
+        else if(c0 == 0x0D && c1 == 0x01)
+        {
+            mode = data[4];
+        }
+        else if(c0 == 0x08 && mode == MODE_GET_LEDS)
+        {
+            const std::vector<int>& leds = layouts[std::min(led_reads, layouts.size() - 1)];
+
+            led_reads++;
+            reply[3] = 0x0F;
+            reply[5] = (uint8_t)leds.size();
+
+            for(size_t ch = 0; ch < leds.size(); ch++)
+            {
+                reply[6 + 4 * ch] = leds[ch] > 0 ? LED_STATUS_CONNECTED : 0x00;
+                reply[8 + 4 * ch] = (uint8_t)leds[ch];
+            }
+        }
+    };
+}
+
+/*---------------------------------------------------------------------*\
+| Topology cache of a test device: whether it was written at all, and   |
+| whether it has a line starting with the given text                    |
+\*---------------------------------------------------------------------*/
+
+inline bool CCTestCacheHasLine(const char* serial, const char* line)
+{
+    FILE* f     = fopen(CCDeviceSettingsPath(CC_TOPOLOGY_FILE_PREFIX, serial).c_str(), "r");
+    bool  found = false;
+    char  buf[256];
+
+    if(f == nullptr)
+    {
+        return false;
+    }
+
+    while(!found && fgets(buf, sizeof(buf), f) != nullptr)
+    {
+        found = strncmp(buf, line, strlen(line)) == 0;
+    }
+
+    fclose(f);
+    return found;
+}
+
+inline bool CCTestCacheExists(const char* serial)
+{
+    return CCTestCacheHasLine(serial, "");
+}
@@ -0,0 +1,83 @@
+/*---------------------------------------------------------------------*\
+| commander-core-tests                                                  |
+|                                                                       |
+| Deterministic checks for the pure logic behind the cooling and        |
+| lighting paths. Run from the repository root:                         |
+|   qmake CorsairCommanderCoreTests.pro -o Makefile.tests               |
+|   make -f Makefile.tests -j$(nproc) && ./commander-core-tests         |
+\*---------------------------------------------------------------------*/
+
+#include "CommanderCoreTest.h"
+#include "CorsairCapellixXTSettings.h"
+
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+
+static CCTestCase*  first_test   = nullptr;
+static CCTestCase** last_test    = &first_test;
+static int          failures     = 0;
+static std::string  scratch_dir;
+
+CCTestRegistrar::CCTestRegistrar(CCTestCase* test)
+{
+    *last_test = test;
+    last_test  = &test->next;
+}
+
+void CCTestFail(const char* file, int line, const char* expr)
+{
+    printf("    FAIL %s:%d: %s\n", file, line, expr);
+    failures++;
+}
+
+const char* CCTestScratchDir()
+{
+    return scratch_dir.c_str();
+}
+
+int main(int argc, char** argv)
+{
+    const char* only = argc > 1 ? argv[1] : nullptr;
+
+    /*-----------------------------------------------------------------*\
+    | Settings, topology caches and telemetry all resolve under HOME,   |
+    | so point it at a scratch directory before anything reads it       |
+    \*-----------------------------------------------------------------*/
+    char tmpl[] = "/tmp/commander-core-tests.XXXXXX";
+
+    if(mkdtemp(tmpl) == nullptr)
+    {
+        perror("mkdtemp");
+        return 2;
+    }
+
+    scratch_dir = tmpl;
+    setenv("HOME", tmpl, 1);
+
+    std::error_code ec;
+    std::filesystem::create_directories(CCSettingsDir(), ec);
+
+    int run = 0;
+
+    for(CCTestCase* t = first_test; t != nullptr; t = t->next)
+    {
+        if(only != nullptr && std::string(t->name).find(only) == std::string::npos)
+        {
+            continue;
+        }
+
+        int before = failures;
+
+        t->func();
+        run++;
+
+        printf("%s %s\n", failures == before ? "ok  " : "FAIL", t->name);
+    }
+
+    std::filesystem::remove_all(scratch_dir, ec);
+
+    printf("%d tests, %d failed checks\n", run, failures);
+
+    return failures == 0 ? 0 : 1;
+}
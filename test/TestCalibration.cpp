@@ -0,0 +1,111 @@
+/*---------------------------------------------------------------------*\
+| Duty -> RPM calibration: sweep bookkeeping, stall detection and the   |
+| interpolation the mode duties and Target RPM feed-forward rely on     |
+\*---------------------------------------------------------------------*/
+
+#include "CommanderCoreTest.h"
+#include "CorsairCapellixXTCalibration.h"
+
+static CorsairCapellixXTCalibration SweptFan()
+{
+    CorsairCapellixXTCalibration cal;
+
+    // Out of order on purpose: Finish() sorts by duty
+    cal.AddReading(1, 60,  1200);
+    cal.AddReading(1, 20,     0);
+    cal.AddReading(1, 40,   600);
+    cal.AddReading(1, 30,   150);
+    cal.AddReading(1, 100, 2000);
+
+    // Empty port: never spins, dropped by Finish()
+    cal.AddReading(2, 20,  0);
+    cal.AddReading(2, 100, 0);
+
+    cal.Finish();
+    return cal;
+}
+
+CC_TEST(calibration_finish_sorts_and_finds_stall)
+{
+    CorsairCapellixXTCalibration cal = SweptFan();
+
+    const CCChannelCalibration* fan = cal.Channel(1);
+
+    CC_CHECK(fan != nullptr);
+    CC_CHECK(cal.Channel(2) == nullptr);
+
+    if(fan == nullptr)
+    {
+        return;
+    }
+
+    CC_CHECK_EQ(fan->points.size(), 5u);
+    CC_CHECK_EQ(fan->points.front().duty, 20);
+    CC_CHECK_EQ(fan->points.back().duty, 100);
+
+    // 30% still reads below CC_CALIBRATION_STALL_RPM
+    CC_CHECK_EQ(fan->stall_duty, 30);
+}
+
+CC_TEST(calibration_duty_for_rpm_interpolates)
+{
+    CorsairCapellixXTCalibration cal = SweptFan();
+
+    // On a measured point
+    CC_CHECK_EQ(cal.DutyForRpm(1, 600), 40);
+    CC_CHECK_EQ(cal.DutyForRpm(1, 1200), 60);
+
+    // Halfway 600..1200 rpm is halfway 40..60%
+    CC_CHECK_EQ(cal.DutyForRpm(1, 900), 50);
+
+    // Lowest duty that reaches the speed: rounds up, never down
+    CC_CHECK_EQ(cal.DutyForRpm(1, 610), 41);
+
+    // Outside the sweep: clamp to the ends
+    CC_CHECK_EQ(cal.DutyForRpm(1, 0), 20);
+    CC_CHECK_EQ(cal.DutyForRpm(1, 5000), 100);
+
+    // Uncalibrated channel
+    CC_CHECK_EQ(cal.DutyForRpm(5, 1000), -1);
+}
+
+CC_TEST(calibration_rpm_for_duty_inverts)
+{
+    CorsairCapellixXTCalibration cal = SweptFan();
+
+    CC_CHECK_EQ(cal.RpmForDuty(1, 50), 900);
+    CC_CHECK_EQ(cal.RpmForDuty(1, 10), 0);
+    CC_CHECK_EQ(cal.RpmForDuty(1, 100), 2000);
+    CC_CHECK_EQ(cal.RpmForDuty(5, 50), -1);
+
+    for(int rpm = 200; rpm <= 2000; rpm += 50)
+    {
+        int duty = cal.DutyForRpm(1, rpm);
+
+        // The duty found reaches the speed, one percent less does not
+        CC_CHECK(cal.RpmForDuty(1, duty) >= rpm);
+        CC_CHECK(duty == 20 || cal.RpmForDuty(1, duty - 1) < rpm);
+    }
+}
+
+CC_TEST(calibration_save_load_round_trip)
+{
+    CorsairCapellixXTCalibration cal = SweptFan();
+    CorsairCapellixXTCalibration loaded;
+
+    CC_CHECK(cal.Save("TESTSERIAL"));
+    CC_CHECK(loaded.Load("TESTSERIAL"));
+
+    const CCChannelCalibration* fan = loaded.Channel(1);
+
+    CC_CHECK(fan != nullptr);
+
+    if(fan != nullptr)
+    {
+        CC_CHECK_EQ(fan->points.size(), 5u);
+        CC_CHECK_EQ(fan->stall_duty, 30);
+    }
+
+    CC_CHECK_EQ(loaded.DutyForRpm(1, 900), 50);
+    CC_CHECK(!loaded.Load("NOSUCHSERIAL") || loaded.Empty());
+}
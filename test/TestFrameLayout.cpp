@@ -0,0 +1,117 @@
+/*---------------------------------------------------------------------*\
+| Trimmed frame trial: a refused trimmed frame goes out padded in the   |
+| same send, and the trial ends whichever way the padded one goes       |
+\*---------------------------------------------------------------------*/
+
+#include "CommanderCoreTest.h"
+#include "CommanderCoreTestTransport.h"
+#include "CorsairCapellixXTController.h"
+
+/*---------------------------------------------------------------------*\
+| Pump head and three 8-LED fans: 327 trimmed bytes, 405 padded. The    |
+| device counts color frames by their first chunk and answers the       |
+| chunks of a frame with a non-zero status if its layout is refused.    |
+\*---------------------------------------------------------------------*/
+struct LayoutTestDevice
+{
+    bool                refuse_trimmed;
+    bool                refuse_padded;
+    bool                refusing = false;
+    int                 frames   = 0;
+};
+
+#define LAYOUT_TEST_PADDED_BYTES    ((33 + 3 * CC_FAN_SLOT_LEDS) * 3)
+
+static CorsairCapellixXTController* LayoutTestController(LayoutTestDevice* device, const char* serial)
+{
+    CCTestTransport* transport = new CCTestTransport(serial,
+        [device](const uint8_t* data, size_t /*length*/, std::vector<uint8_t>& reply)
+        {
+            if(data[2] == CMD_WRITE_COLOR_0 && data[3] == CMD_WRITE_COLOR_1)
+            {
+                size_t bytes = (size_t)(data[4] | (data[5] << 8)) - 2;
+
+                device->frames++;
+                device->refusing = bytes < LAYOUT_TEST_PADDED_BYTES ? device->refuse_trimmed : device->refuse_padded;
+            }
+
+            if(data[2] == CMD_WRITE_COLOR_0 || data[2] == CMD_WRITE_COLOR_NEXT_0)
+            {
+                reply[CC_REPLY_STATUS_INDEX] = device->refusing ? 0x01 : CC_REPLY_STATUS_OK;
+            }
+        });
+
+    CorsairCapellixXTController* c = new CorsairCapellixXTController(transport, serial, COMMANDER_CORE_PID);
+
+    c->GetChannels() = { { 0, 33, "Pump" }, { 1, 8, "Fan 1" }, { 2, 8, "Fan 2" }, { 3, 8, "Fan 3" } };
+
+    return c;
+}
+
+static void SendFrame(CorsairCapellixXTController* c)
+{
+    size_t bytes = 0;
+
+    for(unsigned int zone = 0; zone < c->GetChannels().size(); zone++)
+    {
+        bytes += c->GetFrameSlotLeds(zone) * 3;
+    }
+
+    c->SendColors(std::vector<uint8_t>(bytes, 0x40));
+}
+
+CC_TEST(frame_layout_trimmed_accepted)
+{
+    LayoutTestDevice             t = { false, false };
+    CorsairCapellixXTController* c = LayoutTestController(&t, "LAYOUT1");
+
+    SendFrame(c);
+    SendFrame(c);
+
+    CC_CHECK_EQ(t.frames, 2);
+    CC_CHECK_EQ(c->GetStats().frame_layout, (int)CC_FRAME_LAYOUT_TRIMMED);
+    CC_CHECK_EQ(c->GetStats().frames_sent, 2u);
+
+    delete c;
+}
+
+CC_TEST(frame_layout_refused_trimmed_goes_padded)
+{
+    LayoutTestDevice             t = { true, false };
+    CorsairCapellixXTController* c = LayoutTestController(&t, "LAYOUT2");
+
+    // Trimmed, then padded in the same send
+    SendFrame(c);
+
+    CC_CHECK_EQ(t.frames, 2);
+    CC_CHECK_EQ(c->GetStats().frame_layout, (int)CC_FRAME_LAYOUT_PADDED);
+    CC_CHECK(CCTestCacheHasLine("LAYOUT2", "layout padded"));
+
+    // Padded straight away from now on
+    SendFrame(c);
+
+    CC_CHECK_EQ(t.frames, 3);
+    CC_CHECK_EQ(c->GetStats().frames_sent, 2u);
+
+    delete c;
+}
+
+CC_TEST(frame_layout_refused_both_ends_trial)
+{
+    LayoutTestDevice             t = { true, true };
+    CorsairCapellixXTController* c = LayoutTestController(&t, "LAYOUT3");
+
+    SendFrame(c);
+
+    CC_CHECK_EQ(t.frames, 2);
+    CC_CHECK_EQ(c->GetStats().frame_layout, (int)CC_FRAME_LAYOUT_TRIMMED);
+
+    // The status says nothing about the layout: no second trial
+    SendFrame(c);
+    SendFrame(c);
+
+    CC_CHECK_EQ(t.frames, 4);
+    CC_CHECK(!CCTestCacheHasLine("LAYOUT3", "layout padded"));
+
+    delete c;
+}
@@ -0,0 +1,167 @@
+/*---------------------------------------------------------------------*\
+| Frame sync rounds: release when complete, release on timeout, the     |
+| capped head start, and a cooling step never held behind the group     |
+\*---------------------------------------------------------------------*/
+
+#include "CommanderCoreTest.h"
+#include "CommanderCoreTestTransport.h"
+#include "CorsairCapellixXTController.h"
+#include "CorsairCapellixXTFrameSync.h"
+
+#include <thread>
+
+using std::chrono::steady_clock;
+using std::chrono::milliseconds;
+using std::chrono::microseconds;
+
+static CorsairCapellixXTController* SyncTestController(const char* serial)
+{
+    return new CorsairCapellixXTController(new CCTestTransport(serial), serial, COMMANDER_CORE_PID);
+}
+
+static double Ms(steady_clock::duration d)
+{
+    return std::chrono::duration<double, std::milli>(d).count();
+}
+
+CC_TEST(frame_sync_alone_sends_unsynced)
+{
+    CorsairCapellixXTController* a = SyncTestController("SYNCA1");
+    CorsairCapellixXTController* b = SyncTestController("SYNCB1");
+    CorsairCapellixXTFrameSync*  sync = new CorsairCapellixXTFrameSync({a, b});
+
+    // b has never sent a frame: nothing to wait for
+    CCFrameSlot slot = sync->Arrive(a, true);
+
+    CC_CHECK_EQ(slot.round, 0u);
+    CC_CHECK(!slot.yield);
+
+    delete sync;
+    delete a;
+    delete b;
+}
+
+CC_TEST(frame_sync_complete_round)
+{
+    CorsairCapellixXTController* a = SyncTestController("SYNCA2");
+    CorsairCapellixXTController* b = SyncTestController("SYNCB2");
+    CorsairCapellixXTFrameSync*  sync = new CorsairCapellixXTFrameSync({a, b});
+
+    sync->Arrive(b, true);      // b active, round 0
+
+    CCFrameSlot              slot_a;
+    steady_clock::time_point a_start = steady_clock::now();
+    steady_clock::time_point a_back;
+    std::thread              t([&] { slot_a = sync->Arrive(a, true); a_back = steady_clock::now(); });
+
+    std::this_thread::sleep_for(milliseconds(5));
+
+    CCFrameSlot slot_b = sync->Arrive(b, true);
+
+    t.join();
+
+    // Both in the same round, let go together before the timeout
+    CC_CHECK(slot_a.round != 0);
+    CC_CHECK_EQ(slot_a.round, slot_b.round);
+    CC_CHECK(Ms(a_back - a_start) < CC_FRAME_SYNC_WAIT_MS);
+
+    steady_clock::time_point now = steady_clock::now();
+
+    sync->Committed(a, slot_a.round, true, now, now + microseconds(1000));
+    sync->Committed(b, slot_b.round, true, now, now + microseconds(1200));
+
+    CorsairCapellixXTStats stats = a->GetStats();
+
+    CC_CHECK_EQ(stats.sync_skew_count, 1u);
+    CC_CHECK_EQ(stats.sync_partial, 0u);
+    CC_CHECK_NEAR(stats.sync_skew_max_s, 0.0002, 1e-6);
+
+    delete sync;
+    delete a;
+    delete b;
+}
+
+CC_TEST(frame_sync_partial_round_on_timeout)
+{
+    CorsairCapellixXTController* a = SyncTestController("SYNCA3");
+    CorsairCapellixXTController* b = SyncTestController("SYNCB3");
+    CorsairCapellixXTFrameSync*  sync = new CorsairCapellixXTFrameSync({a, b});
+
+    sync->Arrive(b, true);
+
+    steady_clock::time_point start = steady_clock::now();
+    CCFrameSlot              slot  = sync->Arrive(a, true);
+    double                   took  = Ms(steady_clock::now() - start);
+
+    // b never came: a goes on alone once the wait runs out
+    CC_CHECK(slot.round != 0);
+    CC_CHECK(!slot.yield);
+    CC_CHECK(took >= CC_FRAME_SYNC_WAIT_MS - 1);
+    CC_CHECK(took <  CC_FRAME_SYNC_WAIT_MS * 4);
+
+    delete sync;
+    delete a;
+    delete b;
+}
+
+CC_TEST(frame_sync_head_start_capped)
+{
+    CorsairCapellixXTController* a = SyncTestController("SYNCA4");
+    CorsairCapellixXTController* b = SyncTestController("SYNCB4");
+    CorsairCapellixXTFrameSync*  sync = new CorsairCapellixXTFrameSync({a, b});
+
+    for(int round = 0; round < 3; round++)
+    {
+        sync->Arrive(b, true);
+
+        CCFrameSlot slot_a;
+        std::thread t([&] { slot_a = sync->Arrive(a, true); });
+
+        std::this_thread::sleep_for(milliseconds(2));
+
+        CCFrameSlot slot_b = sync->Arrive(b, true);
+
+        t.join();
+
+        // a's last chunk is fast, b's needed a 400 ms retry every time
+        CC_CHECK(slot_a.start - slot_b.start <= milliseconds(CC_FRAME_SYNC_WAIT_MS));
+        CC_CHECK(slot_b.start - steady_clock::now() <= milliseconds(CC_FRAME_SYNC_WAIT_MS));
+
+        steady_clock::time_point now = steady_clock::now();
+
+        sync->Committed(a, slot_a.round, true, now, now + microseconds(500));
+        sync->Committed(b, slot_b.round, true, now, now + milliseconds(400));
+    }
+
+    delete sync;
+    delete a;
+    delete b;
+}
+
+CC_TEST(frame_sync_cooling_not_held_by_group)
+{
+    CorsairCapellixXTController* a = SyncTestController("SYNCA5");
+    CorsairCapellixXTController* b = SyncTestController("SYNCB5");
+    CorsairCapellixXTFrameSync*  sync = new CorsairCapellixXTFrameSync({a, b});
+
+    sync->Arrive(b, true);
+
+    // A one-chunk frame cannot yield; it waits in the round for b
+    std::thread t([&] { a->SendColors(std::vector<uint8_t>(30, 0x40)); });
+
+    std::this_thread::sleep_for(milliseconds(5));
+
+    // A cooling tick on a's service step: must not sit out the round
+    a->ServiceStep(steady_clock::now());
+
+    t.join();
+
+    CorsairCapellixXTStats stats = a->GetStats();
+
+    CC_CHECK(stats.cooling_wait_count >= 1);
+    CC_CHECK(stats.cooling_wait_max_s * 1000.0 < CC_FRAME_SYNC_WAIT_MS / 2);
+
+    delete sync;
+    delete a;
+    delete b;
+}
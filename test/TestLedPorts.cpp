@@ -0,0 +1,51 @@
+/*---------------------------------------------------------------------*\
+| LED port readiness: a layout that is still coming up must not be      |
+| taken as final or written to the topology cache                       |
+\*---------------------------------------------------------------------*/
+
+#include "CommanderCoreTest.h"
+#include "CommanderCoreTestTransport.h"
+#include "CorsairCapellixXTController.h"
+
+CC_TEST(led_ports_wait_for_stable_layout)
+{
+    // The pump head answers first, then the fans one by one
+    std::vector<std::vector<int>> layouts =
+    {
+        { 33, 0, 0, 0, 0, 0, 0 },
+        { 33, 8, 0, 0, 0, 0, 0 },
+        { 33, 8, 8, 8, 0, 0, 0 },
+    };
+
+    CorsairCapellixXTController* c =
+        new CorsairCapellixXTController(new CCTestTransport("LEDPORTS1", CCTestDeviceHook(layouts)), "LEDPORTS1", COMMANDER_CORE_PID);
+
+    c->Initialize(true);
+
+    CC_CHECK_EQ(c->GetChannels().size(), 4u);
+    CC_CHECK_EQ(c->GetTotalLEDCount(), 57u);
+    CC_CHECK(CCTestCacheExists("LEDPORTS1"));
+
+    delete c;
+}
+
+CC_TEST(led_ports_unsettled_layout_not_cached)
+{
+    // Never reads the same twice before the deadline
+    std::vector<std::vector<int>> layouts;
+
+    for(int i = 0; i < 2 * CC_LED_READY_TIMEOUT_MS / CC_LED_READY_POLL_MS; i++)
+    {
+        layouts.push_back({ 33, i % 2 ? 8 : 0, 0, 0, 0, 0, 0 });
+    }
+
+    CorsairCapellixXTController* c =
+        new CorsairCapellixXTController(new CCTestTransport("LEDPORTS2", CCTestDeviceHook(layouts)), "LEDPORTS2", COMMANDER_CORE_PID);
+
+    c->Initialize(true);
+
+    CC_CHECK(!c->GetChannels().empty());
+    CC_CHECK(!CCTestCacheExists("LEDPORTS2"));
+
+    delete c;
+}
@@ -0,0 +1,114 @@
+/*---------------------------------------------------------------------*\
+| Profiles: the colors of a profile reach the wire through the device's |
+| color correction, like every other frame                              |
+\*---------------------------------------------------------------------*/
+
+#include "CommanderCoreTest.h"
+#include "CommanderCoreTestTransport.h"
+#include "CorsairCapellixXTController.h"
+#include "CorsairCapellixXTColor.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+static void WriteSettingsFile(const std::string& path, const char* text)
+{
+    FILE* f = fopen(path.c_str(), "w");
+
+    if(f != nullptr)
+    {
+        fputs(text, f);
+        fclose(f);
+    }
+}
+
+CC_TEST(profile_colors_are_color_corrected)
+{
+    WriteSettingsFile(CCDeviceSettingsPath(CC_COLOR_FILE_PREFIX, "PROFILE1"), "brightness 50\nzone 1 brightness 25\n");
+    WriteSettingsFile(CCSettingsPath(CC_PROFILES_FILE), "profile red\ncolor all ff0000\n");
+
+    // Last color frame as written: chunks joined, without the 6-byte header
+    // (size, padding, data type; the size counts the data type too)
+    std::vector<uint8_t> frame;
+    std::vector<uint8_t> building;
+    std::mutex           frame_mutex;
+    std::atomic<int>     frames{0};
+
+    CCTestReplyHook device = CCTestDeviceHook({ { 33, 8, 0, 0, 0, 0, 0 } });
+
+    CCTestTransport* transport = new CCTestTransport("PROFILE1",
+        [&](const uint8_t* data, size_t length, std::vector<uint8_t>& reply)
+        {
+            device(data, length, reply);
+
+            if(data[2] == CMD_WRITE_COLOR_0 && data[3] == CMD_WRITE_COLOR_1)
+            {
+                building.assign(data + 4, data + length);
+            }
+            else if(data[2] == CMD_WRITE_COLOR_NEXT_0)
+            {
+                building.insert(building.end(), data + 4, data + length);
+            }
+            else
+            {
+                return;
+            }
+
+            size_t size = building[0] | (building[1] << 8);
+
+            if(building.size() >= size + 4)
+            {
+                std::lock_guard<std::mutex> lock(frame_mutex);
+                frame.assign(building.begin() + 6, building.begin() + 4 + size);
+                frames++;
+            }
+        });
+
+    CorsairCapellixXTController* c = new CorsairCapellixXTController(transport, "PROFILE1", COMMANDER_CORE_PID);
+
+    c->Initialize(true);
+
+    int before = frames.load();
+
+    CC_CHECK(c->ApplyProfile("red"));
+
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+
+    while(frames.load() == before && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+
+    // What the RGBController would send for pure red in each zone
+    CorsairCapellixXTColorCorrection correction;
+    const uint32_t                   red = 0x000000FF;
+    uint8_t                          pump[3];
+    uint8_t                          fan[3];
+
+    correction.Load("PROFILE1");
+    correction.PackZone(0, &red, 1, pump);
+    correction.PackZone(1, &red, 1, fan);
+
+    std::vector<uint8_t> sent;
+    {
+        std::lock_guard<std::mutex> lock(frame_mutex);
+        sent = frame;
+    }
+
+    CC_CHECK(frames.load() > before);
+    CC_CHECK(pump[0] < 0xFF && fan[0] < pump[0]);
+    CC_CHECK_EQ(sent.size(), (33u + 8u) * 3u);
+
+    if(sent.size() == (33u + 8u) * 3u)
+    {
+        CC_CHECK(memcmp(sent.data(), pump, 3) == 0);
+        CC_CHECK(memcmp(sent.data() + 33 * 3, fan, 3) == 0);
+        CC_CHECK(memcmp(sent.data() + 40 * 3, fan, 3) == 0);
+    }
+
+    delete c;
+
+    remove(CCSettingsPath(CC_PROFILES_FILE).c_str());
+}
@@ -0,0 +1,147 @@
+/*---------------------------------------------------------------------*\
+| Trace replay against the recorded fixture                             |
+|                                                                       |
+| test/fixtures/daemon-auto.cctrace is a commander-core-daemon session  |
+| (Auto mode, default settings, no lighting): initialization and two    |
+| cooling ticks. Replaying it runs the controller the same way          |
+| commander-core-daemon --replay does, so any change to the commands    |
+| the controller sends shows up as a mismatch here. Re-record it with   |
+| commander-core-daemon --record <dir> on a fresh settings directory    |
+| when a change to the command sequence is intended.                    |
+\*---------------------------------------------------------------------*/
+
+#include "CommanderCoreTest.h"
+#include "CorsairCapellixXTController.h"
+#include "CorsairCapellixXTSettings.h"
+#include "CorsairCapellixXTTrace.h"
+
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#define CC_TEST_REPLAY_FIXTURE      CC_TEST_FIXTURES "/daemon-auto.cctrace"
+#define CC_TEST_REPLAY_TIMEOUT_SEC  30
+
+static CCTraceReplayStats Replay(const std::string& path, bool& loaded)
+{
+    CCTraceReplay      replay;
+    CCTraceReplayStats stats = {};
+
+    loaded = replay.Load(path);
+
+    if(!loaded)
+    {
+        return stats;
+    }
+
+    /*-----------------------------------------------------------------*\
+    | The recording started without a topology cache; an earlier        |
+    | replay would have left one that skips the LED port query          |
+    \*-----------------------------------------------------------------*/
+    remove(CCDeviceSettingsPath(CC_TOPOLOGY_FILE_PREFIX, replay.GetSerialString()).c_str());
+
+    CorsairCapellixXTController* controller =
+        new CorsairCapellixXTController(new CCTraceReplayTransport(&replay), path.c_str(),
+                                        replay.GetProductID());
+
+    controller->Initialize(false);
+
+    std::chrono::steady_clock::time_point give_up =
+        std::chrono::steady_clock::now() + std::chrono::seconds(CC_TEST_REPLAY_TIMEOUT_SEC);
+
+    while(controller->IsConnected() && !replay.Finished() && std::chrono::steady_clock::now() < give_up)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+
+    delete controller;
+
+    return replay.GetStats();
+}
+
+CC_TEST(replay_fixture_matches)
+{
+    bool               loaded = false;
+    CCTraceReplayStats stats  = Replay(CC_TEST_REPLAY_FIXTURE, loaded);
+
+    CC_CHECK(loaded);
+    CC_CHECK(stats.writes > 0);
+    CC_CHECK_EQ(stats.mismatches, 0u);
+    CC_CHECK_EQ(stats.empty_reads, 0u);
+}
+
+CC_TEST(replay_detects_changed_command)
+{
+    /*-----------------------------------------------------------------*\
+    | Same trace with one byte of the first recorded write changed      |
+    \*-----------------------------------------------------------------*/
+    std::vector<uint8_t> data;
+
+    FILE* f = fopen(CC_TEST_REPLAY_FIXTURE, "rb");
+
+    CC_CHECK(f != nullptr);
+
+    if(f == nullptr)
+    {
+        return;
+    }
+
+    uint8_t chunk[4096];
+    size_t  n;
+
+    while((n = fread(chunk, 1, sizeof(chunk), f)) > 0)
+    {
+        data.insert(data.end(), chunk, chunk + n);
+    }
+    fclose(f);
+
+    CCTraceHeader header;
+    CCTraceRecord record;
+    size_t        offset = 0;
+
+    CC_CHECK(data.size() >= sizeof(header));
+
+    if(data.size() >= sizeof(header))
+    {
+        memcpy(&header, data.data(), sizeof(header));
+        offset = header.header_size;
+    }
+
+    while(offset + sizeof(record) <= data.size())
+    {
+        memcpy(&record, data.data() + offset, sizeof(record));
+
+        if(record.direction == CC_TRACE_DIR_WRITE && record.length > 2)
+        {
+            break;
+        }
+
+        offset += sizeof(record) + record.length;
+    }
+
+    CC_CHECK(offset + sizeof(record) <= data.size());
+
+    if(offset + sizeof(record) > data.size())
+    {
+        return;
+    }
+
+    // The command byte
+    data[offset + sizeof(record) + 2] ^= 0xFF;
+
+    std::string path = std::string(CCTestScratchDir()) + "/changed.cctrace";
+
+    f = fopen(path.c_str(), "wb");
+    CC_CHECK(f != nullptr && fwrite(data.data(), 1, data.size(), f) == data.size());
+
+    if(f != nullptr)
+    {
+        fclose(f);
+    }
+
+    bool               loaded = false;
+    CCTraceReplayStats stats  = Replay(path, loaded);
+
+    CC_CHECK(loaded);
+    CC_CHECK(stats.mismatches >= 1);
+}
@@ -0,0 +1,139 @@
+/*---------------------------------------------------------------------*\
+| Target RPM feedback against a simulated cooler that is off the model  |
+|                                                                       |
+| Mirrors TargetDuties() one allowed change at a time: the duty comes   |
+| from the reference model at target + correction, the simulated        |
+| channel answers with the model's speed scaled by a constant factor,   |
+| and that reading feeds the next CCUpdateTargetCorrection().           |
+\*---------------------------------------------------------------------*/
+
+#include "CommanderCoreTest.h"
+#include "CorsairCapellixXTController.h"
+
+#include <algorithm>
+
+static CorsairCapellixXTCalibration ReferenceModel()
+{
+    CorsairCapellixXTCalibration model;
+
+    model.AddReading(PUMP_CHANNEL,      PUMP_DUTY_SILENT,      PUMP_RPM_SILENT);
+    model.AddReading(PUMP_CHANNEL,      PUMP_DUTY_QUIET,       PUMP_RPM_QUIET);
+    model.AddReading(PUMP_CHANNEL,      PUMP_DUTY_BALANCED,    PUMP_RPM_BALANCED);
+    model.AddReading(PUMP_CHANNEL,      PUMP_DUTY_PERFORMANCE, PUMP_RPM_PERFORMANCE);
+    model.AddReading(FAN_CHANNEL_FIRST, FAN_DUTY_SILENT,       FAN_RPM_SILENT);
+    model.AddReading(FAN_CHANNEL_FIRST, FAN_DUTY_QUIET,        FAN_RPM_QUIET);
+    model.AddReading(FAN_CHANNEL_FIRST, FAN_DUTY_BALANCED,     FAN_RPM_BALANCED);
+    model.AddReading(FAN_CHANNEL_FIRST, FAN_DUTY_PERFORMANCE,  FAN_RPM_PERFORMANCE);
+    model.Finish();
+
+    return model;
+}
+
+/*---------------------------------------------------------------------*\
+| Runs the loop until the duty stops moving; returns the number of      |
+| duty changes after the first (feed-forward) write, or -1 if it had    |
+| not settled after 20 steps. final_rpm is the last simulated reading.  |
+\*---------------------------------------------------------------------*/
+static int ChangesToSettle(const CorsairCapellixXTCalibration& model, unsigned int channel,
+                           int target, float scale, int floor, int& final_rpm)
+{
+    float correction = 0.0f;
+    int   duty       = std::max(model.DutyForRpm(channel, target), floor);
+    int   changes    = 0;
+
+    for(int step = 0; step < 20; step++)
+    {
+        int measured = (int)(model.RpmForDuty(channel, duty) * scale);
+
+        final_rpm = measured;
+
+        CCUpdateTargetCorrection(correction, target, measured);
+
+        int next = std::max(model.DutyForRpm(channel, (int)(target + correction)), floor);
+
+        if(next == duty)
+        {
+            return changes;
+        }
+
+        duty = next;
+        changes++;
+    }
+
+    return -1;
+}
+
+CC_TEST(target_rpm_correction_step)
+{
+    float correction = 0.0f;
+
+    // Inside the deadband, or no reading: untouched
+    CCUpdateTargetCorrection(correction, 2000, 2000 - CC_TARGET_DEADBAND_RPM);
+    CC_CHECK_EQ(correction, 0.0f);
+    CCUpdateTargetCorrection(correction, 2000, -1);
+    CC_CHECK_EQ(correction, 0.0f);
+
+    // CC_TARGET_GAIN_PCT of the error
+    CCUpdateTargetCorrection(correction, 2000, 1500);
+    CC_CHECK_NEAR(correction, 500 * CC_TARGET_GAIN_PCT / 100.0, 0.01);
+
+    // Clamped to CC_TARGET_MAX_CORRECTION_PCT of the target
+    for(int i = 0; i < 10; i++)
+    {
+        CCUpdateTargetCorrection(correction, 2000, 0);
+    }
+    CC_CHECK_NEAR(correction, 2000 * CC_TARGET_MAX_CORRECTION_PCT / 100.0, 0.01);
+
+    for(int i = 0; i < 10; i++)
+    {
+        CCUpdateTargetCorrection(correction, 2000, 4000);
+    }
+    CC_CHECK_NEAR(correction, -2000 * CC_TARGET_MAX_CORRECTION_PCT / 100.0, 0.01);
+}
+
+CC_TEST(target_rpm_settles_against_scaled_model)
+{
+    CorsairCapellixXTCalibration model = ReferenceModel();
+
+    const float scales[] = { 0.75f, 1.25f };
+
+    for(float scale : scales)
+    {
+        struct { unsigned int channel; int target; int floor; } cases[] =
+        {
+            { PUMP_CHANNEL,      CC_TARGET_DEFAULT_PUMP_RPM, PUMP_DUTY_MIN },
+            { PUMP_CHANNEL,      1800,                       PUMP_DUTY_MIN },
+            { FAN_CHANNEL_FIRST, CC_TARGET_DEFAULT_FAN_RPM,  FAN_DUTY_MIN  },
+            { FAN_CHANNEL_FIRST, 1300,                       FAN_DUTY_MIN  },
+        };
+
+        for(auto& c : cases)
+        {
+            int rpm     = -1;
+            int changes = ChangesToSettle(model, c.channel, c.target, scale, c.floor, rpm);
+
+            CC_CHECK(changes >= 0);
+            CC_CHECK(changes <= 3);
+
+            // Settled within one duty step of the deadband
+            int step_rpm = model.RpmForDuty(c.channel, 100) / 100 + 1;
+
+            CC_CHECK(std::abs(rpm - c.target) <= CC_TARGET_DEADBAND_RPM + (int)(step_rpm * 2 * scale));
+        }
+    }
+}
+
+CC_TEST(target_rpm_stays_stable_far_off_model)
+{
+    CorsairCapellixXTCalibration model = ReferenceModel();
+
+    // Twice as fast as the model overshoots each step but must still settle
+    const float scales[] = { 0.6f, 2.0f };
+
+    for(float scale : scales)
+    {
+        int rpm = -1;
+
+        CC_CHECK(ChangesToSettle(model, FAN_CHANNEL_FIRST, 800, scale, FAN_DUTY_MIN, rpm) >= 0);
+    }
+}
@@ -0,0 +1,143 @@
+/*---------------------------------------------------------------------*\
+| Telemetry ring: resuming after a restart and moving through the       |
+| segments, checked by reading the segment files back                   |
+\*---------------------------------------------------------------------*/
+
+#include "CommanderCoreTest.h"
+#include "CorsairCapellixXTSettings.h"
+#include "CorsairCapellixXTTelemetry.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+static std::string SegmentFile(const std::string& serial, unsigned int index)
+{
+    return CCSettingsDir() + CC_TELEMETRY_DIR "/CommanderCore-" + serial
+         + "." + std::to_string(index) + ".cctelem";
+}
+
+/*---------------------------------------------------------------------*\
+| Used records of a segment, in slot order; empty if missing or foreign |
+\*---------------------------------------------------------------------*/
+static std::vector<CCTelemetryRecord> ReadSegment(const std::string& serial, unsigned int index)
+{
+    std::vector<CCTelemetryRecord> records;
+
+    FILE* f = fopen(SegmentFile(serial, index).c_str(), "rb");
+
+    if(f == nullptr)
+    {
+        return records;
+    }
+
+    CCTelemetryHeader header;
+
+    if(fread(&header, sizeof(header), 1, f) == 1
+    && memcmp(header.magic, CC_TELEMETRY_MAGIC, sizeof(header.magic)) == 0)
+    {
+        CCTelemetryRecord record;
+
+        while(fread(&record, sizeof(record), 1, f) == 1 && record.unix_ms != 0)
+        {
+            records.push_back(record);
+        }
+    }
+
+    fclose(f);
+    return records;
+}
+
+static void AppendRecords(CCTelemetryWriter& writer, unsigned int count)
+{
+    for(unsigned int i = 0; i < count; i++)
+    {
+        CCTelemetryRecord record;
+
+        memset(&record, 0, sizeof(record));
+        record.liquid_decidegrees = 300;
+        record.channel_count      = 1;
+
+        writer.Append(record);
+    }
+}
+
+CC_TEST(telemetry_resumes_after_reopen)
+{
+    CCTelemetryWriter writer;
+
+    CC_CHECK(writer.Open("RESUME1"));
+    AppendRecords(writer, 5);
+    writer.Close();
+
+    CC_CHECK(writer.Open("RESUME1"));
+    AppendRecords(writer, 3);
+    writer.Close();
+
+    std::vector<CCTelemetryRecord> records = ReadSegment("RESUME1", 0);
+
+    CC_CHECK_EQ(records.size(), 8u);
+
+    for(size_t i = 0; i < records.size(); i++)
+    {
+        CC_CHECK_EQ(records[i].sequence, (uint32_t)i);
+    }
+
+    CC_CHECK(ReadSegment("RESUME1", 1).empty());
+}
+
+CC_TEST(telemetry_full_segment_resumes_in_next)
+{
+    CCTelemetryWriter writer;
+
+    CC_CHECK(writer.Open("FULL1"));
+    AppendRecords(writer, CC_TELEMETRY_SEGMENT_RECORDS);
+    writer.Close();
+
+    CC_CHECK(writer.Open("FULL1"));
+    AppendRecords(writer, 1);
+    writer.Close();
+
+    std::vector<CCTelemetryRecord> next = ReadSegment("FULL1", 1);
+
+    CC_CHECK_EQ(ReadSegment("FULL1", 0).size(), (size_t)CC_TELEMETRY_SEGMENT_RECORDS);
+    CC_CHECK_EQ(next.size(), 1u);
+    CC_CHECK(!next.empty() && next[0].sequence == CC_TELEMETRY_SEGMENT_RECORDS);
+}
+
+CC_TEST(telemetry_ring_wraps_and_resumes)
+{
+    const uint32_t ring = CC_TELEMETRY_SEGMENT_RECORDS * CC_TELEMETRY_SEGMENTS;
+
+    CCTelemetryWriter writer;
+
+    CC_CHECK(writer.Open("WRAP1"));
+    AppendRecords(writer, ring + 10);
+    writer.Close();
+
+    // The oldest segment was started over with the newest records
+    std::vector<CCTelemetryRecord> first = ReadSegment("WRAP1", 0);
+
+    CC_CHECK_EQ(first.size(), 10u);
+    CC_CHECK(!first.empty() && first[0].sequence == ring);
+
+    for(unsigned int index = 1; index < CC_TELEMETRY_SEGMENTS; index++)
+    {
+        std::vector<CCTelemetryRecord> seg = ReadSegment("WRAP1", index);
+
+        CC_CHECK_EQ(seg.size(), (size_t)CC_TELEMETRY_SEGMENT_RECORDS);
+        CC_CHECK(!seg.empty() && seg[0].sequence == index * CC_TELEMETRY_SEGMENT_RECORDS);
+    }
+
+    CC_CHECK(ReadSegment("WRAP1", CC_TELEMETRY_SEGMENTS).empty());
+
+    // A restart continues in segment 0, not in the older full ones
+    CC_CHECK(writer.Open("WRAP1"));
+    AppendRecords(writer, 1);
+    writer.Close();
+
+    first = ReadSegment("WRAP1", 0);
+
+    CC_CHECK_EQ(first.size(), 11u);
+    CC_CHECK(first.size() == 11 && first[10].sequence == ring + 10);
+}
@@ -51,6 +51,15 @@ MODE_SET_COLOR          = bytes([0x22])
 # Data type prefix for color writes
 DATA_TYPE_SET_COLOR     = bytes([0x12, 0x00])
 
+# Fan ports occupy fixed slots of this many LEDs in the plugin's color frame
+FAN_SLOT_LEDS           = 34
+
+# Colors for the layout test, one per channel in port order
+LAYOUT_TEST_COLORS = [
+    (255, 0, 0), (0, 255, 0), (0, 0, 255), (255, 255, 0),
+    (0, 255, 255), (255, 0, 255), (255, 255, 255),
+]
+
 # Known Corsair USB PIDs for Commander Core variants
 KNOWN_PIDS = ["0C1C", "0C32"]
 
@@ -170,6 +179,13 @@ class CommanderCore:
             return os.read(self.fd, 512)
         return None
 
+    @staticmethod
+    def reply_status(resp: bytes | None) -> int | None:
+        """Status byte of a reply (0 = OK), None without a reply."""
+        if resp is None or len(resp) < 3:
+            return None
+        return resp[2]
+
     def read_endpoint(self, mode: bytes) -> bytes | None:
         """Read from a data endpoint: close-open-read-close."""
         self.transfer(CMD_CLOSE_ENDPOINT, mode)
@@ -277,11 +293,12 @@ class CommanderCore:
 
     # -- color output ------------------------------------------------------
 
-    def send_colors(self, color_data: bytes):
+    def send_colors(self, color_data: bytes) -> list[int | None]:
         """
         Send RGB color data matching OpenLinkHub writeColor().
 
         color_data: flat [R,G,B,R,G,B,...] for all LEDs in channel order.
+        Returns the reply status of every chunk.
         """
         # Build write buffer: [size_le_u16, 0x00, 0x00, dataType, color_data]
         size = len(color_data) + 2
@@ -300,11 +317,14 @@ class CommanderCore:
             offset += chunk_size
 
         # Send chunks
+        statuses = []
         for i, chunk in enumerate(chunks):
             if i == 0:
-                self.transfer(CMD_WRITE_COLOR, chunk)
+                resp = self.transfer(CMD_WRITE_COLOR, chunk)
             else:
-                self.transfer(CMD_WRITE_COLOR_NEXT, chunk)
+                resp = self.transfer(CMD_WRITE_COLOR_NEXT, chunk)
+            statuses.append(self.reply_status(resp))
+        return statuses
 
     def set_solid_color(self, r: int, g: int, b: int):
         """Set every LED to the same color."""
@@ -319,6 +339,36 @@ class CommanderCore:
             buf += bytes(list(color) * count)
         self.send_colors(bytes(buf))
 
+    def layout_frame(self, layout: str) -> bytes:
+        """
+        Frame with every channel in its own LAYOUT_TEST_COLORS color.
+
+        padded:  fan ports padded to FAN_SLOT_LEDS, the last one too
+        trimmed: as padded, but nothing after the last LED (plugin default)
+        packed:  no padding at all
+        """
+        buf = bytearray()
+        ports = sorted(self.channels.keys())
+        for n, ch in enumerate(ports):
+            count = self.channels[ch]
+            buf += bytes(list(LAYOUT_TEST_COLORS[ch % len(LAYOUT_TEST_COLORS)]) * count)
+            last = n == len(ports) - 1
+            if ch != 0 and layout != "packed" and not (last and layout == "trimmed"):
+                buf += bytes(3 * max(0, FAN_SLOT_LEDS - count))
+        return bytes(buf)
+
+    def layout_test(self, layout: str):
+        """Light each channel in its own color using the given frame layout."""
+        frame = self.layout_frame(layout)
+        statuses = self.send_colors(frame)
+        chunks = (len(frame) + 6 + MAX_BUF_PER_REQUEST - 1) // MAX_BUF_PER_REQUEST
+        refused = [s for s in statuses if s != 0]
+        print(f"    {layout}: {len(frame)} bytes in {chunks} chunks, "
+              + ("all chunks OK" if not refused else f"status {refused}"))
+        for ch in sorted(self.channels.keys()):
+            r, g, b = LAYOUT_TEST_COLORS[ch % len(LAYOUT_TEST_COLORS)]
+            print(f"    Channel {ch} should be #{r:02X}{g:02X}{b:02X} on all {self.channels[ch]} LEDs")
+
     def rainbow_cycle(self, duration: float = 10.0, speed: float = 1.0):
         """Animate a rainbow sweep across all LEDs."""
         fps = 30
@@ -376,6 +426,7 @@ def interactive(cc: CommanderCore):
     print("  fans <color>           Set all fans only")
     print("  split <pump> <fans>    Pump and fans different colors")
     print("  rainbow [seconds]      Rainbow animation (default 10s)")
+    print("  layout <kind>          Frame layout check: padded, trimmed, packed")
     print("  off                    Turn all LEDs off (black)")
     print("  info                   Show device info")
     print("  quit                   Exit (returns to hardware mode)")
@@ -450,6 +501,13 @@ def interactive(cc: CommanderCore):
                     pass
             cc.rainbow_cycle(duration=dur)
 
+        elif cmd == "layout":
+            kind = args.strip().lower() or "trimmed"
+            if kind in ("padded", "trimmed", "packed"):
+                cc.layout_test(kind)
+            else:
+                print("    Usage: layout padded|trimmed|packed")
+
         elif cmd == "off":
             print("    LEDs off (black)")
             cc.set_solid_color(0, 0, 0)
@@ -0,0 +1,133 @@
+#!/usr/bin/env python3
+"""Export Commander Core telemetry history (.cctelem) as CSV.
+
+The plugin and commander-core-daemon keep a ring of segment files per
+device in ~/.config/OpenRGB/plugins/settings/telemetry/. The layout is
+described in src/CorsairCapellixXTTelemetry.h.
+
+    tools/cc_telemetry.py                                   everything, all devices
+    tools/cc_telemetry.py --serial ABC123 --from 2026-10-01 --to "2026-10-02 12:00"
+    tools/cc_telemetry.py --from=-6h > last6h.csv           relative to now
+"""
+
+import argparse
+import csv
+import os
+import struct
+import sys
+import time
+from datetime import datetime
+
+HEADER = struct.Struct("<8sIHHII32s")
+RECORD = struct.Struct("<QIhBB7sB7HH")
+
+CHANNELS = 7
+NO_TEMP = -32768
+NO_RPM = 0xFFFF
+
+MODES = {0: "Auto", 1: "Silent", 2: "Quiet", 3: "Balanced",
+         4: "Performance", 5: "Disabled", 6: "Target"}
+
+FLAGS = [(0x01, "temp-invalid"), (0x02, "speed-failed"), (0x04, "write-failed"),
+         (0x08, "breaker-open"), (0x10, "rejected")]
+
+
+def parse_time(text):
+    """Unix seconds, -<n>[smhd] relative to now, or a local date/time."""
+    if text is None:
+        return None
+    units = {"s": 1, "m": 60, "h": 3600, "d": 86400}
+    if text.startswith("-") and text[-1] in units:
+        return int((time.time() - float(text[1:-1]) * units[text[-1]]) * 1000)
+    try:
+        return int(float(text) * 1000)
+    except ValueError:
+        pass
+    for fmt in ("%Y-%m-%d %H:%M:%S", "%Y-%m-%d %H:%M", "%Y-%m-%dT%H:%M:%S", "%Y-%m-%d"):
+        try:
+            return int(datetime.strptime(text, fmt).timestamp() * 1000)
+        except ValueError:
+            continue
+    sys.exit(f"cannot parse time '{text}'")
+
+
+def segments(paths):
+    for path in paths:
+        if os.path.isdir(path):
+            for name in sorted(os.listdir(path)):
+                if name.endswith(".cctelem"):
+                    yield os.path.join(path, name)
+        else:
+            yield path
+
+
+def load(path):
+    with open(path, "rb") as f:
+        data = f.read()
+
+    if len(data) < HEADER.size:
+        print(f"{path}: too short, skipped", file=sys.stderr)
+        return None, []
+
+    magic, version, header_size, record_size, capacity, _, serial = HEADER.unpack_from(data)
+    if magic != b"CCTELEM1" or version != 1 or record_size != RECORD.size:
+        print(f"{path}: not a version 1 telemetry segment, skipped", file=sys.stderr)
+        return None, []
+
+    records = []
+    offset = header_size
+    for _ in range(capacity):
+        if offset + RECORD.size > len(data):
+            break
+        record = RECORD.unpack_from(data, offset)
+        if record[0] == 0:
+            break
+        records.append(record)
+        offset += RECORD.size
+
+    return serial.split(b"\0")[0].decode(errors="replace"), records
+
+
+def main():
+    default_dir = os.path.expanduser("~/.config/OpenRGB/plugins/settings/telemetry")
+
+    parser = argparse.ArgumentParser(description="Export Commander Core telemetry as CSV")
+    parser.add_argument("paths", nargs="*", default=[default_dir],
+                        help="segment files or directories (default: %(default)s)")
+    parser.add_argument("--serial", help="only this device")
+    parser.add_argument("--from", dest="start", help="first time to include")
+    parser.add_argument("--to", dest="end", help="last time to include")
+    args = parser.parse_args()
+
+    start = parse_time(args.start)
+    end = parse_time(args.end)
+
+    rows = []
+    for path in segments(args.paths):
+        serial, records = load(path)
+        if serial is None or (args.serial and serial != args.serial):
+            continue
+        for record in records:
+            if (start is None or record[0] >= start) and (end is None or record[0] <= end):
+                rows.append((serial, record))
+
+    rows.sort(key=lambda row: (row[0], row[1][0], row[1][1]))
+
+    out = csv.writer(sys.stdout)
+    out.writerow(["time", "unix_ms", "serial", "sequence", "mode", "liquid_c", "flags"]
+                 + [f"duty{ch}" for ch in range(CHANNELS)]
+                 + [f"rpm{ch}" for ch in range(CHANNELS)])
+
+    for serial, record in rows:
+        unix_ms, sequence, liquid, mode, flags, duty, count = record[:7]
+        rpm = record[7:7 + CHANNELS]
+        stamp = datetime.fromtimestamp(unix_ms / 1000).isoformat(sep=" ", timespec="milliseconds")
+        out.writerow([stamp, unix_ms, serial, sequence, MODES.get(mode, mode),
+                      "" if liquid == NO_TEMP else f"{liquid / 10:.1f}",
+                      "|".join(name for bit, name in FLAGS if flags & bit)]
+                     + [duty[ch] if ch < count else "" for ch in range(CHANNELS)]
+                     + ["" if ch >= count or rpm[ch] == NO_RPM else rpm[ch] for ch in range(CHANNELS)])
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,159 @@
+#!/usr/bin/env python3
+"""Summarize a Commander Core HID trace (.cctrace).
+
+Traces are written by the plugin or commander-core-daemon when
+CC_TRACE_RECORD=<dir> is set (daemon: --record <dir>). The layout is
+described in src/CorsairCapellixXTTrace.h.
+
+    tools/cc_trace.py trace.cctrace            latency summary
+    tools/cc_trace.py --dump trace.cctrace     one line per record
+"""
+
+import argparse
+import struct
+import sys
+from collections import defaultdict
+
+HEADER = struct.Struct("<8sIHH32s32sQ")
+RECORD = struct.Struct("<QIIiiHBB")
+
+DIR_WRITE = 1
+DIR_READ = 2
+
+COMMANDS = {
+    0x01: "set-mode",
+    0x02: "get",
+    0x05: "close-endpoint",
+    0x06: "write",
+    0x07: "write-next",
+    0x08: "read",
+    0x0D: "open-endpoint",
+}
+
+
+def load(path):
+    with open(path, "rb") as f:
+        data = f.read()
+
+    if len(data) < HEADER.size:
+        sys.exit(f"{path}: too short to be a trace")
+
+    magic, version, pid, header_size, serial, product, start = HEADER.unpack_from(data)
+    if magic != b"CCTRACE1" or version != 1:
+        sys.exit(f"{path}: not a version 1 trace")
+
+    header = {
+        "pid": pid,
+        "serial": serial.split(b"\0")[0].decode(errors="replace"),
+        "product": product.split(b"\0")[0].decode(errors="replace"),
+        "start_unix_ns": start,
+    }
+
+    records = []
+    offset = header_size
+    while offset + RECORD.size <= len(data):
+        start_ns, duration_ns, tid, result, timeout_ms, length, direction, _ = \
+            RECORD.unpack_from(data, offset)
+        if direction not in (DIR_WRITE, DIR_READ):
+            break
+        payload = data[offset + RECORD.size:offset + RECORD.size + length]
+        records.append((start_ns, duration_ns, tid, result, timeout_ms, direction, payload))
+        offset += RECORD.size + length
+
+    return header, records
+
+
+def percentile(values, p):
+    if not values:
+        return 0.0
+    values = sorted(values)
+    k = min(len(values) - 1, int(round(p / 100.0 * (len(values) - 1))))
+    return values[k]
+
+
+def summarize(header, records):
+    """Pair each write with the reply that echoes its command byte.
+
+    Latency is write start to the end of the read that returned the
+    echo; reads in between that returned something else are stale."""
+    latencies = defaultdict(list)
+    timeouts = defaultdict(int)
+    threads = defaultdict(int)
+    stale = 0
+    errors = 0
+    pending = None
+
+    for start_ns, duration_ns, tid, result, timeout_ms, direction, payload in records:
+        threads[tid] += 1
+
+        if direction == DIR_WRITE:
+            if result < 0:
+                errors += 1
+            cmd = payload[2] if len(payload) > 2 else 0
+            pending = (cmd, start_ns)
+            continue
+
+        if result < 0:
+            errors += 1
+            pending = None
+            continue
+
+        if result == 0:
+            # Zero-timeout reads are the stale-reply drain before a write
+            if pending is not None and timeout_ms > 0:
+                timeouts[pending[0]] += 1
+                pending = None
+            continue
+
+        echo = payload[1] if len(payload) > 1 else 0
+        if pending is not None and echo == pending[0]:
+            latencies[pending[0]].append((start_ns + duration_ns - pending[1]) / 1e6)
+            pending = None
+        else:
+            stale += 1
+
+    span = (records[-1][0] - records[0][0]) / 1e9 if records else 0.0
+
+    print(f"{header['product']} serial {header['serial']} pid {header['pid']:04X}")
+    print(f"{len(records)} records over {span:.1f} s, {len(threads)} thread(s), "
+          f"{stale} stale replies, {errors} I/O errors")
+    print()
+    print(f"{'command':<16}{'count':>7}{'p50 ms':>9}{'p90 ms':>9}{'p99 ms':>9}{'max ms':>9}{'timeouts':>10}")
+
+    for cmd in sorted(set(latencies) | set(timeouts)):
+        values = latencies[cmd]
+        name = COMMANDS.get(cmd, f"0x{cmd:02X}")
+        print(f"{name:<16}{len(values):>7}"
+              f"{percentile(values, 50):>9.2f}{percentile(values, 90):>9.2f}"
+              f"{percentile(values, 99):>9.2f}{max(values, default=0.0):>9.2f}"
+              f"{timeouts[cmd]:>10}")
+
+    print()
+    for tid, count in sorted(threads.items()):
+        print(f"thread {tid}: {count} records")
+
+
+def dump(records):
+    for start_ns, duration_ns, tid, result, timeout_ms, direction, payload in records:
+        arrow = ">" if direction == DIR_WRITE else "<"
+        extra = f" timeout={timeout_ms}" if direction == DIR_READ else ""
+        print(f"{start_ns / 1e6:12.3f} {duration_ns / 1e3:9.1f}us tid={tid} {arrow} "
+              f"r={result}{extra} {payload.hex(' ')}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("trace")
+    parser.add_argument("--dump", action="store_true", help="print every record")
+    args = parser.parse_args()
+
+    header, records = load(args.trace)
+
+    if args.dump:
+        dump(records)
+    else:
+        summarize(header, records)
+
+
+if __name__ == "__main__":
+    main()